@@ -20,6 +20,7 @@
 
 #include "mce-log.h"
 #include "mce-io.h"
+#include "mce-conf.h"
 #include "mce-dbus.h"
 
 #include "powerkey.h"
@@ -34,6 +35,7 @@
 #include <string.h>
 #include <errno.h>
 #include <glob.h>
+#include <pthread.h>
 
 /* ========================================================================= *
  *
@@ -53,6 +55,15 @@
 /** Path to persistent storage file */
 #define VALUES_PATH G_STRINGIFY(MCE_VAR_DIR)"/builtin-gconf.values"
 
+/** Configuration group for builtin-gconf tunables */
+#define MCE_CONF_BUILTIN_GCONF_GROUP "BuiltinGConf"
+
+/** Configuration key for delaying value saving [ms] */
+#define MCE_CONF_SAVE_DELAY          "SaveDelay"
+
+/** Default value for MCE_CONF_SAVE_DELAY */
+#define DEFAULT_SAVE_DELAY           1000
+
 /* ========================================================================= *
  *
  * MACROS
@@ -114,12 +125,23 @@ static void gconf_client_debug(GConfClient *self);
 #endif
 GConfClient *gconf_client_get_default(void);
 static void gconf_client_free_default(void);
+
+static char *gconf_client_serialize_values(GConfClient *self, size_t *psize);
+static void gconf_client_save_values(GConfClient *self, const char *path);
+
+static void *gconf_saver_thread_cb(void *aptr);
+static void gconf_saver_queue(char *data, size_t size);
+static void gconf_saver_wait(void);
+static void gconf_saver_quit(void);
+static void gconf_saver_start(GConfClient *self);
+static gboolean gconf_saver_timer_cb(gpointer aptr);
 void gconf_client_add_dir(GConfClient *client, const gchar *dir, GConfClientPreloadType preload, GError **err);
 static GConfEntry *gconf_client_find_entry(GConfClient *self, const gchar *key, GError **err);
 static GConfValue *gconf_client_find_value(GConfClient *self, const gchar *key, GError **err);
 GConfValue *gconf_client_get(GConfClient *self, const gchar *key, GError **err);
 static void gconf_client_notify_free(GConfClientNotify *self);
 static void gconf_client_notify_free_cb(gpointer self);
+static void gconf_client_notify_free_all(GConfClient *client);
 static GConfClientNotify *gconf_client_notify_new(const gchar *namespace_section, GConfClientNotifyFunc func, gpointer user_data, GFreeFunc destroy_notify);
 static void gconf_client_notify_change(GConfClient *client, const gchar *namespace_section);
 guint gconf_client_notify_add(GConfClient *client, const gchar *namespace_section, GConfClientNotifyFunc func, gpointer user_data, GFreeFunc destroy_notify, GError **err);
@@ -130,6 +152,7 @@ gboolean gconf_client_set_float(GConfClient *client, const gchar *key, double va
 gboolean gconf_client_set_string(GConfClient *client, const gchar *key, const gchar *val, GError **err);
 gboolean gconf_client_set_list(GConfClient *client, const gchar *key, GConfValueType list_type, GSList *list, GError **err);
 void gconf_client_suggest_sync(GConfClient *client, GError **err);
+void gconf_client_flush(GConfClient *client, GError **err);
 
 /* ========================================================================= *
  *
@@ -1754,15 +1777,55 @@ static GConfClient *default_client = 0;
 /** Lookup table for latest change signals sent */
 static GHashTable *gconf_signal_sent = 0;
 
-/** Save values to persistent storage file */
-static void gconf_client_save_values(GConfClient *self, const char *path)
+/** Delay between value change and saving to file [ms] */
+static gint gconf_saver_delay = DEFAULT_SAVE_DELAY;
+
+/** Timer for delayed saving */
+static guint gconf_saver_timer_id = 0;
+
+/** Content that was last handed to the saver thread */
+static char *gconf_saver_last_data = 0;
+
+/** Size of gconf_saver_last_data */
+static size_t gconf_saver_last_size = 0;
+
+/** Saver thread */
+static pthread_t gconf_saver_thread;
+
+/** Flag for: saver thread has been started */
+static bool gconf_saver_thread_ok = false;
+
+/** Mutex protecting data shared with the saver thread */
+static pthread_mutex_t gconf_saver_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/** Condition for signaling state changes between threads */
+static pthread_cond_t gconf_saver_cond = PTHREAD_COND_INITIALIZER;
+
+/** Content waiting to be written by the saver thread */
+static char *gconf_saver_data = 0;
+
+/** Size of gconf_saver_data */
+static size_t gconf_saver_size = 0;
+
+/** Flag for: saver thread is writing */
+static bool gconf_saver_busy = false;
+
+/** Flag for: saver thread should exit */
+static bool gconf_saver_exit = false;
+
+/** Serialize values that differ from defaults
+ *
+ * @param self  GConfClient
+ * @param psize where to store size of returned data
+ *
+ * @return malloc'ed file content, or NULL on failure
+ */
+static char *gconf_client_serialize_values(GConfClient *self, size_t *psize)
 {
   char   *data = 0;
   size_t  size = 0;
   FILE   *file = 0;
 
-  mce_log(LL_INFO, "updating %s", path);
-
   if( !(file = open_memstream(&data, &size)) ) {
     goto cleanup;
   }
@@ -1789,15 +1852,26 @@ static void gconf_client_save_values(GConfClient *self, const char *path)
   // the data pointer gets set at fclose()
   fclose(file), file = 0;
 
-  if( data )
-  {
-    mce_io_update_file_atomic(path, data, size, 0664, FALSE);
-  }
-
 cleanup:
 
   if( file ) fclose(file);
 
+  return *psize = size, data;
+}
+
+/** Save values to persistent storage file */
+static void gconf_client_save_values(GConfClient *self, const char *path)
+{
+  char   *data = 0;
+  size_t  size = 0;
+
+  mce_log(LL_INFO, "updating %s", path);
+
+  if( (data = gconf_client_serialize_values(self, &size)) )
+  {
+    mce_io_update_file_atomic(path, data, size, 0664, FALSE);
+  }
+
   free(data);
 
   return;
@@ -1988,14 +2062,20 @@ int gconf_client_reset_defaults(GConfClient *self, const char *keyish)
 
 static void gconf_client_free_default(void)
 {
+  gconf_saver_quit();
+
   if( default_client )
   {
+    gconf_client_notify_free_all(default_client);
+
+    if( default_client->entry_lut )
+    {
+      g_hash_table_unref(default_client->entry_lut);
+    }
+
     g_slist_free_full(default_client->entries,
                       gconf_entry_free_cb);
 
-    g_slist_free_full(default_client->notify_list,
-                      gconf_client_notify_free_cb);
-
     free(default_client), default_client = 0;
   }
 
@@ -2022,6 +2102,22 @@ gconf_client_get_default(void)
     }
     self->entries = g_slist_reverse(self->entries);
 
+    // index entries by key; the keys are owned by the entries
+    self->entry_lut = g_hash_table_new(g_str_hash, g_str_equal);
+    for( GSList *e_iter = self->entries; e_iter; e_iter = e_iter->next )
+    {
+      GConfEntry *entry = e_iter->data;
+      if( !g_hash_table_lookup(self->entry_lut, entry->key) )
+      {
+        g_hash_table_insert(self->entry_lut, entry->key, entry);
+      }
+    }
+
+    // notifiers grouped by key and indexed by id
+    self->notify_lut = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                             g_free, 0);
+    self->notify_ids = g_hash_table_new(g_direct_hash, g_direct_equal);
+
     // let gconf_client_is_valid() know about this
     default_client = self;
     atexit(gconf_client_free_default);
@@ -2038,6 +2134,13 @@ gconf_client_get_default(void)
     // save back - will be nop unless defaults have changed since last save
     gconf_client_save_values(self, VALUES_PATH);
 
+    // further saving is delayed and done in a separate thread
+    gconf_saver_delay = mce_conf_get_int(MCE_CONF_BUILTIN_GCONF_GROUP,
+                                         MCE_CONF_SAVE_DELAY,
+                                         DEFAULT_SAVE_DELAY);
+    gconf_saver_last_data = gconf_client_serialize_values(self,
+                                                          &gconf_saver_last_size);
+
 #if GCONF_ENABLE_DEBUG_LOGGING
     if( gconf_log_debug_p() )
     {
@@ -2073,17 +2176,7 @@ gconf_client_find_entry(GConfClient *self, const gchar *key, GError **err)
     goto cleanup;
   }
 
-  for( GSList *e_iter = self->entries; e_iter; e_iter = e_iter->next )
-  {
-    GConfEntry *entry = e_iter->data;
-    if( !strcmp(entry->key, key) )
-    {
-      res = entry;
-      break;
-    }
-  }
-
-  if( !res )
+  if( !(res = g_hash_table_lookup(self->entry_lut, key)) )
   {
 #if 0
     /* missing key is ok, just return NULL - this is what real
@@ -2289,10 +2382,242 @@ gconf_client_set_list(GConfClient *client,
 void
 gconf_client_suggest_sync(GConfClient *client, GError **err)
 {
-  if( gconf_client_is_valid(client, err) ) {
-    // FIXME: do we need delayed save?
-    gconf_client_save_values(client, VALUES_PATH);
+  if( !gconf_client_is_valid(client, err) )
+  {
+    goto EXIT;
+  }
+
+  if( gconf_saver_delay <= 0 )
+  {
+    /* Delayed saving disabled via config */
+    gconf_saver_start(client);
+    gconf_saver_wait();
+  }
+  else if( !gconf_saver_timer_id )
+  {
+    /* Changes made within the delay get saved together. The
+     * timer is not restarted on every change so that saving
+     * does not get postponed indefinitely */
+    gconf_saver_timer_id = g_timeout_add(gconf_saver_delay,
+                                         gconf_saver_timer_cb, 0);
+  }
+
+EXIT:
+  return;
+}
+
+/** Write pending changes to persistent storage and wait for completion
+ *
+ * To be called on shutdown and before entering suspend.
+ */
+void
+gconf_client_flush(GConfClient *client, GError **err)
+{
+  if( !gconf_client_is_valid(client, err) )
+  {
+    goto EXIT;
+  }
+
+  if( gconf_saver_timer_id )
+  {
+    g_source_remove(gconf_saver_timer_id), gconf_saver_timer_id = 0;
+    gconf_saver_start(client);
+  }
+
+  gconf_saver_wait();
+
+EXIT:
+  return;
+}
+
+/* ========================================================================= *
+ *
+ * GConfSaver
+ *
+ * ========================================================================= */
+
+/** Serialize values and hand them over to saver thread */
+static
+void
+gconf_saver_start(GConfClient *self)
+{
+  char   *data = 0;
+  size_t  size = 0;
+
+  if( !(data = gconf_client_serialize_values(self, &size)) )
+  {
+    goto EXIT;
+  }
+
+  /* Skip write if the content would not change */
+  if( gconf_saver_last_data && gconf_saver_last_size == size &&
+      !memcmp(gconf_saver_last_data, data, size) )
+  {
+    goto EXIT;
+  }
+
+  mce_log(LL_INFO, "updating %s", VALUES_PATH);
+
+  free(gconf_saver_last_data);
+  gconf_saver_last_data = data;
+  gconf_saver_last_size = size;
+
+  gconf_saver_queue(memcpy(g_malloc(size), data, size), size), data = 0;
+
+EXIT:
+  if( data != gconf_saver_last_data )
+  {
+    free(data);
+  }
+  return;
+}
+
+/** Timer callback for saving changes after a delay */
+static
+gboolean
+gconf_saver_timer_cb(gpointer aptr)
+{
+  unused(aptr);
+
+  if( gconf_saver_timer_id )
+  {
+    gconf_saver_timer_id = 0;
+
+    if( default_client )
+    {
+      gconf_saver_start(default_client);
+    }
   }
+
+  return FALSE;
+}
+
+/** Saver thread entry point */
+static
+void *
+gconf_saver_thread_cb(void *aptr)
+{
+  unused(aptr);
+
+  pthread_mutex_lock(&gconf_saver_mutex);
+
+  for( ;; )
+  {
+    char   *data;
+    size_t  size;
+
+    while( !gconf_saver_data && !gconf_saver_exit )
+    {
+      pthread_cond_wait(&gconf_saver_cond, &gconf_saver_mutex);
+    }
+
+    if( !gconf_saver_data )
+    {
+      break;
+    }
+
+    data = gconf_saver_data, gconf_saver_data = 0;
+    size = gconf_saver_size, gconf_saver_size = 0;
+    gconf_saver_busy = true;
+
+    pthread_mutex_unlock(&gconf_saver_mutex);
+    mce_io_save_file_atomic(VALUES_PATH, data, size, 0664, FALSE);
+    g_free(data);
+    pthread_mutex_lock(&gconf_saver_mutex);
+
+    gconf_saver_busy = false;
+    pthread_cond_broadcast(&gconf_saver_cond);
+  }
+
+  pthread_mutex_unlock(&gconf_saver_mutex);
+
+  return 0;
+}
+
+/** Pass file content to saver thread
+ *
+ * Content that has not been written yet gets replaced.
+ *
+ * @param data g_malloc'ed file content; ownership is transferred
+ * @param size content length
+ */
+static
+void
+gconf_saver_queue(char *data, size_t size)
+{
+  if( !gconf_saver_thread_ok )
+  {
+    if( pthread_create(&gconf_saver_thread, 0,
+                       gconf_saver_thread_cb, 0) != 0 )
+    {
+      mce_log(LL_ERR, "failed to start saver thread; saving directly");
+      mce_io_update_file_atomic(VALUES_PATH, data, size, 0664, FALSE);
+      g_free(data);
+      goto EXIT;
+    }
+    gconf_saver_thread_ok = true;
+  }
+
+  pthread_mutex_lock(&gconf_saver_mutex);
+  g_free(gconf_saver_data);
+  gconf_saver_data = data;
+  gconf_saver_size = size;
+  pthread_cond_broadcast(&gconf_saver_cond);
+  pthread_mutex_unlock(&gconf_saver_mutex);
+
+EXIT:
+  return;
+}
+
+/** Wait until saver thread has written all queued content */
+static
+void
+gconf_saver_wait(void)
+{
+  if( !gconf_saver_thread_ok )
+  {
+    goto EXIT;
+  }
+
+  pthread_mutex_lock(&gconf_saver_mutex);
+  while( gconf_saver_data || gconf_saver_busy )
+  {
+    pthread_cond_wait(&gconf_saver_cond, &gconf_saver_mutex);
+  }
+  pthread_mutex_unlock(&gconf_saver_mutex);
+
+EXIT:
+  return;
+}
+
+/** Flush queued content and terminate saver thread */
+static
+void
+gconf_saver_quit(void)
+{
+  if( gconf_saver_timer_id )
+  {
+    g_source_remove(gconf_saver_timer_id), gconf_saver_timer_id = 0;
+
+    if( default_client )
+    {
+      gconf_saver_start(default_client);
+    }
+  }
+
+  if( gconf_saver_thread_ok )
+  {
+    pthread_mutex_lock(&gconf_saver_mutex);
+    gconf_saver_exit = true;
+    pthread_cond_broadcast(&gconf_saver_cond);
+    pthread_mutex_unlock(&gconf_saver_mutex);
+
+    pthread_join(gconf_saver_thread, 0);
+    gconf_saver_thread_ok = false;
+  }
+
+  free(gconf_saver_last_data), gconf_saver_last_data = 0;
+  gconf_saver_last_size = 0;
 }
 
 /* ========================================================================= *
@@ -2329,6 +2654,30 @@ gconf_client_notify_free_cb(gpointer self)
   gconf_client_notify_free(self);
 }
 
+/** Destroy all GConfClientNotify objects held by client */
+static
+void
+gconf_client_notify_free_all(GConfClient *client)
+{
+  GHashTableIter iter;
+  gpointer       val;
+
+  if( client->notify_ids )
+  {
+    g_hash_table_unref(client->notify_ids), client->notify_ids = 0;
+  }
+
+  if( client->notify_lut )
+  {
+    g_hash_table_iter_init(&iter, client->notify_lut);
+    while( g_hash_table_iter_next(&iter, 0, &val) )
+    {
+      g_slist_free_full(val, gconf_client_notify_free_cb);
+    }
+    g_hash_table_unref(client->notify_lut), client->notify_lut = 0;
+  }
+}
+
 /** Create GConfClientNotify object */
 static
 GConfClientNotify *
@@ -2402,7 +2751,9 @@ gconf_client_notify_change(GConfClient           *client,
   if( entry )
   {
     /* handle internal notifications */
-    for( GSList *item = client->notify_list; item; item = item->next )
+    GSList *list = g_hash_table_lookup(client->notify_lut, entry->key);
+
+    for( GSList *item = list; item; item = item->next )
     {
       GConfClientNotify *notify = item->data;
 
@@ -2411,11 +2762,8 @@ gconf_client_notify_change(GConfClient           *client,
         continue;
       }
 
-      if( !strcmp(notify->namespace_section, namespace_section) )
-      {
-        gconf_log_debug("id=%u, namespace=%s", notify->id, notify->namespace_section);
-        notify->func(client, notify->id, entry, notify->user_data);
-      }
+      gconf_log_debug("id=%u, namespace=%s", notify->id, notify->namespace_section);
+      notify->func(client, notify->id, entry, notify->user_data);
     }
 
     /* broadcast change also on dbus */
@@ -2447,7 +2795,13 @@ gconf_client_notify_add(GConfClient *client,
                                      func, user_data,
                                      destroy_notify);
 
-    client->notify_list = g_slist_prepend(client->notify_list, notify);
+    GSList *list = g_hash_table_lookup(client->notify_lut,
+                                       notify->namespace_section);
+    list = g_slist_prepend(list, notify);
+    g_hash_table_insert(client->notify_lut,
+                        g_strdup(notify->namespace_section), list);
+    g_hash_table_insert(client->notify_ids,
+                        GUINT_TO_POINTER(notify->id), notify);
   }
 
 cleanup:
@@ -2464,16 +2818,26 @@ gconf_client_notify_remove(GConfClient *client, guint cnxn)
     goto cleanup;
   }
 
-  for( GSList *item = client->notify_list; item; item = item->next )
+  GConfClientNotify *notify = g_hash_table_lookup(client->notify_ids,
+                                                  GUINT_TO_POINTER(cnxn));
+  if( notify )
   {
-    GConfClientNotify *notify = item->data;
+    GSList *list = g_hash_table_lookup(client->notify_lut,
+                                       notify->namespace_section);
+    list = g_slist_remove(list, notify);
 
-    if( notify->id == cnxn )
+    if( list )
     {
-      gconf_client_notify_free(notify);
-      client->notify_list = g_slist_delete_link(client->notify_list, item);
-      break;
+      g_hash_table_insert(client->notify_lut,
+                          g_strdup(notify->namespace_section), list);
     }
+    else
+    {
+      g_hash_table_remove(client->notify_lut, notify->namespace_section);
+    }
+
+    g_hash_table_remove(client->notify_ids, GUINT_TO_POINTER(cnxn));
+    gconf_client_notify_free(notify);
   }
 
 cleanup:
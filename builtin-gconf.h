@@ -102,7 +102,11 @@ typedef struct GConfClient
 
   GSList  *entries;
 
-  GSList  *notify_list;
+  GHashTable *entry_lut;
+
+  GHashTable *notify_lut;
+
+  GHashTable *notify_ids;
 
 } GConfClient;
 
@@ -162,6 +166,7 @@ gboolean gconf_client_set_float(GConfClient *client, const gchar *key, double va
 gboolean gconf_client_set_string(GConfClient *client, const gchar *key, const gchar *val, GError **err);
 gboolean gconf_client_set_list(GConfClient *client, const gchar *key, GConfValueType list_type, GSList *list, GError **err);
 void gconf_client_suggest_sync(GConfClient *client, GError **err);
+void gconf_client_flush(GConfClient *client, GError **err);
 guint gconf_client_notify_add(GConfClient *client, const gchar *namespace_section, GConfClientNotifyFunc func, gpointer user_data, GFreeFunc destroy_notify, GError **err);
 void gconf_client_notify_remove(GConfClient *client, guint cnxn);
 
@@ -28,6 +28,9 @@
 
 #include <linux/input.h>
 
+#include <string.h>
+#include <time.h>
+
 /* Available datapipes */
 
 /** LED brightness */
@@ -60,6 +63,9 @@ datapipe_struct display_state_req_pipe;
 /** Next (non-transitional) state of display; read only */
 datapipe_struct display_state_next_pipe;
 
+/** Display unblank is likely to be requested soon; write only */
+datapipe_struct display_preresume_pipe;
+
 /** exceptional ui state; read write */
 datapipe_struct exception_state_pipe;
 
@@ -211,6 +217,349 @@ datapipe_struct music_playback_pipe;
 /** proximity blanking; read only */
 datapipe_struct proximity_blank_pipe;
 
+/* ========================================================================= *
+ * CALLBACK VECTORS
+ * ========================================================================= */
+
+/** Minimum number of slots to allocate for a callback vector */
+#define DATAPIPE_CALLBACKS_MIN_ALLOC 4
+
+/**
+ * Initialize a callback vector to empty state
+ *
+ * @param self The callback vector
+ */
+static void datapipe_callbacks_init(datapipe_callbacks_t *self)
+{
+	self->slots = NULL;
+	self->used = 0;
+	self->allocated = 0;
+	self->active = 0;
+	self->nesting = 0;
+}
+
+/**
+ * Release dynamic resources held by a callback vector
+ *
+ * @param self The callback vector
+ */
+static void datapipe_callbacks_free(datapipe_callbacks_t *self)
+{
+	g_free(self->slots);
+	datapipe_callbacks_init(self);
+}
+
+/**
+ * Squeeze out slots that were cleared during datapipe execution
+ *
+ * @param self The callback vector
+ */
+static void datapipe_callbacks_compact(datapipe_callbacks_t *self)
+{
+	guint src, dst;
+
+	if (self->nesting > 0 || self->active == self->used)
+		goto EXIT;
+
+	for (src = dst = 0; src < self->used; src++) {
+		if (self->slots[src] != NULL)
+			self->slots[dst++] = self->slots[src];
+	}
+
+	self->used = dst;
+
+EXIT:
+	return;
+}
+
+/**
+ * Append a callback to a callback vector
+ *
+ * Appending is allowed also while the vector is being executed;
+ * the new callback will be called during the ongoing execution.
+ *
+ * @param self The callback vector
+ * @param callback The callback to add
+ */
+static void datapipe_callbacks_append(datapipe_callbacks_t *self,
+				      gpointer callback)
+{
+	if (self->used == self->allocated) {
+		guint allocated = self->allocated * 2;
+
+		if (allocated < DATAPIPE_CALLBACKS_MIN_ALLOC)
+			allocated = DATAPIPE_CALLBACKS_MIN_ALLOC;
+
+		self->slots = g_renew(gpointer, self->slots, allocated);
+		self->allocated = allocated;
+	}
+
+	self->slots[self->used++] = callback;
+	self->active++;
+}
+
+/**
+ * Remove the first instance of a callback from a callback vector
+ *
+ * Removing is allowed also while the vector is being executed;
+ * the slot is cleared and the vector compacted after execution.
+ *
+ * @param self The callback vector
+ * @param callback The callback to remove
+ *
+ * @return TRUE if the callback was removed, FALSE if it was not found
+ */
+static gboolean datapipe_callbacks_remove(datapipe_callbacks_t *self,
+					  gpointer callback)
+{
+	gboolean removed = FALSE;
+	guint i;
+
+	for (i = 0; i < self->used; i++) {
+		if (self->slots[i] == callback)
+			break;
+	}
+
+	if (i == self->used)
+		goto EXIT;
+
+	removed = TRUE;
+	self->active--;
+
+	if (self->nesting > 0) {
+		self->slots[i] = NULL;
+	} else {
+		memmove(self->slots + i, self->slots + i + 1,
+			(self->used - i - 1) * sizeof *self->slots);
+		self->used--;
+	}
+
+EXIT:
+	return removed;
+}
+
+/**
+ * Mark start of callback vector execution
+ *
+ * While execution is in progress, removed callbacks leave holes
+ * in the vector instead of shifting the remaining slots.
+ *
+ * @param self The callback vector
+ */
+static void datapipe_callbacks_enter(datapipe_callbacks_t *self)
+{
+	self->nesting++;
+}
+
+/**
+ * Mark end of callback vector execution
+ *
+ * @param self The callback vector
+ */
+static void datapipe_callbacks_leave(datapipe_callbacks_t *self)
+{
+	if (--self->nesting == 0)
+		datapipe_callbacks_compact(self);
+}
+
+/**
+ * Call all reference count triggers of a datapipe
+ *
+ * @param datapipe The datapipe
+ */
+static void datapipe_execute_refcount_triggers(datapipe_struct *const datapipe)
+{
+	datapipe_callbacks_t *vec = &datapipe->refcount_triggers;
+	void (*refcount_trigger)(void);
+	guint i;
+
+	datapipe_callbacks_enter(vec);
+
+	/* Note: vec->used and vec->slots can change during the loop */
+	for (i = 0; i < vec->used; i++) {
+		if ((refcount_trigger = vec->slots[i]) != NULL)
+			refcount_trigger();
+	}
+
+	datapipe_callbacks_leave(vec);
+}
+
+/* ========================================================================= *
+ * EXECUTION STATISTICS
+ * ========================================================================= */
+
+/** Flag for: datapipe execution timing is enabled
+ *
+ * Collecting statistics costs two clock_gettime() calls per
+ * filter / trigger call, so it is done only on request.
+ */
+static gboolean datapipe_stats_enabled = FALSE;
+
+/** Execution time histogram bucket upper limits [ns]
+ *
+ * Bucket N holds executions that took less than 10^(N+1) microseconds,
+ * the last bucket holds everything that took longer.
+ */
+static const guint64 datapipe_stats_limits[] =
+{
+	10000, 100000, 1000000, 10000000,
+};
+
+/** Get CLOCK_MONOTONIC time stamp in nanoseconds
+ */
+static guint64 datapipe_stats_get_tick(void)
+{
+	guint64 res = 0;
+
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+		res = ts.tv_sec;
+		res *= 1000000000;
+		res += ts.tv_nsec;
+	}
+
+	return res;
+}
+
+/**
+ * Account time spent in a single filter / trigger call
+ *
+ * @param datapipe The datapipe being executed
+ * @param callback The filter / trigger that was called
+ * @param duration Time spent in the callback [ns]
+ */
+static void datapipe_stats_callback(datapipe_struct *const datapipe,
+				    gpointer callback, guint64 duration)
+{
+	if (datapipe->stats.worst_callback_time < duration) {
+		datapipe->stats.worst_callback_time = duration;
+		datapipe->stats.worst_callback = callback;
+	}
+}
+
+/**
+ * Account time spent in one datapipe execution stage
+ *
+ * @param total Cumulative time of the stage
+ * @param max   Longest time of the stage
+ * @param duration Time spent in the stage [ns]
+ */
+static void datapipe_stats_stage(guint64 *total, guint64 *max,
+				 guint64 duration)
+{
+	*total += duration;
+	if (*max < duration)
+		*max = duration;
+}
+
+/**
+ * Account one full datapipe execution
+ *
+ * @param datapipe The datapipe that was executed
+ * @param duration Time spent in the execution [ns]
+ */
+static void datapipe_stats_execution(datapipe_struct *const datapipe,
+				     guint64 duration)
+{
+	mce_hist_add(&datapipe->stats.execution, duration);
+}
+
+/**
+ * Clear execution statistics of a datapipe
+ *
+ * @param stats The statistics to clear
+ */
+static void datapipe_stats_clear(datapipe_stats_t *stats)
+{
+	memset(stats, 0, sizeof *stats);
+	stats->execution = (mce_hist_t)MCE_HIST_INIT(NULL,
+						     datapipe_stats_limits);
+}
+
+/* ========================================================================= *
+ * CHANGE SUPPRESSION
+ * ========================================================================= */
+
+/**
+ * Forget the value last passed to output triggers
+ *
+ * @param datapipe The datapipe
+ */
+static void datapipe_notify_forget(datapipe_struct *const datapipe)
+{
+	if (datapipe->datasize != 0)
+		g_free(datapipe->notified_data);
+
+	datapipe->notified_data = NULL;
+	datapipe->notified = FALSE;
+}
+
+/**
+ * Remember the value passed to output triggers
+ *
+ * For datapipes with non-zero datasize the payload is copied,
+ * otherwise the pointer value itself is the data.
+ *
+ * @param datapipe The datapipe
+ * @param data The data passed to output triggers
+ */
+static void datapipe_notify_remember(datapipe_struct *const datapipe,
+				     gconstpointer data)
+{
+	gpointer copy = (gpointer)data;
+
+	if (datapipe->notify_on_change != NOTIFY_ON_CHANGE)
+		goto EXIT;
+
+	if (datapipe->datasize != 0 && data != NULL)
+		copy = g_memdup(data, datapipe->datasize);
+
+	datapipe_notify_forget(datapipe);
+
+	datapipe->notified_data = copy;
+	datapipe->notified = TRUE;
+
+EXIT:
+	return;
+}
+
+/**
+ * Check whether output triggers have already seen the given value
+ *
+ * @param datapipe The datapipe
+ * @param data The data about to be passed to output triggers
+ *
+ * @return TRUE if output triggers can be skipped, FALSE otherwise
+ */
+static gboolean datapipe_notify_is_unchanged(datapipe_struct *const datapipe,
+					     gconstpointer data)
+{
+	gboolean unchanged = FALSE;
+
+	if (datapipe->notify_on_change != NOTIFY_ON_CHANGE)
+		goto EXIT;
+
+	/* The first value always goes through */
+	if (!datapipe->notified)
+		goto EXIT;
+
+	if (datapipe->datasize == 0 ||
+	    data == NULL || datapipe->notified_data == NULL) {
+		unchanged = (data == datapipe->notified_data);
+	} else {
+		unchanged = !memcmp(data, datapipe->notified_data,
+				    datapipe->datasize);
+	}
+
+EXIT:
+	return unchanged;
+}
+
+/* ========================================================================= *
+ * DATAPIPE EXECUTION
+ * ========================================================================= */
+
 /**
  * Execute the input triggers of a datapipe
  *
@@ -227,8 +576,10 @@ void execute_datapipe_input_triggers(datapipe_struct *const datapipe,
 				     const caching_policy_t cache_indata)
 {
 	void (*trigger)(gconstpointer const input);
+	datapipe_callbacks_t *vec;
 	gpointer data;
-	gint i;
+	guint64 t_beg, t0, t1;
+	guint i;
 
 	if (datapipe == NULL) {
 		/* Potential memory leak! */
@@ -249,11 +600,36 @@ void execute_datapipe_input_triggers(datapipe_struct *const datapipe,
 		}
 	}
 
-	for (i = 0; (trigger = g_slist_nth_data(datapipe->input_triggers,
-						i)) != NULL; i++) {
+	vec = &datapipe->input_triggers;
+	datapipe_callbacks_enter(vec);
+
+	if (!datapipe_stats_enabled) {
+		for (i = 0; i < vec->used; i++) {
+			if ((trigger = vec->slots[i]) != NULL)
+				trigger(data);
+		}
+		goto LEAVE;
+	}
+
+	t_beg = t0 = datapipe_stats_get_tick();
+
+	for (i = 0; i < vec->used; i++) {
+		if ((trigger = vec->slots[i]) == NULL)
+			continue;
+
 		trigger(data);
+
+		t1 = datapipe_stats_get_tick();
+		datapipe_stats_callback(datapipe, trigger, t1 - t0);
+		t0 = t1;
 	}
 
+	datapipe_stats_stage(&datapipe->stats.input_time,
+			     &datapipe->stats.input_max, t0 - t_beg);
+
+LEAVE:
+	datapipe_callbacks_leave(vec);
+
 EXIT:
 	return;
 }
@@ -272,9 +648,13 @@ gconstpointer execute_datapipe_filters(datapipe_struct *const datapipe,
 				       const data_source_t use_cache)
 {
 	gpointer (*filter)(gpointer input);
+	datapipe_callbacks_t *vec;
 	gpointer data;
 	gconstpointer retval = NULL;
-	gint i;
+	guint applied = 0;
+	gboolean timed;
+	guint64 t_beg = 0, t0 = 0, t1;
+	guint i;
 
 	if (datapipe == NULL) {
 		mce_log(LL_ERR,
@@ -285,20 +665,46 @@ gconstpointer execute_datapipe_filters(datapipe_struct *const datapipe,
 
 	data = (use_cache == USE_CACHE) ? datapipe->cached_data : indata;
 
-	for (i = 0; (filter = g_slist_nth_data(datapipe->filters,
-					       i)) != NULL; i++) {
-		gpointer tmp = filter(data);
+	vec = &datapipe->filters;
+	datapipe_callbacks_enter(vec);
+
+	timed = datapipe_stats_enabled;
+
+	if (timed)
+		t_beg = t0 = datapipe_stats_get_tick();
+
+	for (i = 0; i < vec->used; i++) {
+		gpointer tmp;
+
+		if ((filter = vec->slots[i]) == NULL)
+			continue;
+
+		tmp = filter(data);
 
 		/* If the data needs to be freed, and this isn't the indata,
 		 * or if we're not using the cache, then free the data
 		 */
 		if ((datapipe->free_cache == FREE_CACHE) &&
-		    ((i > 0) || (use_cache == USE_INDATA)))
+		    ((applied > 0) || (use_cache == USE_INDATA)))
 			g_free(data);
 
 		data = tmp;
+		applied++;
+
+		if (!timed)
+			continue;
+
+		t1 = datapipe_stats_get_tick();
+		datapipe_stats_callback(datapipe, filter, t1 - t0);
+		t0 = t1;
 	}
 
+	if (timed)
+		datapipe_stats_stage(&datapipe->stats.filter_time,
+				     &datapipe->stats.filter_max, t0 - t_beg);
+
+	datapipe_callbacks_leave(vec);
+
 	retval = data;
 
 EXIT:
@@ -313,13 +719,15 @@ EXIT:
  * @param use_cache USE_CACHE to use data from cache,
  *                  USE_INDATA to use indata
  */
-void execute_datapipe_output_triggers(const datapipe_struct *const datapipe,
+void execute_datapipe_output_triggers(datapipe_struct *const datapipe,
 				      gconstpointer indata,
 				      const data_source_t use_cache)
 {
 	void (*trigger)(gconstpointer input);
+	datapipe_callbacks_t *vec;
 	gconstpointer data;
-	gint i;
+	guint64 t_beg, t0, t1;
+	guint i;
 
 	if (datapipe == NULL) {
 		mce_log(LL_ERR,
@@ -330,18 +738,182 @@ void execute_datapipe_output_triggers(const datapipe_struct *const datapipe,
 
 	data = (use_cache == USE_CACHE) ? datapipe->cached_data : indata;
 
-	for (i = 0; (trigger = g_slist_nth_data(datapipe->output_triggers,
-						i)) != NULL; i++) {
+	datapipe_notify_remember(datapipe, data);
+
+	vec = &datapipe->output_triggers;
+	datapipe_callbacks_enter(vec);
+
+	if (!datapipe_stats_enabled) {
+		for (i = 0; i < vec->used; i++) {
+			if ((trigger = vec->slots[i]) != NULL)
+				trigger(data);
+		}
+		goto LEAVE;
+	}
+
+	t_beg = t0 = datapipe_stats_get_tick();
+
+	for (i = 0; i < vec->used; i++) {
+		if ((trigger = vec->slots[i]) == NULL)
+			continue;
+
 		trigger(data);
+
+		t1 = datapipe_stats_get_tick();
+		datapipe_stats_callback(datapipe, trigger, t1 - t0);
+		t0 = t1;
 	}
 
+	datapipe_stats_stage(&datapipe->stats.output_time,
+			     &datapipe->stats.output_max, t0 - t_beg);
+
+LEAVE:
+	datapipe_callbacks_leave(vec);
+
 EXIT:
 	return;
 }
 
+/**
+ * Execute the datapipe without deferring
+ *
+ * @param datapipe The datapipe to execute
+ * @param indata The input data to run through the datapipe
+ * @param use_cache USE_CACHE to use data from cache,
+ *                  USE_INDATA to use indata
+ * @param cache_indata CACHE_INDATA to cache the indata,
+ *                     DONT_CACHE_INDATA to keep the old data
+ * @return The processed data
+ */
+static gconstpointer datapipe_execute_immediately(datapipe_struct *const datapipe,
+						  gpointer indata,
+						  const data_source_t use_cache,
+						  const caching_policy_t cache_indata)
+{
+	gconstpointer data = NULL;
+	gboolean timed = datapipe_stats_enabled;
+	guint64 t_beg = 0;
+
+	/* Cheap unformatted trace for post-mortem flight recorder dumps */
+	mce_log_record(LL_DEBUG, __FILE__, __FUNCTION__, "%s: %p",
+		       datapipe->name ?: "unknown", indata);
+
+	if (timed)
+		t_beg = datapipe_stats_get_tick();
+
+	execute_datapipe_input_triggers(datapipe, indata, use_cache,
+					cache_indata);
+
+	if (datapipe->read_only == READ_ONLY) {
+		data = indata;
+	} else {
+		data = execute_datapipe_filters(datapipe, indata, use_cache);
+	}
+
+	/* With NOTIFY_ON_CHANGE policy repeated values are
+	 * not passed to output triggers */
+	if (!datapipe_notify_is_unchanged(datapipe, data))
+		execute_datapipe_output_triggers(datapipe, data, USE_INDATA);
+
+	if (timed)
+		datapipe_stats_execution(datapipe,
+					 datapipe_stats_get_tick() - t_beg);
+
+	return data;
+}
+
+/**
+ * Execute the triggers of a deferred datapipe write
+ *
+ * Filters have already been applied and the cache updated when
+ * the write was made, only the triggers are left to execute.
+ *
+ * @param datapipe The datapipe to execute
+ */
+static void datapipe_execute_deferred(datapipe_struct *const datapipe)
+{
+	gconstpointer data = datapipe->coalesce_outdata;
+	gboolean timed = datapipe_stats_enabled;
+	guint64 t_beg = 0;
+
+	mce_log_record(LL_DEBUG, __FILE__, __FUNCTION__, "%s: %p",
+		       datapipe->name ?: "unknown", datapipe->coalesce_data);
+
+	if (timed)
+		t_beg = datapipe_stats_get_tick();
+
+	execute_datapipe_input_triggers(datapipe, datapipe->coalesce_data,
+					USE_INDATA, DONT_CACHE_INDATA);
+
+	if (!datapipe_notify_is_unchanged(datapipe, data))
+		execute_datapipe_output_triggers(datapipe, data, USE_INDATA);
+
+	if (timed)
+		datapipe_stats_execution(datapipe,
+					 datapipe_stats_get_tick() - t_beg);
+}
+
+/**
+ * Idle callback for executing a coalesced datapipe
+ *
+ * @param aptr The datapipe to execute
+ *
+ * @return FALSE to stop the idle callback from repeating
+ */
+static gboolean datapipe_coalesce_cb(gpointer aptr)
+{
+	datapipe_struct *datapipe = aptr;
+
+	if (!datapipe->coalesce_id)
+		goto EXIT;
+
+	datapipe->coalesce_id = 0;
+
+	datapipe_execute_deferred(datapipe);
+
+EXIT:
+	return FALSE;
+}
+
+/**
+ * Cancel pending coalesced execution of a datapipe
+ *
+ * @param datapipe The datapipe
+ *
+ * @return TRUE if execution was pending, FALSE otherwise
+ */
+static gboolean datapipe_coalesce_cancel(datapipe_struct *const datapipe)
+{
+	gboolean pending = FALSE;
+
+	if (datapipe->coalesce_id) {
+		g_source_remove(datapipe->coalesce_id),
+			datapipe->coalesce_id = 0;
+		pending = TRUE;
+	}
+
+	return pending;
+}
+
+/**
+ * Execute pending coalesced write to a datapipe right away
+ *
+ * @param datapipe The datapipe
+ */
+static void datapipe_coalesce_flush(datapipe_struct *const datapipe)
+{
+	if (datapipe_coalesce_cancel(datapipe))
+		datapipe_execute_deferred(datapipe);
+}
+
 /**
  * Execute the datapipe
  *
+ * If the datapipe has been set up with EXECUTE_COALESCED policy,
+ * filters are applied and the cache is updated immediately, but
+ * the triggers of cacheable writes are deferred to an idle callback
+ * and executed only for the latest value.
+ *
  * @param datapipe The datapipe to execute
  * @param indata The input data to run through the datapipe
  * @param use_cache USE_CACHE to use data from cache,
@@ -364,16 +936,42 @@ gconstpointer execute_datapipe(datapipe_struct *const datapipe,
 		goto EXIT;
 	}
 
-	execute_datapipe_input_triggers(datapipe, indata, use_cache,
-					cache_indata);
+	if (datapipe->coalesce == EXECUTE_COALESCED) {
+		/* Only by-value writes that update the cache can
+		 * be deferred; anything else executes the pending
+		 * write first and then proceeds synchronously */
+		if ((use_cache == USE_INDATA) &&
+		    (cache_indata == CACHE_INDATA) &&
+		    (datapipe->free_cache == DONT_FREE_CACHE)) {
+			/* Filter and cache right away so that the
+			 * datapipe can be read back consistently;
+			 * only the triggers are deferred */
+			if (datapipe->read_only == READ_ONLY)
+				data = indata;
+			else
+				data = execute_datapipe_filters(datapipe,
+								indata,
+								USE_INDATA);
+
+			datapipe->cached_data = (gpointer)data;
+			datapipe->coalesce_data = indata;
+			datapipe->coalesce_outdata = data;
+
+			if (!datapipe->coalesce_id) {
+				datapipe->coalesce_id =
+					g_idle_add_full(G_PRIORITY_HIGH_IDLE,
+							datapipe_coalesce_cb,
+							datapipe, 0);
+			}
+
+			goto EXIT;
+		}
 
-	if (datapipe->read_only == READ_ONLY) {
-		data = indata;
-	} else {
-		data = execute_datapipe_filters(datapipe, indata, use_cache);
+		datapipe_coalesce_flush(datapipe);
 	}
 
-	execute_datapipe_output_triggers(datapipe, data, USE_INDATA);
+	data = datapipe_execute_immediately(datapipe, indata, use_cache,
+					    cache_indata);
 
 EXIT:
 	return data;
@@ -388,9 +986,6 @@ EXIT:
 void append_filter_to_datapipe(datapipe_struct *const datapipe,
 			       gpointer (*filter)(gpointer data))
 {
-	void (*refcount_trigger)(void);
-	gint i;
-
 	if (datapipe == NULL) {
 		mce_log(LL_ERR,
 			"append_filter_to_datapipe() called "
@@ -412,11 +1007,9 @@ void append_filter_to_datapipe(datapipe_struct *const datapipe,
 		goto EXIT;
 	}
 
-	datapipe->filters = g_slist_append(datapipe->filters, filter);
+	datapipe_callbacks_append(&datapipe->filters, filter);
 
-	for (i = 0; (refcount_trigger = g_slist_nth_data(datapipe->refcount_triggers, i)) != NULL; i++) {
-		refcount_trigger();
-	}
+	datapipe_execute_refcount_triggers(datapipe);
 
 EXIT:
 	return;
@@ -432,10 +1025,6 @@ EXIT:
 void remove_filter_from_datapipe(datapipe_struct *const datapipe,
 				 gpointer (*filter)(gpointer data))
 {
-	void (*refcount_trigger)(void);
-	guint oldlen;
-	gint i;
-
 	if (datapipe == NULL) {
 		mce_log(LL_ERR,
 			"remove_filter_from_datapipe() called "
@@ -457,20 +1046,14 @@ void remove_filter_from_datapipe(datapipe_struct *const datapipe,
 		goto EXIT;
 	}
 
-	oldlen = g_slist_length(datapipe->filters);
-
-	datapipe->filters = g_slist_remove(datapipe->filters, filter);
-
 	/* Did we remove any entry? */
-	if (oldlen == g_slist_length(datapipe->filters)) {
+	if (!datapipe_callbacks_remove(&datapipe->filters, filter)) {
 		mce_log(LL_DEBUG,
 			"Trying to remove non-existing filter");
 		goto EXIT;
 	}
 
-	for (i = 0; (refcount_trigger = g_slist_nth_data(datapipe->refcount_triggers, i)) != NULL; i++) {
-		refcount_trigger();
-	}
+	datapipe_execute_refcount_triggers(datapipe);
 
 EXIT:
 	return;
@@ -485,9 +1068,6 @@ EXIT:
 void append_input_trigger_to_datapipe(datapipe_struct *const datapipe,
 				      void (*trigger)(gconstpointer data))
 {
-	void (*refcount_trigger)(void);
-	gint i;
-
 	if (datapipe == NULL) {
 		mce_log(LL_ERR,
 			"append_input_trigger_to_datapipe() called "
@@ -502,12 +1082,9 @@ void append_input_trigger_to_datapipe(datapipe_struct *const datapipe,
 		goto EXIT;
 	}
 
-	datapipe->input_triggers = g_slist_append(datapipe->input_triggers,
-						  trigger);
+	datapipe_callbacks_append(&datapipe->input_triggers, trigger);
 
-	for (i = 0; (refcount_trigger = g_slist_nth_data(datapipe->refcount_triggers, i)) != NULL; i++) {
-		refcount_trigger();
-	}
+	datapipe_execute_refcount_triggers(datapipe);
 
 EXIT:
 	return;
@@ -523,10 +1100,6 @@ EXIT:
 void remove_input_trigger_from_datapipe(datapipe_struct *const datapipe,
 					void (*trigger)(gconstpointer data))
 {
-	void (*refcount_trigger)(void);
-	guint oldlen;
-	gint i;
-
 	if (datapipe == NULL) {
 		mce_log(LL_ERR,
 			"remove_input_trigger_from_datapipe() called "
@@ -541,21 +1114,14 @@ void remove_input_trigger_from_datapipe(datapipe_struct *const datapipe,
 		goto EXIT;
 	}
 
-	oldlen = g_slist_length(datapipe->input_triggers);
-
-	datapipe->input_triggers = g_slist_remove(datapipe->input_triggers,
-						  trigger);
-
 	/* Did we remove any entry? */
-	if (oldlen == g_slist_length(datapipe->input_triggers)) {
+	if (!datapipe_callbacks_remove(&datapipe->input_triggers, trigger)) {
 		mce_log(LL_DEBUG,
 			"Trying to remove non-existing input trigger");
 		goto EXIT;
 	}
 
-	for (i = 0; (refcount_trigger = g_slist_nth_data(datapipe->refcount_triggers, i)) != NULL; i++) {
-		refcount_trigger();
-	}
+	datapipe_execute_refcount_triggers(datapipe);
 
 EXIT:
 	return;
@@ -570,9 +1136,6 @@ EXIT:
 void append_output_trigger_to_datapipe(datapipe_struct *const datapipe,
 				       void (*trigger)(gconstpointer data))
 {
-	void (*refcount_trigger)(void);
-	gint i;
-
 	if (datapipe == NULL) {
 		mce_log(LL_ERR,
 			"append_output_trigger_to_datapipe() called "
@@ -587,12 +1150,9 @@ void append_output_trigger_to_datapipe(datapipe_struct *const datapipe,
 		goto EXIT;
 	}
 
-	datapipe->output_triggers = g_slist_append(datapipe->output_triggers,
-						   trigger);
+	datapipe_callbacks_append(&datapipe->output_triggers, trigger);
 
-	for (i = 0; (refcount_trigger = g_slist_nth_data(datapipe->refcount_triggers, i)) != NULL; i++) {
-		refcount_trigger();
-	}
+	datapipe_execute_refcount_triggers(datapipe);
 
 EXIT:
 	return;
@@ -608,10 +1168,6 @@ EXIT:
 void remove_output_trigger_from_datapipe(datapipe_struct *const datapipe,
 					 void (*trigger)(gconstpointer data))
 {
-	void (*refcount_trigger)(void);
-	guint oldlen;
-	gint i;
-
 	if (datapipe == NULL) {
 		mce_log(LL_ERR,
 			"remove_output_trigger_from_datapipe() called "
@@ -626,21 +1182,14 @@ void remove_output_trigger_from_datapipe(datapipe_struct *const datapipe,
 		goto EXIT;
 	}
 
-	oldlen = g_slist_length(datapipe->output_triggers);
-
-	datapipe->output_triggers = g_slist_remove(datapipe->output_triggers,
-						   trigger);
-
 	/* Did we remove any entry? */
-	if (oldlen == g_slist_length(datapipe->output_triggers)) {
+	if (!datapipe_callbacks_remove(&datapipe->output_triggers, trigger)) {
 		mce_log(LL_DEBUG,
 			"Trying to remove non-existing output trigger");
 		goto EXIT;
 	}
 
-	for (i = 0; (refcount_trigger = g_slist_nth_data(datapipe->refcount_triggers, i)) != NULL; i++) {
-		refcount_trigger();
-	}
+	datapipe_execute_refcount_triggers(datapipe);
 
 EXIT:
 	return;
@@ -669,7 +1218,7 @@ void append_refcount_trigger_to_datapipe(datapipe_struct *const datapipe,
 		goto EXIT;
 	}
 
-	datapipe->refcount_triggers = g_slist_append(datapipe->refcount_triggers, trigger);
+	datapipe_callbacks_append(&datapipe->refcount_triggers, trigger);
 
 EXIT:
 	return;
@@ -685,8 +1234,6 @@ EXIT:
 void remove_refcount_trigger_from_datapipe(datapipe_struct *const datapipe,
 					   void (*trigger)(void))
 {
-	guint oldlen;
-
 	if (datapipe == NULL) {
 		mce_log(LL_ERR,
 			"remove_refcount_trigger_from_datapipe() called "
@@ -701,12 +1248,8 @@ void remove_refcount_trigger_from_datapipe(datapipe_struct *const datapipe,
 		goto EXIT;
 	}
 
-	oldlen = g_slist_length(datapipe->refcount_triggers);
-
-	datapipe->refcount_triggers = g_slist_remove(datapipe->refcount_triggers, trigger);
-
 	/* Did we remove any entry? */
-	if (oldlen == g_slist_length(datapipe->refcount_triggers)) {
+	if (!datapipe_callbacks_remove(&datapipe->refcount_triggers, trigger)) {
 		mce_log(LL_DEBUG,
 			"Trying to remove non-existing refcount trigger");
 		goto EXIT;
@@ -724,6 +1267,12 @@ EXIT:
  *                  READ_WRITE if it's read/write
  * @param free_cache FREE_CACHE if the cached data needs to be freed,
  *                   DONT_FREE_CACHE if the cache data should not be freed
+ * @param execution EXECUTE_COALESCED if writes should be deferred and
+ *                  coalesced to one execution per main loop iteration,
+ *                  EXECUTE_IMMEDIATELY if every write executes the datapipe
+ * @param notify NOTIFY_ON_CHANGE if output triggers should be skipped
+ *               when the data equals what they were last passed,
+ *               NOTIFY_ALWAYS if output triggers run on every execution
  * @param datasize Pass size of memory to copy,
  *		   or 0 if only passing pointers or data as pointers
  * @param initial_data Initial cache content
@@ -731,6 +1280,8 @@ EXIT:
 void setup_datapipe(datapipe_struct *const datapipe,
 		    const read_only_policy_t read_only,
 		    const cache_free_policy_t free_cache,
+		    const execution_policy_t execution,
+		    const change_policy_t notify,
 		    const gsize datasize, gpointer initial_data)
 {
 	if (datapipe == NULL) {
@@ -740,14 +1291,22 @@ void setup_datapipe(datapipe_struct *const datapipe,
 		goto EXIT;
 	}
 
-	datapipe->filters = NULL;
-	datapipe->input_triggers = NULL;
-	datapipe->output_triggers = NULL;
-	datapipe->refcount_triggers = NULL;
+	datapipe_callbacks_init(&datapipe->filters);
+	datapipe_callbacks_init(&datapipe->input_triggers);
+	datapipe_callbacks_init(&datapipe->output_triggers);
+	datapipe_callbacks_init(&datapipe->refcount_triggers);
 	datapipe->datasize = datasize;
 	datapipe->read_only = read_only;
 	datapipe->free_cache = free_cache;
+	datapipe->coalesce = execution;
+	datapipe->coalesce_id = 0;
+	datapipe->coalesce_data = NULL;
+	datapipe->coalesce_outdata = NULL;
+	datapipe->notify_on_change = notify;
+	datapipe->notified = FALSE;
+	datapipe->notified_data = NULL;
 	datapipe->cached_data = initial_data;
+	datapipe_stats_clear(&datapipe->stats);
 
 EXIT:
 	return;
@@ -768,30 +1327,40 @@ void free_datapipe(datapipe_struct *const datapipe)
 	}
 
 	/* Warn about still registered filters/triggers */
-	if (datapipe->filters != NULL) {
+	if (datapipe->filters.active != 0) {
 		mce_log(LL_INFO,
 			"free_datapipe() called on a datapipe that "
 			"still has registered filter(s)");
 	}
 
-	if (datapipe->input_triggers != NULL) {
+	if (datapipe->input_triggers.active != 0) {
 		mce_log(LL_INFO,
 			"free_datapipe() called on a datapipe that "
 			"still has registered input_trigger(s)");
 	}
 
-	if (datapipe->output_triggers != NULL) {
+	if (datapipe->output_triggers.active != 0) {
 		mce_log(LL_INFO,
 			"free_datapipe() called on a datapipe that "
 			"still has registered output_trigger(s)");
 	}
 
-	if (datapipe->refcount_triggers != NULL) {
+	if (datapipe->refcount_triggers.active != 0) {
 		mce_log(LL_INFO,
 			"free_datapipe() called on a datapipe that "
 			"still has registered refcount_trigger(s)");
 	}
 
+	/* Pending deferred writes are just dropped */
+	datapipe_coalesce_cancel(datapipe);
+
+	datapipe_notify_forget(datapipe);
+
+	datapipe_callbacks_free(&datapipe->filters);
+	datapipe_callbacks_free(&datapipe->input_triggers);
+	datapipe_callbacks_free(&datapipe->output_triggers);
+	datapipe_callbacks_free(&datapipe->refcount_triggers);
+
 	if (datapipe->free_cache == FREE_CACHE) {
 		g_free(datapipe->cached_data);
 	}
@@ -800,131 +1369,323 @@ EXIT:
 	return;
 }
 
+/** Lookup table of datapipes and their names, for statistics */
+static const struct
+{
+	datapipe_struct *datapipe;
+	const char *name;
+} datapipe_name_lut[] =
+{
+	{ &led_brightness_pipe, "led_brightness" },
+	{ &lpm_brightness_pipe, "lpm_brightness" },
+	{ &device_inactive_pipe, "device_inactive" },
+	{ &led_pattern_activate_pipe, "led_pattern_activate" },
+	{ &led_pattern_deactivate_pipe, "led_pattern_deactivate" },
+	{ &device_resumed_pipe, "device_resumed" },
+	{ &user_activity_pipe, "user_activity" },
+	{ &display_state_pipe, "display_state" },
+	{ &display_state_req_pipe, "display_state_req" },
+	{ &display_state_next_pipe, "display_state_next" },
+	{ &display_preresume_pipe, "display_preresume" },
+	{ &exception_state_pipe, "exception_state" },
+	{ &display_brightness_pipe, "display_brightness" },
+	{ &key_backlight_pipe, "key_backlight" },
+	{ &keypress_pipe, "keypress" },
+	{ &touchscreen_pipe, "touchscreen" },
+	{ &lockkey_pipe, "lockkey" },
+	{ &keyboard_slide_pipe, "keyboard_slide" },
+	{ &keyboard_available_pipe, "keyboard_available" },
+	{ &lid_sensor_is_working_pipe, "lid_sensor_is_working" },
+	{ &lid_cover_sensor_pipe, "lid_cover_sensor" },
+	{ &lid_cover_policy_pipe, "lid_cover_policy" },
+	{ &lens_cover_pipe, "lens_cover" },
+	{ &proximity_sensor_pipe, "proximity_sensor" },
+	{ &ambient_light_sensor_pipe, "ambient_light_sensor" },
+	{ &ambient_light_level_pipe, "ambient_light_level" },
+	{ &orientation_sensor_pipe, "orientation_sensor" },
+	{ &alarm_ui_state_pipe, "alarm_ui_state" },
+	{ &system_state_pipe, "system_state" },
+	{ &master_radio_pipe, "master_radio" },
+	{ &submode_pipe, "submode" },
+	{ &call_state_pipe, "call_state" },
+	{ &call_type_pipe, "call_type" },
+	{ &tk_lock_pipe, "tk_lock" },
+	{ &charger_state_pipe, "charger_state" },
+	{ &battery_status_pipe, "battery_status" },
+	{ &battery_level_pipe, "battery_level" },
+	{ &camera_button_pipe, "camera_button" },
+	{ &inactivity_timeout_pipe, "inactivity_timeout" },
+	{ &audio_route_pipe, "audio_route" },
+	{ &usb_cable_pipe, "usb_cable" },
+	{ &jack_sense_pipe, "jack_sense" },
+	{ &power_saving_mode_pipe, "power_saving_mode" },
+	{ &thermal_state_pipe, "thermal_state" },
+	{ &heartbeat_pipe, "heartbeat" },
+	{ &compositor_available_pipe, "compositor_available" },
+	{ &lipstick_available_pipe, "lipstick_available" },
+	{ &usbmoded_available_pipe, "usbmoded_available" },
+	{ &ngfd_available_pipe, "ngfd_available" },
+	{ &dsme_available_pipe, "dsme_available" },
+	{ &packagekit_locked_pipe, "packagekit_locked" },
+	{ &update_mode_pipe, "update_mode" },
+	{ &shutting_down_pipe, "shutting_down" },
+	{ &device_lock_state_pipe, "device_lock_state" },
+	{ &touch_grab_wanted_pipe, "touch_grab_wanted" },
+	{ &touch_grab_active_pipe, "touch_grab_active" },
+	{ &keypad_grab_wanted_pipe, "keypad_grab_wanted" },
+	{ &keypad_grab_active_pipe, "keypad_grab_active" },
+	{ &music_playback_pipe, "music_playback" },
+	{ &proximity_blank_pipe, "proximity_blank" },
+	{ NULL, NULL }
+};
+
+/**
+ * Iterate over execution statistics of all datapipes
+ *
+ * @param cb        Callback to call for each datapipe
+ * @param user_data Data to pass to the callback
+ */
+void datapipe_stats_foreach(void (*cb)(const char *name,
+				       const datapipe_stats_t *stats,
+				       gpointer user_data),
+			    gpointer user_data)
+{
+	gint i;
+
+	for (i = 0; datapipe_name_lut[i].datapipe; i++) {
+		cb(datapipe_name_lut[i].name,
+		   &datapipe_name_lut[i].datapipe->stats, user_data);
+	}
+}
+
+/**
+ * Enable / disable collecting datapipe execution statistics
+ *
+ * @param enabled TRUE to start timing datapipe executions,
+ *                FALSE to stop
+ */
+void datapipe_stats_set_enabled(gboolean enabled)
+{
+	if (datapipe_stats_enabled != enabled) {
+		datapipe_stats_enabled = enabled;
+		mce_log(LL_DEVEL, "datapipe statistics %s",
+			enabled ? "enabled" : "disabled");
+	}
+}
+
+/**
+ * Check whether datapipe execution statistics are collected
+ *
+ * @return TRUE if enabled, FALSE otherwise
+ */
+gboolean datapipe_stats_get_enabled(void)
+{
+	return datapipe_stats_enabled;
+}
+
+/**
+ * Reset execution statistics of all datapipes
+ */
+void datapipe_stats_reset(void)
+{
+	gint i;
+
+	for (i = 0; datapipe_name_lut[i].datapipe; i++) {
+		datapipe_stats_clear(&datapipe_name_lut[i].datapipe->stats);
+	}
+}
+
 /** Setup all datapipes
  */
 void mce_datapipe_init(void)
 {
 	setup_datapipe(&system_state_pipe, READ_WRITE, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(MCE_STATE_UNDEF));
 	setup_datapipe(&master_radio_pipe, READ_WRITE, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(0));
 	setup_datapipe(&call_state_pipe, READ_WRITE, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(CALL_STATE_NONE));
 	setup_datapipe(&call_type_pipe, READ_WRITE, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(NORMAL_CALL));
 	setup_datapipe(&alarm_ui_state_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(MCE_ALARM_UI_INVALID_INT32));
 	setup_datapipe(&submode_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(MCE_NORMAL_SUBMODE));
 	setup_datapipe(&display_state_pipe, READ_WRITE, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ON_CHANGE,
 		       0, GINT_TO_POINTER(MCE_DISPLAY_UNDEF));
 	setup_datapipe(&display_state_req_pipe, READ_WRITE, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(MCE_DISPLAY_UNDEF));
 	setup_datapipe(&display_state_next_pipe, READ_WRITE, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(MCE_DISPLAY_UNDEF));
+	setup_datapipe(&display_preresume_pipe, READ_WRITE, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
+		       0, GINT_TO_POINTER(FALSE));
 	setup_datapipe(&exception_state_pipe, READ_WRITE, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(UIEXC_NONE));
 	setup_datapipe(&display_brightness_pipe, READ_WRITE, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(3));
 	setup_datapipe(&led_brightness_pipe, READ_WRITE, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(0));
 	setup_datapipe(&lpm_brightness_pipe, READ_WRITE, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(0));
 	setup_datapipe(&led_pattern_activate_pipe, READ_ONLY, FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, NULL);
 	setup_datapipe(&device_resumed_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, NULL);
 	setup_datapipe(&led_pattern_deactivate_pipe, READ_ONLY, FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, NULL);
 	setup_datapipe(&user_activity_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, NULL);
 	setup_datapipe(&key_backlight_pipe, READ_WRITE, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(0));
 	setup_datapipe(&keypress_pipe, READ_ONLY, FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       sizeof (struct input_event), NULL);
 	setup_datapipe(&touchscreen_pipe, READ_ONLY, FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       sizeof (struct input_event), NULL);
 	setup_datapipe(&device_inactive_pipe, READ_WRITE, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(TRUE));
 	setup_datapipe(&lockkey_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(0));
 	setup_datapipe(&keyboard_slide_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(COVER_CLOSED));
 	setup_datapipe(&keyboard_available_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(COVER_CLOSED));
-	setup_datapipe(&lid_sensor_is_working_pipe, READ_WRITE,
-		       DONT_FREE_CACHE, 0, GINT_TO_POINTER(FALSE));
+	setup_datapipe(&lid_sensor_is_working_pipe, READ_WRITE, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
+		       0, GINT_TO_POINTER(FALSE));
 	setup_datapipe(&lid_cover_sensor_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(COVER_UNDEF));
 	setup_datapipe(&lid_cover_policy_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(COVER_UNDEF));
 	setup_datapipe(&lens_cover_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(0));
 	setup_datapipe(&proximity_sensor_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(COVER_OPEN));
 	setup_datapipe(&ambient_light_sensor_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_COALESCED, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(400));
 	setup_datapipe(&ambient_light_level_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(400));
 	setup_datapipe(&orientation_sensor_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_COALESCED, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(MCE_ORIENTATION_UNDEFINED));
 	setup_datapipe(&tk_lock_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(LOCK_UNDEF));
 	setup_datapipe(&charger_state_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ON_CHANGE,
 		       0, GINT_TO_POINTER(CHARGER_STATE_UNDEF));
 	setup_datapipe(&battery_status_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ON_CHANGE,
 		       0, GINT_TO_POINTER(BATTERY_STATUS_UNDEF));
 	setup_datapipe(&battery_level_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(100));
 	setup_datapipe(&camera_button_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(CAMERA_BUTTON_UNDEF));
 	setup_datapipe(&inactivity_timeout_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(DEFAULT_INACTIVITY_TIMEOUT));
 	setup_datapipe(&audio_route_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(AUDIO_ROUTE_UNDEF));
 	setup_datapipe(&usb_cable_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ON_CHANGE,
 		       0, GINT_TO_POINTER(USB_CABLE_UNDEF));
 	setup_datapipe(&jack_sense_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(0));
 	setup_datapipe(&power_saving_mode_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ON_CHANGE,
 		       0, GINT_TO_POINTER(0));
 	setup_datapipe(&thermal_state_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ON_CHANGE,
 		       0, GINT_TO_POINTER(THERMAL_STATE_UNDEF));
 	setup_datapipe(&heartbeat_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(0));
 
 	setup_datapipe(&compositor_available_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(SERVICE_STATE_UNDEF));
 	setup_datapipe(&lipstick_available_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(SERVICE_STATE_UNDEF));
 	setup_datapipe(&usbmoded_available_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(SERVICE_STATE_UNDEF));
 	setup_datapipe(&ngfd_available_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(SERVICE_STATE_UNDEF));
 
 	setup_datapipe(&dsme_available_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(SERVICE_STATE_UNDEF));
 
 	setup_datapipe(&packagekit_locked_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(FALSE));
 	setup_datapipe(&update_mode_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(FALSE));
 	setup_datapipe(&shutting_down_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(FALSE));
 	setup_datapipe(&device_lock_state_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ON_CHANGE,
 		       0, GINT_TO_POINTER(DEVICE_LOCK_UNDEFINED));
 	setup_datapipe(&touch_grab_wanted_pipe, READ_WRITE, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(FALSE));
 	setup_datapipe(&touch_grab_active_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(FALSE));
 	setup_datapipe(&keypad_grab_wanted_pipe, READ_WRITE, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(FALSE));
 	setup_datapipe(&keypad_grab_active_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(FALSE));
 	setup_datapipe(&music_playback_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(FALSE));
 	setup_datapipe(&proximity_blank_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(FALSE));
+
+	/* Attach names used in diagnostic output */
+	for (gint i = 0; datapipe_name_lut[i].datapipe; i++)
+		datapipe_name_lut[i].datapipe->name = datapipe_name_lut[i].name;
 }
 
 /** Free all datapipes
@@ -967,6 +1728,7 @@ void mce_datapipe_quit(void)
 	free_datapipe(&display_state_pipe);
 	free_datapipe(&display_state_req_pipe);
 	free_datapipe(&display_state_next_pipe);
+	free_datapipe(&display_preresume_pipe);
 	free_datapipe(&exception_state_pipe);
 	free_datapipe(&submode_pipe);
 	free_datapipe(&alarm_ui_state_pipe);
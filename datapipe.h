@@ -21,6 +21,8 @@
 #ifndef _DATAPIPE_H_
 #define _DATAPIPE_H_
 
+#include "mce-lib.h"
+
 #include <stdbool.h>
 #include <glib.h>
 
@@ -39,22 +41,86 @@ typedef enum
 
 const char *device_lock_state_repr(device_lock_state_t state);
 
+/**
+ * Callback vector used for datapipe filters and triggers
+ *
+ * Callbacks are kept in a contiguous array so that executing
+ * a datapipe is a linear scan over adjacent memory. Callbacks
+ * removed while the datapipe is being executed are just cleared
+ * and the array is compacted once the outermost execution is done.
+ *
+ * Only access this struct through the datapipe functions
+ */
+typedef struct {
+	gpointer *slots;		/**< Callback function pointers */
+	guint used;			/**< Number of used slots,
+					 *   including cleared ones
+					 */
+	guint allocated;		/**< Number of allocated slots */
+	guint active;			/**< Number of non-cleared slots */
+	guint nesting;			/**< Execution nesting level */
+} datapipe_callbacks_t;
+
+/**
+ * Datapipe execution statistics
+ *
+ * All times are in nanoseconds.
+ */
+typedef struct {
+	mce_hist_t execution;		/**< Full datapipe execution times */
+	guint64 filter_time;		/**< Cumulative time spent in filters */
+	guint64 filter_max;		/**< Longest time spent in filters */
+	guint64 input_time;		/**< Cumulative time spent in
+					 *   input triggers
+					 */
+	guint64 input_max;		/**< Longest time spent in
+					 *   input triggers
+					 */
+	guint64 output_time;		/**< Cumulative time spent in
+					 *   output triggers
+					 */
+	guint64 output_max;		/**< Longest time spent in
+					 *   output triggers
+					 */
+	gpointer worst_callback;	/**< Most expensive filter/trigger */
+	guint64 worst_callback_time;	/**< Longest single filter/trigger
+					 *   call
+					 */
+} datapipe_stats_t;
+
 /**
  * Datapipe structure
  *
  * Only access this struct through the functions
  */
 typedef struct {
-	GSList *filters;		/**< The filters */
-	GSList *input_triggers;		/**< Triggers called on indata */
-	GSList *output_triggers;	/**< Triggers called on outdata */
-	GSList *refcount_triggers;	/**< Triggers called on
-					 *   reference count changes
-					 */
+	datapipe_callbacks_t filters;		/**< The filters */
+	datapipe_callbacks_t input_triggers;	/**< Triggers called on
+						 *   indata
+						 */
+	datapipe_callbacks_t output_triggers;	/**< Triggers called on
+						 *   outdata
+						 */
+	datapipe_callbacks_t refcount_triggers;	/**< Triggers called on
+						 *   reference count changes
+						 */
 	gpointer cached_data;		/**< Latest cached data */
 	gsize datasize;			/**< Size of data; NULL == automagic */
 	gboolean free_cache;		/**< Free the cache? */
 	gboolean read_only;		/**< Datapipe is read only */
+	gboolean coalesce;		/**< Defer execution to idle callback */
+	guint coalesce_id;		/**< Pending deferred execution */
+	gpointer coalesce_data;		/**< Latest deferred indata */
+	gconstpointer coalesce_outdata;	/**< Filtered deferred indata */
+	gboolean notify_on_change;	/**< Skip output triggers on
+					 *   unchanged data
+					 */
+	gboolean notified;		/**< Output triggers have been run */
+	gpointer notified_data;		/**< Data last passed to
+					 *   output triggers
+					 */
+	datapipe_stats_t stats;		/**< Execution statistics */
+	const char *name;		/**< Datapipe name for diagnostics */
 } datapipe_struct;
 
 /**
@@ -73,6 +139,27 @@ typedef enum {
 	FREE_CACHE = TRUE		/**< Free the cache */
 } cache_free_policy_t;
 
+/**
+ * Policy used for executing the datapipe
+ */
+typedef enum {
+	EXECUTE_IMMEDIATELY = FALSE,	/**< Execute on every write */
+	EXECUTE_COALESCED = TRUE	/**< Execute once per main loop
+					 *   iteration with the latest value
+					 */
+} execution_policy_t;
+
+/**
+ * Policy used for notifying output triggers
+ */
+typedef enum {
+	NOTIFY_ALWAYS = FALSE,		/**< Notify on every execution */
+	NOTIFY_ON_CHANGE = TRUE		/**< Notify only when the data
+					 *   differs from what was last
+					 *   passed to output triggers
+					 */
+} change_policy_t;
+
 /**
  * Policy for the data source
  */
@@ -100,6 +187,7 @@ extern datapipe_struct user_activity_pipe;
 extern datapipe_struct display_state_pipe;
 extern datapipe_struct display_state_req_pipe;
 extern datapipe_struct display_state_next_pipe;
+extern datapipe_struct display_preresume_pipe;
 extern datapipe_struct exception_state_pipe;
 extern datapipe_struct display_brightness_pipe;
 extern datapipe_struct key_backlight_pipe;
@@ -170,13 +258,13 @@ extern datapipe_struct proximity_blank_pipe;
 /* Reference count */
 
 /** Retrieve the filter reference count from a datapipe */
-#define datapipe_get_filter_refcount(_datapipe)	(g_slist_length((_datapipe).filters))
+#define datapipe_get_filter_refcount(_datapipe)	((_datapipe).filters.active)
 
 /** Retrieve the input trigger reference count from a datapipe */
-#define datapipe_get_input_trigger_refcount(_datapipe)	(g_slist_length((_datapipe).input_triggers))
+#define datapipe_get_input_trigger_refcount(_datapipe)	((_datapipe).input_triggers.active)
 
 /** Retrieve the output trigger reference count from a datapipe */
-#define datapipe_get_output_trigger_refcount(_datapipe)	(g_slist_length((_datapipe).output_triggers))
+#define datapipe_get_output_trigger_refcount(_datapipe)	((_datapipe).output_triggers.active)
 
 /* Datapipe execution */
 void execute_datapipe_input_triggers(datapipe_struct *const datapipe,
@@ -186,7 +274,7 @@ void execute_datapipe_input_triggers(datapipe_struct *const datapipe,
 gconstpointer execute_datapipe_filters(datapipe_struct *const datapipe,
 				       gpointer indata,
 				       const data_source_t use_cache);
-void execute_datapipe_output_triggers(const datapipe_struct *const datapipe,
+void execute_datapipe_output_triggers(datapipe_struct *const datapipe,
 				      gconstpointer indata,
 				      const data_source_t use_cache);
 gconstpointer execute_datapipe(datapipe_struct *const datapipe,
@@ -221,9 +309,20 @@ void remove_refcount_trigger_from_datapipe(datapipe_struct *const datapipe,
 void setup_datapipe(datapipe_struct *const datapipe,
 		    const read_only_policy_t read_only,
 		    const cache_free_policy_t free_cache,
+		    const execution_policy_t execution,
+		    const change_policy_t notify,
 		    const gsize datasize, gpointer initial_data);
 void free_datapipe(datapipe_struct *const datapipe);
 
+/* Statistics */
+void datapipe_stats_foreach(void (*cb)(const char *name,
+				       const datapipe_stats_t *stats,
+				       gpointer user_data),
+			    gpointer user_data);
+void datapipe_stats_reset(void);
+void datapipe_stats_set_enabled(gboolean enabled);
+gboolean datapipe_stats_get_enabled(void);
+
 /* Binding arrays */
 
 typedef struct
@@ -32,6 +32,7 @@
 # include "mce-gconf.h"
 #endif
 #include "mce-sensorfw.h"
+#include "mce-dbus.h"
 #include "evdev.h"
 
 #include <linux/input.h>
@@ -41,10 +42,13 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <dirent.h>
+#include <time.h>
 
 #include <glib/gstdio.h>
 #include <gio/gio.h>
 
+#include <mce/dbus-names.h>
+
 /* ========================================================================= *
  * CONSTANTS
  * ========================================================================= */
@@ -69,6 +73,17 @@
 # define KEY_CAMERA_FOCUS               0x0210
 #endif
 
+#ifndef EVIOCSMASK
+/** Event mask for EVIOCSMASK ioctl, from linux/input.h of kernel 4.4+ */
+struct input_mask {
+    __u32 type;
+    __u32 codes_size;
+    __u64 codes_ptr;
+};
+/** Set event mask for evdev client */
+# define EVIOCSMASK _IOW('E', 0x93, struct input_mask)
+#endif
+
 #ifndef FF_STATUS_CNT
 # ifdef FF_STATUS_MAX
 #  define FF_STATUS_CNT (FF_STATUS_MAX+1)
@@ -121,6 +136,7 @@ static bool         evin_event_mapping_parse_config             (evin_event_mapp
 
 static bool         evin_event_mapping_apply                    (const evin_event_mapping_t *self, struct input_event *ev);
 
+static evin_event_mapping_t *evin_event_mapper_lookup         (int type, int code);
 static int          evin_event_mapper_rlookup_switch            (int expected_by_mce);
 static void         evin_event_mapper_translate_event           (struct input_event *ev);
 
@@ -277,6 +293,19 @@ static int          evin_doubletap_emulate                      (const struct in
  * EVDEV_IO_MONITORING
  * ------------------------------------------------------------------------- */
 
+/** Maximum number of events collected into one touchscreen frame */
+#define EVIN_TS_FRAME_MAX 64
+
+/** Touchscreen events collected up to SYN_REPORT */
+typedef struct
+{
+    /** Events in the order they were received */
+    struct input_event tf_event[EVIN_TS_FRAME_MAX];
+
+    /** Number of events collected */
+    size_t             tf_count;
+} evin_ts_frame_t;
+
 /** Cached capabilities and type of monitored evdev input device */
 typedef struct
 {
@@ -292,6 +321,9 @@ typedef struct
     /** Name of device that provides keypad slide state*/
     gchar             *ex_sw_keypad_slide;
 
+    /** Touchscreen frame being assembled, for touch devices only */
+    evin_ts_frame_t   *ex_ts_frame;
+
 } evin_iomon_extra_t;
 
 static void                evin_iomon_extra_delete_cb           (void *aptr);
@@ -303,6 +335,7 @@ static void         evin_iomon_generate_activity                (struct input_ev
 
 // event handling by device type
 
+static void         evin_iomon_touchscreen_process_frame        (struct input_event *frame, size_t count);
 static gboolean     evin_iomon_touchscreen_cb                   (gpointer data, gsize bytes_read);
 static gboolean     evin_iomon_evin_doubletap_cb                (gpointer data, gsize bytes_read);
 static gboolean     evin_iomon_keypress_cb                      (gpointer data, gsize bytes_read);
@@ -328,6 +361,16 @@ static void         evin_iomon_keyboard_state_update            (void);
 static bool         evin_iomon_init                             (void);
 static void         evin_iomon_quit                             (void);
 
+/* ------------------------------------------------------------------------- *
+ * EVDEV_EVENT_MASKING
+ * ------------------------------------------------------------------------- */
+
+static bool         evin_evmask_wanted                          (evin_evdevtype_t type, bool reduced, int etype, int ecode);
+static bool         evin_evmask_reduced_possible                (const evin_evdevinfo_t *info);
+static void         evin_evmask_apply_iomon_cb                  (gpointer data, gpointer user_data);
+static bool         evin_evmask_evaluate                        (void);
+static void         evin_evmask_rethink                         (void);
+
 /* ------------------------------------------------------------------------- *
  * EVDEV_DIRECTORY_MONITORING
  * ------------------------------------------------------------------------- */
@@ -416,6 +459,23 @@ static void         evin_kp_grab_changed                        (evin_input_grab
 static void         evin_kp_grab_event_filter_cb                (struct input_event *ev);
 static void         evin_kp_grab_wanted_cb                      (gconstpointer data);
 
+/* ------------------------------------------------------------------------- *
+ * INPUT_LATENCY
+ * ------------------------------------------------------------------------- */
+
+static bool         evin_latency_since                          (const struct timeval *tv, guint64 *us);
+void                evin_latency_record                         (evin_latency_path_t path, const struct timeval *tv);
+void                evin_latency_unblank_begin                  (const struct timeval *tv);
+void                evin_latency_unblank_cancel                 (void);
+static void         evin_latency_display_state_cb               (gconstpointer data);
+static void         evin_latency_reset                          (void);
+
+static gboolean     evin_latency_get_dbus_cb                    (DBusMessage *const msg);
+static gboolean     evin_latency_reset_dbus_cb                  (DBusMessage *const msg);
+
+static void         evin_latency_init                           (void);
+static void         evin_latency_quit                           (void);
+
 /* ------------------------------------------------------------------------- *
  * MODULE_INIT
  * ------------------------------------------------------------------------- */
@@ -671,6 +731,49 @@ static evin_event_mapping_t *evin_event_mapper_lut = 0;
 /** Number of entries in evin_event_mapper_lut */
 static size_t           evin_event_mapper_cnt = 0;
 
+/** Direct lookup: EV_KEY code emitted by kernel -> mapping */
+static evin_event_mapping_t *evin_event_mapper_key_map[KEY_CNT];
+
+/** Direct lookup: EV_SW code emitted by kernel -> mapping */
+static evin_event_mapping_t *evin_event_mapper_sw_map[SW_CNT];
+
+/** Direct lookup: EV_SW code expected by mce -> EV_SW to EV_SW mapping */
+static evin_event_mapping_t *evin_event_mapper_sw_rmap[SW_CNT];
+
+/** Lookup mapping for event kernel is emitting
+ *
+ * @param type event type, EV_KEY or EV_SW
+ * @param code event code
+ *
+ * @return mapping to apply, or NULL if the event is used as is
+ */
+static evin_event_mapping_t *
+evin_event_mapper_lookup(int type, int code)
+{
+    evin_event_mapping_t *map = 0;
+
+    if( code < 0 )
+        goto EXIT;
+
+    switch( type ) {
+    case EV_KEY:
+        if( code < KEY_CNT )
+            map = evin_event_mapper_key_map[code];
+        break;
+
+    case EV_SW:
+        if( code < SW_CNT )
+            map = evin_event_mapper_sw_map[code];
+        break;
+
+    default:
+        break;
+    }
+
+EXIT:
+    return map;
+}
+
 /** Reverse lookup switch kernel is emitting from switch mce is expecting
  *
  * Note: For use from event switch initial state evaluation only.
@@ -685,37 +788,20 @@ evin_event_mapper_rlookup_switch(int expected_by_mce)
     /* Assume kernel emits events mce is expecting to see */
     int emitted_by_kernel = expected_by_mce;
 
-    /* If emitted_by_kernel -> expected_by_mce mapping exist, use it */
-    for( size_t i = 0; i < evin_event_mapper_cnt; ++i ) {
-        evin_event_mapping_t *map = evin_event_mapper_lut + i;
-
-        if( map->em_kernel_emits.type != EV_SW )
-            continue;
-
-        if( map->em_mce_expects.type != EV_SW )
-            continue;
-
-        if( map->em_mce_expects.code != expected_by_mce )
-            continue;
+    if( expected_by_mce < 0 || expected_by_mce >= SW_CNT )
+        goto EXIT;
 
+    /* If emitted_by_kernel -> expected_by_mce mapping exist, use it */
+    evin_event_mapping_t *map = evin_event_mapper_sw_rmap[expected_by_mce];
+    if( map ) {
         emitted_by_kernel = map->em_kernel_emits.code;
         goto EXIT;
     }
 
     /* But if there is rule for mapping the event for something
      * else, it should be ignored instead of used as is */
-    for( size_t i = 0; i < evin_event_mapper_cnt; ++i ) {
-        evin_event_mapping_t *map = evin_event_mapper_lut + i;
-
-        if( map->em_kernel_emits.type != EV_SW )
-            continue;
-
-        if( map->em_mce_expects.type != EV_SW )
-            continue;
-
-        if( map->em_kernel_emits.code != expected_by_mce )
-            continue;
-
+    map = evin_event_mapper_sw_map[expected_by_mce];
+    if( map && map->em_mce_expects.type == EV_SW ) {
         /* Assumption: SW_MAX is valid index for ioctl() probing,
          *             but is not an alias for anything that kernel
          *             would report.
@@ -753,13 +839,10 @@ evin_event_mapper_translate_event(struct input_event *ev)
         goto EXIT;
     }
 
-    /* Try to find suitable mapping from lookup table */
-    for( size_t i = 0; i < evin_event_mapper_cnt; ++i ) {
-        evin_event_mapping_t *map = evin_event_mapper_lut + i;
-
-        if( evin_event_mapping_apply(map, ev) )
-            break;
-    }
+    /* Apply mapping from direct lookup table */
+    evin_event_mapping_t *map = evin_event_mapper_lookup(ev->type, ev->code);
+    if( map )
+        evin_event_mapping_apply(map, ev);
 
 EXIT:
     return;
@@ -799,6 +882,28 @@ evin_event_mapper_init(void)
 
     evin_event_mapper_cnt = valid;
 
+    /* Compile direct lookup tables; if there are several rules
+     * for the same event, the first one is used */
+    for( size_t i = 0; i < evin_event_mapper_cnt; ++i ) {
+        evin_event_mapping_t *map = evin_event_mapper_lut + i;
+        int ktype = map->em_kernel_emits.type;
+        int kcode = map->em_kernel_emits.code;
+        int mcode = map->em_mce_expects.code;
+
+        if( ktype == EV_KEY && kcode < KEY_CNT ) {
+            if( !evin_event_mapper_key_map[kcode] )
+                evin_event_mapper_key_map[kcode] = map;
+        }
+        else if( ktype == EV_SW && kcode < SW_CNT ) {
+            if( !evin_event_mapper_sw_map[kcode] )
+                evin_event_mapper_sw_map[kcode] = map;
+
+            if( map->em_mce_expects.type == EV_SW && mcode < SW_CNT &&
+                !evin_event_mapper_sw_rmap[mcode] )
+                evin_event_mapper_sw_rmap[mcode] = map;
+        }
+    }
+
 EXIT:
     /* Remove also lookup table pointer if there are no entries */
     if( !evin_event_mapper_cnt )
@@ -816,6 +921,10 @@ EXIT:
 static void
 evin_event_mapper_quit(void)
 {
+    memset(evin_event_mapper_key_map, 0, sizeof evin_event_mapper_key_map);
+    memset(evin_event_mapper_sw_map, 0, sizeof evin_event_mapper_sw_map);
+    memset(evin_event_mapper_sw_rmap, 0, sizeof evin_event_mapper_sw_rmap);
+
     free(evin_event_mapper_lut),
         evin_event_mapper_lut = 0,
         evin_event_mapper_cnt = 0;
@@ -1752,6 +1861,7 @@ evin_iomon_extra_delete_cb(void *aptr)
     if( self ) {
         evin_evdevinfo_delete(self->ex_info);
         g_free(self->ex_sw_keypad_slide);
+        free(self->ex_ts_frame);
         free(self->ex_name);
         free(self);
     }
@@ -1776,6 +1886,11 @@ evin_iomon_extra_create(int fd, const char *name)
                                                        self->ex_name, 0);
     }
 
+    self->ex_ts_frame = 0;
+
+    if( self->ex_type == EVDEV_TOUCH )
+        self->ex_ts_frame = calloc(1, sizeof *self->ex_ts_frame);
+
     return self;
 }
 
@@ -1897,6 +2012,7 @@ evin_iomon_generate_activity(struct input_event *ev, bool cooked, bool raw)
             execute_datapipe(&device_inactive_pipe,
                              GINT_TO_POINTER(FALSE),
                              USE_INDATA, CACHE_INDATA);
+            evin_latency_record(EVIN_LATENCY_ACTIVITY, &ev->time);
         }
     }
 
@@ -1904,32 +2020,30 @@ EXIT:
     return;
 }
 
-/** I/O monitor callback for handling touchscreen events
+/** Process a complete frame of touchscreen events
  *
- * @param data       The new data
- * @param bytes_read The number of bytes read
+ * The grab filter, doubletap emulation and activity generation are
+ * evaluated once per frame rather than once per event.
  *
- * @return FALSE to return remaining chunks (if any),
- *         TRUE to flush all remaining chunks
+ * @param frame  Array of already mapped input events
+ * @param count  Number of events in the array
  */
-static gboolean
-evin_iomon_touchscreen_cb(gpointer data, gsize bytes_read)
+static void
+evin_iomon_touchscreen_process_frame(struct input_event *frame, size_t count)
 {
-    gboolean flush = FALSE;
-    struct input_event *ev = data;
-
-    if( ev == 0 || bytes_read != sizeof *ev )
-        goto EXIT;
-
-    /* Map event before processing */
-    evin_event_mapper_translate_event(ev);
-
-    mce_log(LL_DEBUG, "type: %s, code: %s, value: %d",
-            evdev_get_event_type_name(ev->type),
-            evdev_get_event_code_name(ev->type, ev->code),
-            ev->value);
+    struct input_event *activity = 0;
+
+    if( mce_log_p(LL_DEBUG) ) {
+        for( size_t i = 0; i < count; ++i ) {
+            mce_log(LL_DEBUG, "type: %s, code: %s, value: %d",
+                    evdev_get_event_type_name(frame[i].type),
+                    evdev_get_event_code_name(frame[i].type, frame[i].code),
+                    frame[i].value);
+        }
+    }
 
-    evin_ts_grab_event_filter_cb(ev);
+    for( size_t i = 0; i < count; ++i )
+        evin_ts_grab_event_filter_cb(frame + i);
 
     bool grabbed = datapipe_get_gint(touch_grab_active_pipe);
 
@@ -1947,11 +2061,14 @@ evin_iomon_touchscreen_cb(gpointer data, gsize bytes_read)
         case MCE_DISPLAY_OFF:
         case MCE_DISPLAY_LPM_OFF:
         case MCE_DISPLAY_LPM_ON:
-            if( evin_doubletap_emulate(ev) ) {
-                mce_log(LL_DEVEL, "[doubletap] emulated from touch input");
-                ev->type  = EV_MSC;
-                ev->code  = MSC_GESTURE;
-                ev->value = 0x4;
+            for( size_t i = 0; i < count; ++i ) {
+                struct input_event *ev = frame + i;
+                if( evin_doubletap_emulate(ev) ) {
+                    mce_log(LL_DEVEL, "[doubletap] emulated from touch input");
+                    ev->type  = EV_MSC;
+                    ev->code  = MSC_GESTURE;
+                    ev->value = 0x4;
+                }
             }
             break;
         default:
@@ -1965,37 +2082,45 @@ evin_iomon_touchscreen_cb(gpointer data, gsize bytes_read)
     }
 #endif
 
-    /* Power key up event from touch screen -> double tap gesture event */
-    if( ev->type == EV_KEY && ev->code == KEY_POWER && ev->value == 0 ) {
-        cover_state_t proximity_sensor_state =
-            datapipe_get_gint(proximity_sensor_pipe);
-
-        cover_state_t lid_cover_policy_state =
-            datapipe_get_gint(lid_cover_policy_pipe);
-
-        mce_log(LL_DEVEL, "[doubletap] as power key event; "
-                "proximity=%s, lid=%s",
-                proximity_state_repr(proximity_sensor_state),
-                proximity_state_repr(lid_cover_policy_state));
+    for( size_t i = 0; i < count; ++i ) {
+        struct input_event *ev = frame + i;
+
+        /* Power key up event from touch screen -> double tap gesture event */
+        if( ev->type == EV_KEY && ev->code == KEY_POWER && ev->value == 0 ) {
+            cover_state_t proximity_sensor_state =
+                datapipe_get_gint(proximity_sensor_pipe);
+
+            cover_state_t lid_cover_policy_state =
+                datapipe_get_gint(lid_cover_policy_pipe);
+
+            mce_log(LL_DEVEL, "[doubletap] as power key event; "
+                    "proximity=%s, lid=%s",
+                    proximity_state_repr(proximity_sensor_state),
+                    proximity_state_repr(lid_cover_policy_state));
+
+            /* Mimic N9 style gesture event for which we
+             * already have logic in place. Possible filtering
+             * due to proximity state etc happens at tklock.c
+             */
+            ev->type  = EV_MSC;
+            ev->code  = MSC_GESTURE;
+            ev->value = 0x4;
+        }
 
-        /* Mimic N9 style gesture event for which we
-         * already have logic in place. Possible filtering
-         * due to proximity state etc happens at tklock.c
-         */
-        ev->type  = EV_MSC;
-        ev->code  = MSC_GESTURE;
-        ev->value = 0x4;
+        /* Latest event that can be considered user activity */
+        if( ev->type == EV_ABS ||
+            ev->type == EV_KEY ||
+            ev->type == EV_MSC )
+            activity = ev;
     }
 
-    /* Ignore unwanted events */
-    if( ev->type != EV_ABS &&
-        ev->type != EV_KEY &&
-        ev->type != EV_MSC )
+    /* Ignore frames without wanted events */
+    if( !activity )
         goto EXIT;
 
     /* Do not generate activity if ts input is grabbed */
     if( !grabbed )
-        evin_iomon_generate_activity(ev, true, true);
+        evin_iomon_generate_activity(activity, true, true);
 
     submode_t submode = mce_get_submode_int32();
 
@@ -2003,13 +2128,67 @@ evin_iomon_touchscreen_cb(gpointer data, gsize bytes_read)
     if( submode & MCE_EVEATER_SUBMODE )
         goto EXIT;
 
-    /* Only send pressure and gesture events */
-    if( (ev->type == EV_ABS && ev->code == ABS_PRESSURE) ||
-        (ev->type == EV_KEY && ev->code == BTN_TOUCH ) ||
-        (ev->type == EV_MSC && ev->code == MSC_GESTURE ) ) {
-        /* For now there's no reason to cache the value */
-        execute_datapipe(&touchscreen_pipe, &ev,
-                         USE_INDATA, DONT_CACHE_INDATA);
+    for( size_t i = 0; i < count; ++i ) {
+        struct input_event *ev = frame + i;
+
+        /* Only send pressure and gesture events */
+        if( (ev->type == EV_ABS && ev->code == ABS_PRESSURE) ||
+            (ev->type == EV_KEY && ev->code == BTN_TOUCH ) ||
+            (ev->type == EV_MSC && ev->code == MSC_GESTURE ) ) {
+            /* For now there's no reason to cache the value */
+            execute_datapipe(&touchscreen_pipe, &ev,
+                             USE_INDATA, DONT_CACHE_INDATA);
+        }
+    }
+
+EXIT:
+    return;
+}
+
+/** I/O monitor callback for handling touchscreen events
+ *
+ * Events are collected until SYN_REPORT and then processed
+ * as one frame.
+ *
+ * @param data       The new data
+ * @param bytes_read The number of bytes read
+ *
+ * @return FALSE to return remaining chunks (if any),
+ *         TRUE to flush all remaining chunks
+ */
+static gboolean
+evin_iomon_touchscreen_cb(gpointer data, gsize bytes_read)
+{
+    gboolean flush = FALSE;
+    struct input_event *ev = data;
+
+    if( ev == 0 || bytes_read != sizeof *ev )
+        goto EXIT;
+
+    /* Frames are assembled separately for each touch device, and
+     * a partial frame gets discarded along with the device */
+    evin_iomon_extra_t *extra =
+        mce_io_mon_get_user_data(mce_io_mon_get_current());
+
+    if( !extra || !extra->ex_ts_frame )
+        goto EXIT;
+
+    evin_ts_frame_t *frame = extra->ex_ts_frame;
+
+    /* Map event before processing */
+    evin_event_mapper_translate_event(ev);
+
+    frame->tf_event[frame->tf_count++] = *ev;
+
+    /* Process on end of frame, or if the frame does not
+     * fit in the buffer - which should not happen unless
+     * the driver fails to emit SYN_REPORT events */
+    if( (ev->type == EV_SYN && ev->code == SYN_REPORT) ||
+        frame->tf_count >= EVIN_TS_FRAME_MAX ) {
+        evin_latency_record(EVIN_LATENCY_READ, &ev->time);
+        evin_iomon_touchscreen_process_frame(frame->tf_event,
+                                             frame->tf_count);
+        frame->tf_count = 0;
     }
 
 EXIT:
@@ -2036,7 +2215,8 @@ evin_iomon_evin_doubletap_cb(gpointer data, gsize bytes_read)
     /* Feed power key events to touchscreen handler for
      * possible double tap gesture event conversion */
     if( ev->type == EV_KEY && ev->code == KEY_POWER ) {
-        evin_iomon_touchscreen_cb(ev, sizeof *ev);
+        evin_event_mapper_translate_event(ev);
+        evin_iomon_touchscreen_process_frame(ev, 1);
     }
 
 EXIT:
@@ -2079,6 +2259,8 @@ evin_iomon_keypress_cb(gpointer data, gsize bytes_read)
         goto EXIT;
     }
 
+    evin_latency_record(EVIN_LATENCY_READ, &ev->time);
+
     if (ev->type == EV_KEY) {
         if( datapipe_get_gint(keypad_grab_active_pipe) ) {
             switch( ev->code ) {
@@ -2343,12 +2525,17 @@ evin_iomon_device_add(const gchar *path)
         goto EXIT;
 
     /* Attach device type information to the io monitor */
+    evin_evdevtype_t type = extra->ex_type;
     mce_io_mon_set_user_data(iomon, extra, evin_iomon_extra_delete_cb),
         extra = 0;
 
     /* Add to list of evdev io monitors */
     evin_iomon_device_list = g_slist_prepend(evin_iomon_device_list, iomon);
 
+    /* Apply current kernel side event filtering */
+    if( type == EVDEV_TOUCH )
+        evin_evmask_apply_iomon_cb(iomon, 0);
+
 EXIT:
     /* Release type data if it was not attached to io monitor */
     if( extra )
@@ -2644,6 +2831,203 @@ evin_iomon_quit(void)
     evin_iomon_device_rem_all();
 }
 
+/* ========================================================================= *
+ * EVDEV_EVENT_MASKING
+ * ========================================================================= */
+
+/** Flag for: kernel supports EVIOCSMASK */
+static bool evin_evmask_supported = true;
+
+/** Flag for: touch devices are in reduced event mode */
+static bool evin_evmask_reduced = false;
+
+/** Check if mce needs to see events of given type and code
+ *
+ * In reduced mode touch screens need to deliver only touch press and
+ * release (BTN_TOUCH) plus the events used for doubletap handling, i.e.
+ * KEY_POWER and MSC_GESTURE. Contact tracking and position data is not
+ * delivered, so that moving fingers do not wake up mce at all. Reduced
+ * mode is used only while touch grab is neither wanted nor active.
+ *
+ * @param type    Device type from mce point of view
+ * @param reduced true if fine grained touch data is not needed
+ * @param etype   Event type
+ * @param ecode   Event code
+ *
+ * @return true if the event should be delivered, false otherwise
+ */
+static bool
+evin_evmask_wanted(evin_evdevtype_t type, bool reduced, int etype, int ecode)
+{
+    bool wanted = true;
+
+    if( !reduced )
+        goto EXIT;
+
+    switch( type ) {
+    case EVDEV_TOUCH:
+        switch( etype ) {
+        case EV_SYN:
+            break;
+        case EV_KEY:
+            wanted = (ecode == BTN_TOUCH || ecode == KEY_POWER);
+            break;
+        case EV_MSC:
+            wanted = (ecode == MSC_GESTURE);
+            break;
+        default:
+            wanted = false;
+            break;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+EXIT:
+    return wanted;
+}
+
+/** Check if a touch device can be switched to reduced event mode
+ *
+ * Touch press/release activity is then seen only via BTN_TOUCH,
+ * so devices that do not report it must get all events.
+ *
+ * @param info Device capabilities
+ *
+ * @return true if reduced mode can be used, false otherwise
+ */
+static bool
+evin_evmask_reduced_possible(const evin_evdevinfo_t *info)
+{
+    return info && evin_evdevinfo_has_code(info, EV_KEY, BTN_TOUCH);
+}
+
+/** Program kernel side event mask for an evdev io monitor
+ *
+ * @param data      io monitor as void pointer
+ * @param user_data (unused)
+ */
+static void
+evin_evmask_apply_iomon_cb(gpointer data, gpointer user_data)
+{
+    (void)user_data;
+
+    mce_io_mon_t *iomon = data;
+
+    if( !evin_evmask_supported )
+        goto EXIT;
+
+    int fd = mce_io_mon_get_fd(iomon);
+    if( fd == -1 )
+        goto EXIT;
+
+    evin_iomon_extra_t *extra = mce_io_mon_get_user_data(iomon);
+    if( !extra || !extra->ex_info )
+        goto EXIT;
+
+    const char *path = mce_io_mon_get_path(iomon) ?: "unknown";
+
+    bool reduced = (evin_evmask_reduced &&
+                    evin_evmask_reduced_possible(extra->ex_info));
+
+    /* Large enough for any type that has evdevbits */
+    unsigned long codes[EVIN_EVDEVBITS_LEN(KEY_CNT)];
+
+    /* EV_SYN is never masked */
+    for( int etype = EV_SYN + 1; etype < EV_CNT; ++etype ) {
+        const evin_evdevbits_t *bits = extra->ex_info->mask[etype];
+
+        if( !bits || !evin_evdevinfo_has_type(extra->ex_info, etype) )
+            continue;
+
+        memset(codes, 0, sizeof codes);
+        for( int ecode = 0; ecode < bits->cnt; ++ecode ) {
+            if( evin_evmask_wanted(extra->ex_type, reduced, etype, ecode) )
+                codes[ecode / LONG_BIT] |= 1ul << (ecode % LONG_BIT);
+        }
+
+        struct input_mask mask = {
+            .type       = etype,
+            .codes_size = EVIN_EVDEVBITS_LEN(bits->cnt) * sizeof *codes,
+            .codes_ptr  = (uintptr_t)codes,
+        };
+
+        if( ioctl(fd, EVIOCSMASK, &mask) == -1 ) {
+            if( errno == EINVAL || errno == ENOTTY ) {
+                mce_log(LL_NOTICE, "EVIOCSMASK not supported by kernel");
+                evin_evmask_supported = false;
+            }
+            else {
+                mce_log(LL_ERR, "EVIOCSMASK(%s, %s): %m", path,
+                        evdev_get_event_type_name(etype));
+            }
+            goto EXIT;
+        }
+    }
+
+    mce_log(LL_DEBUG, "%s: %s events", path, reduced ? "reduced" : "all");
+
+EXIT:
+    return;
+}
+
+/** Evaluate whether touch devices can be switched to reduced mode
+ *
+ * Fine grained touch data is needed for touch grab release, doubletap
+ * emulation and while the display is powered off or in transition.
+ *
+ * @return true if reduced event mode can be used, false otherwise
+ */
+static bool
+evin_evmask_evaluate(void)
+{
+    bool reduced = false;
+
+    switch( datapipe_get_gint(display_state_pipe) ) {
+    case MCE_DISPLAY_ON:
+    case MCE_DISPLAY_DIM:
+        break;
+    default:
+        goto EXIT;
+    }
+
+    if( datapipe_get_gint(touch_grab_wanted_pipe) )
+        goto EXIT;
+
+    if( datapipe_get_gint(touch_grab_active_pipe) )
+        goto EXIT;
+
+    reduced = true;
+
+EXIT:
+    return reduced;
+}
+
+/** Reprogram touch device event masks if needed
+ *
+ * This should be called when display state or
+ * touch screen grab state changes.
+ */
+static void
+evin_evmask_rethink(void)
+{
+    bool reduced = evin_evmask_evaluate();
+
+    if( evin_evmask_reduced == reduced )
+        goto EXIT;
+
+    mce_log(LL_DEBUG, "touch events: %s", reduced ? "reduced" : "all");
+
+    evin_evmask_reduced = reduced;
+
+    evin_iomon_device_iterate(EVDEV_TOUCH, evin_evmask_apply_iomon_cb, 0);
+
+EXIT:
+    return;
+}
+
 /* ========================================================================= *
  * EVDEV_DIRECTORY_MONITORING
  * ========================================================================= */
@@ -3046,6 +3430,7 @@ evin_ts_grab_set_active(gboolean grab)
                      USE_INDATA, CACHE_INDATA);
 
     evin_ts_grab_rethink_led();
+    evin_evmask_rethink();
 
 EXIT:
     return;
@@ -3247,6 +3632,8 @@ evin_ts_grab_wanted_cb(gconstpointer data)
     // INPUT DATAPIPE -> STATE MACHINE
 
     evin_input_grab_request_grab(&evin_ts_grab_state, required);
+
+    evin_evmask_rethink();
 }
 
 /** Take display state changes in account for touch grab state
@@ -3304,6 +3691,7 @@ evin_ts_grab_display_state_cb(gconstpointer data)
     }
 
     evin_ts_grab_rethink_led();
+    evin_evmask_rethink();
 
 EXIT:
     return;
@@ -3440,6 +3828,289 @@ evin_kp_grab_wanted_cb(gconstpointer data)
     evin_input_grab_request_grab(&evin_kp_grab_state, required);
 }
 
+/* ========================================================================= *
+ * INPUT_LATENCY
+ * ========================================================================= */
+
+/** Samples older than this are assumed to be bogus [us] */
+#define EVIN_LATENCY_MAX_AGE (10 * 1000 * 1000)
+
+/** Histogram bucket upper limits [us]
+ *
+ * The last bucket holds everything that took longer.
+ */
+static const guint64 evin_latency_limits[] =
+{
+    1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000,
+};
+
+/** Latency statistics for each measurement path [us] */
+static mce_hist_t evin_latency_stats[EVIN_LATENCY_COUNT] =
+{
+    [EVIN_LATENCY_READ]     = MCE_HIST_INIT("read",     evin_latency_limits),
+    [EVIN_LATENCY_POWERKEY] = MCE_HIST_INIT("powerkey", evin_latency_limits),
+    [EVIN_LATENCY_ACTIVITY] = MCE_HIST_INIT("activity", evin_latency_limits),
+    [EVIN_LATENCY_UNBLANK]  = MCE_HIST_INIT("unblank",  evin_latency_limits),
+};
+
+/** Kernel timestamp of power key press that is expected to unblank */
+static struct timeval evin_latency_unblank_time = { 0, 0 };
+
+/** Get time elapsed since kernel event timestamp
+ *
+ * Input events are timestamped using CLOCK_REALTIME unless
+ * something else is explicitly requested via EVIOCSCLOCKID.
+ *
+ * @param tv kernel timestamp of an input event
+ * @param us where to store the elapsed time in microseconds
+ *
+ * @return true if a sensible value was obtained, false otherwise
+ */
+static bool
+evin_latency_since(const struct timeval *tv, guint64 *us)
+{
+    bool ack = false;
+    struct timespec now;
+
+    if( !tv || !timerisset(tv) )
+        goto EXIT;
+
+    if( clock_gettime(CLOCK_REALTIME, &now) == -1 )
+        goto EXIT;
+
+    int64_t t = ((int64_t)now.tv_sec - tv->tv_sec) * 1000000 +
+        (now.tv_nsec / 1000 - tv->tv_usec);
+
+    /* Ignore clock adjustments and alike */
+    if( t < 0 || t > EVIN_LATENCY_MAX_AGE )
+        goto EXIT;
+
+    *us = (guint64)t;
+    ack = true;
+
+EXIT:
+    return ack;
+}
+
+/** Record latency sample
+ *
+ * @param path measurement path
+ * @param tv   kernel timestamp of the input event
+ */
+void
+evin_latency_record(evin_latency_path_t path, const struct timeval *tv)
+{
+    guint64 us = 0;
+
+    if( (unsigned)path >= EVIN_LATENCY_COUNT )
+        goto EXIT;
+
+    if( !evin_latency_since(tv, &us) )
+        goto EXIT;
+
+    mce_hist_t *stats = evin_latency_stats + path;
+
+    mce_hist_add(stats, us);
+
+    mce_log(LL_DEBUG, "%s: %.3f ms", stats->name, us * 1e-3);
+
+EXIT:
+    return;
+}
+
+/** Start power key to display on latency measurement
+ *
+ * Every press restarts the measurement, so that a press that did
+ * not lead to unblanking can't skew the result of a later one.
+ *
+ * @param tv kernel timestamp of the power key press event
+ */
+void
+evin_latency_unblank_begin(const struct timeval *tv)
+{
+    switch( datapipe_get_gint(display_state_pipe) ) {
+    case MCE_DISPLAY_ON:
+    case MCE_DISPLAY_DIM:
+        /* Display is already on, nothing to measure */
+        timerclear(&evin_latency_unblank_time);
+        break;
+
+    default:
+        if( tv )
+            evin_latency_unblank_time = *tv;
+        else
+            timerclear(&evin_latency_unblank_time);
+        break;
+    }
+}
+
+/** Cancel power key to display on latency measurement
+ *
+ * For use when power key press gets handled without unblanking.
+ */
+void
+evin_latency_unblank_cancel(void)
+{
+    timerclear(&evin_latency_unblank_time);
+}
+
+/** Finish power key to display on latency measurement
+ *
+ * @param data display state as void pointer
+ */
+static void
+evin_latency_display_state_cb(gconstpointer data)
+{
+    display_state_t display_state = GPOINTER_TO_INT(data);
+
+    if( !timerisset(&evin_latency_unblank_time) )
+        goto EXIT;
+
+    switch( display_state ) {
+    case MCE_DISPLAY_POWER_UP:
+        /* Still on the way to display on */
+        break;
+
+    case MCE_DISPLAY_ON:
+        evin_latency_record(EVIN_LATENCY_UNBLANK,
+                            &evin_latency_unblank_time);
+        timerclear(&evin_latency_unblank_time);
+        break;
+
+    default:
+        /* Power key press did not lead to unblanking */
+        timerclear(&evin_latency_unblank_time);
+        break;
+    }
+
+EXIT:
+    return;
+}
+
+/** Clear all latency statistics
+ */
+static void
+evin_latency_reset(void)
+{
+    for( size_t i = 0; i < EVIN_LATENCY_COUNT; ++i )
+        mce_hist_reset(evin_latency_stats + i);
+}
+
+/** D-Bus callback for the get input latency method call
+ *
+ * @param msg The D-Bus message to reply to
+ *
+ * @return TRUE
+ */
+static gboolean
+evin_latency_get_dbus_cb(DBusMessage *const msg)
+{
+    DBusMessage     *reply = 0;
+    DBusMessageIter  body, arr;
+
+    mce_log(LL_DEBUG, "Received input latency request");
+
+    if( dbus_message_get_no_reply(msg) )
+        goto EXIT;
+
+    if( !(reply = dbus_new_method_reply(msg)) )
+        goto EXIT;
+
+    dbus_message_iter_init_append(reply, &body);
+
+    if( !dbus_message_iter_open_container(&body, DBUS_TYPE_ARRAY,
+                                          MCE_DBUS_HIST_SIGNATURE, &arr) )
+        goto EXIT;
+
+    for( size_t i = 0; i < EVIN_LATENCY_COUNT; ++i ) {
+        if( !mce_dbus_iter_append_hist(&arr, evin_latency_stats + i) )
+            break;
+    }
+
+    dbus_message_iter_close_container(&body, &arr);
+
+    dbus_send_message(reply), reply = 0;
+
+EXIT:
+    if( reply )
+        dbus_message_unref(reply);
+
+    return TRUE;
+}
+
+/** D-Bus callback for the reset input latency method call
+ *
+ * @param msg The D-Bus message to reply to
+ *
+ * @return TRUE
+ */
+static gboolean
+evin_latency_reset_dbus_cb(DBusMessage *const msg)
+{
+    DBusMessage *reply = 0;
+
+    mce_log(LL_DEVEL, "Received input latency reset request");
+
+    evin_latency_reset();
+
+    if( dbus_message_get_no_reply(msg) )
+        goto EXIT;
+
+    if( (reply = dbus_new_method_reply(msg)) )
+        dbus_send_message(reply), reply = 0;
+
+EXIT:
+    return TRUE;
+}
+
+/** Array of dbus message handlers */
+static mce_dbus_handler_t evin_latency_dbus_handlers[] =
+{
+    /* method calls */
+    {
+        .interface = MCE_REQUEST_IF,
+        .name      = MCE_INPUT_LATENCY_GET,
+        .type      = DBUS_MESSAGE_TYPE_METHOD_CALL,
+        .callback  = evin_latency_get_dbus_cb,
+        .args      =
+            "    <arg direction=\"out\" name=\"latency\" type=\"a" MCE_DBUS_HIST_SIGNATURE "\"/>\n"
+    },
+    {
+        .interface = MCE_REQUEST_IF,
+        .name      = MCE_INPUT_LATENCY_RESET,
+        .type      = DBUS_MESSAGE_TYPE_METHOD_CALL,
+        .callback  = evin_latency_reset_dbus_cb,
+        .args      =
+            ""
+    },
+    /* sentinel */
+    {
+        .interface = 0
+    }
+};
+
+/** Start input latency tracking
+ */
+static void
+evin_latency_init(void)
+{
+    append_output_trigger_to_datapipe(&display_state_pipe,
+                                      evin_latency_display_state_cb);
+
+    mce_dbus_handler_register_array(evin_latency_dbus_handlers);
+}
+
+/** Stop input latency tracking
+ */
+static void
+evin_latency_quit(void)
+{
+    mce_dbus_handler_unregister_array(evin_latency_dbus_handlers);
+
+    remove_output_trigger_from_datapipe(&display_state_pipe,
+                                        evin_latency_display_state_cb);
+}
+
 /* ========================================================================= *
  * MODULE_INIT
  * ========================================================================= */
@@ -3459,6 +4130,8 @@ mce_input_init(void)
 
     evin_ts_grab_init();
 
+    evin_latency_init();
+
 #ifdef ENABLE_DOUBLETAP_EMULATION
     /* Get fake doubletap policy configuration & track changes */
     mce_gconf_notifier_add(MCE_GCONF_EVENT_INPUT_PATH,
@@ -3529,5 +4202,7 @@ mce_input_exit(void)
     /* Release event mapping lookup tables */
     evin_event_mapper_quit();
 
+    evin_latency_quit();
+
     return;
 }
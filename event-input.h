@@ -23,6 +23,8 @@
 
 #include <glib.h>
 
+#include <sys/time.h>
+
 /** Path to the input device directory */
 #define DEV_INPUT_PATH			"/dev/input"
 
@@ -43,6 +45,28 @@
 /** Path to the touch unblock delay setting */
 #define MCE_GCONF_TOUCH_UNBLOCK_DELAY_PATH MCE_GCONF_EVENT_INPUT_PATH "/touch_unblock_delay"
 
+/** Input latency measurement paths */
+typedef enum {
+	/** Kernel timestamp -> event read by mce */
+	EVIN_LATENCY_READ,
+
+	/** Kernel timestamp -> power key handled */
+	EVIN_LATENCY_POWERKEY,
+
+	/** Kernel timestamp -> user activity propagated */
+	EVIN_LATENCY_ACTIVITY,
+
+	/** Power key press kernel timestamp -> display on */
+	EVIN_LATENCY_UNBLANK,
+
+	/** Number of measurement paths */
+	EVIN_LATENCY_COUNT
+} evin_latency_path_t;
+
+void evin_latency_record(evin_latency_path_t path, const struct timeval *tv);
+void evin_latency_unblank_begin(const struct timeval *tv);
+void evin_latency_unblank_cancel(void);
+
 /* When MCE is made modular, this will be handled differently */
 gboolean mce_input_init(void);
 void mce_input_exit(void);
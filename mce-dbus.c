@@ -31,10 +31,12 @@
 #include <unistd.h>
 #include <string.h>
 #include <fcntl.h>
+#include <dlfcn.h>
 
 #include <dbus/dbus-glib-lowlevel.h>
 
 #include <mce/dbus-names.h>
+#include <mce/mode-names.h>
 
 static bool introspectable_signal(const char *interface, const char *member);
 
@@ -223,20 +225,210 @@ static DBusConnection *dbus_connection = NULL;
 /** List of all D-Bus handlers */
 static GSList *dbus_handlers = NULL;
 
+/** Lookup table for dispatching D-Bus messages to handlers
+ *
+ * Key is "type interface member" string, with member replaced
+ * by "*" for handlers that accept any member. Value is a
+ * handler_bucket_t containing the matching handlers.
+ */
+static GHashTable *dbus_handler_lut = NULL;
+
+/** Sequence number for the most recently added D-Bus handler */
+static guint dbus_handler_seq = 0;
+
+/** Number of msg_handler() calls in progress */
+static guint dbus_handler_dispatching = 0;
+
+/** Flag for: handlers have been removed, lists need cleanup */
+static bool dbus_handler_squeeze_needed = false;
+
 /** D-Bus handler callback function */
 typedef gboolean (*handler_callback_t)(DBusMessage *const msg);
 
+/** Precompiled signal match rule term */
+typedef struct
+{
+	int    arg;   /**< Argument index, or -1 for object path */
+	gchar *value; /**< Required string value */
+} handler_term_t;
+
+/** Precompiled signal match rules */
+typedef struct
+{
+	handler_term_t *terms;   /**< Terms, object path first, then
+				  *   arguments in ascending order */
+	int             count;   /**< Number of terms */
+	bool            invalid; /**< Rules could not be parsed */
+} handler_matcher_t;
+
 /** D-Bus handler structure */
 typedef struct
 {
 	handler_callback_t  callback;   /**< Handler callback */
 	gchar              *interface;  /**< The interface to listen on */
 	gchar              *rules;      /**< Additional matching rules */
+	handler_matcher_t   matcher;    /**< Precompiled rules */
 	gchar              *name;       /**< Method call or signal name */
 	gchar              *args;       /**< Introspect XML data */
 	int                 type;       /**< DBUS_MESSAGE_TYPE */
+	guint               seq;        /**< Registration order */
 } handler_struct_t;
 
+/** D-Bus handler lookup table bucket */
+typedef struct
+{
+	GSList *handlers; /**< Handlers, most recently added first */
+} handler_bucket_t;
+
+/** Release precompiled signal match rules */
+static void handler_matcher_clear(handler_matcher_t *self)
+{
+	for( int i = 0; i < self->count; ++i )
+		g_free(self->terms[i].value);
+	g_free(self->terms);
+
+	self->terms   = 0;
+	self->count   = 0;
+	self->invalid = false;
+}
+
+/** Compare function for sorting precompiled match rule terms */
+static int handler_term_compare(const void *a, const void *b)
+{
+	const handler_term_t *lhs = a;
+	const handler_term_t *rhs = b;
+
+	return (lhs->arg > rhs->arg) - (lhs->arg < rhs->arg);
+}
+
+/** Compile textual signal match rules
+ *
+ * Supported terms are argN='value' and path='value', separated
+ * with commas. Quotes around the value are optional.
+ *
+ * @param self  Matcher to fill in
+ * @param rules Rule string, or NULL for no additional rules
+ */
+static void handler_matcher_compile(handler_matcher_t *self,
+				    const char *rules)
+{
+	handler_matcher_clear(self);
+
+	if( !rules )
+		goto EXIT;
+
+	rules += strspn(rules, " ");
+
+	while( *rules ) {
+		const char *eq;
+		const char *value;
+		const char *value_end;
+		int         arg;
+		bool        quot = false;
+
+		if( !(eq = strchr(rules, '=')) )
+			goto FAIL;
+
+		if( eq[1] == '\'' ) {
+			value = eq + 2;
+			value_end = strchr(value, '\'');
+			quot = true;
+		}
+		else {
+			value = eq + 1;
+			value_end = strchrnul(value, ',');
+		}
+
+		if( !value_end )
+			goto FAIL;
+
+		if( !strncmp(rules, "arg", 3) )
+			arg = atoi(rules + 3);
+		else if( !strncmp(rules, "path", 4) )
+			arg = -1;
+		else
+			goto FAIL;
+
+		self->terms = g_renew(handler_term_t, self->terms,
+				      self->count + 1);
+		self->terms[self->count].arg = arg;
+		self->terms[self->count].value =
+			g_strndup(value, value_end - value);
+		self->count += 1;
+
+		rules = value_end + (quot ? 1 : 0);
+		rules += strspn(rules, " ");
+
+		if( *rules == ',' )
+			rules++;
+		rules += strspn(rules, " ");
+	}
+
+	/* Sorted terms allow evaluation in one pass over arguments */
+	if( self->count > 1 )
+		qsort(self->terms, self->count, sizeof *self->terms,
+		      handler_term_compare);
+
+	goto EXIT;
+
+FAIL:
+	mce_log(LL_ERR, "unsupported match rules: %s", rules);
+	handler_matcher_clear(self);
+	self->invalid = true;
+
+EXIT:
+	return;
+}
+
+/** Evaluate precompiled signal match rules
+ *
+ * @param self Precompiled rules
+ * @param msg  The D-Bus message being checked
+ *
+ * @return true if message matches the rules, false if not
+ */
+static bool handler_matcher_eval(const handler_matcher_t *self,
+				 DBusMessage *const msg)
+{
+	DBusMessageIter iter;
+	int             at = -1;
+
+	if( self->invalid )
+		return false;
+
+	for( int i = 0; i < self->count; ++i ) {
+		const handler_term_t *term = self->terms + i;
+		const char           *val  = 0;
+
+		if( term->arg < 0 ) {
+			val = dbus_message_get_path(msg);
+		}
+		else {
+			if( at < 0 ) {
+				if( !dbus_message_iter_init(msg, &iter) )
+					return false;
+				at = 0;
+			}
+
+			for( ; at < term->arg; ++at ) {
+				if( !dbus_message_iter_next(&iter) )
+					return false;
+			}
+
+			if( dbus_message_iter_get_arg_type(&iter) !=
+			    DBUS_TYPE_STRING )
+				return false;
+
+			dbus_message_iter_get_basic(&iter, &val);
+		}
+
+		if( !val || strcmp(val, term->value) )
+			return false;
+	}
+
+	return true;
+}
+
 /** Set handler type for D-Bus handler structure */
 static inline void handler_struct_set_type(handler_struct_t *self, int val)
 {
@@ -265,6 +457,7 @@ static inline void handler_struct_set_name(handler_struct_t *self, const char *v
 static inline void handler_struct_set_rules(handler_struct_t *self, const char *val)
 {
 	g_free(self->rules), self->rules = val ? g_strdup(val) : 0;
+	handler_matcher_compile(&self->matcher, self->rules);
 }
 
 /** Set callback function for D-Bus handler structure */
@@ -284,6 +477,7 @@ static void handler_struct_delete(handler_struct_t *self)
 	g_free(self->name);
 	g_free(self->rules);
 	g_free(self->interface);
+	handler_matcher_clear(&self->matcher);
 	g_free(self);
 
 EXIT:
@@ -869,26 +1063,25 @@ static const char *value_signature(GConfValue *conf)
 	return 0;
 }
 
-/** Helper for appending GConfValue to dbus message
+/** Helper for appending GConfValue to dbus message iterator as variant
  *
- * @param reply DBusMessage under construction
- * @param conf GConfValue to be added to the reply
+ * @param body DBusMessageIter for message / container under construction
+ * @param conf GConfValue to be added
  *
  * @return TRUE if the value was succesfully appended, or FALSE on failure
  */
-static gboolean append_gconf_value_to_dbus_message(DBusMessage *reply, GConfValue *conf)
+static gboolean append_gconf_value_to_dbus_iterator(DBusMessageIter *body,
+						    GConfValue *conf)
 {
 	const char *sig = 0;
 
-	DBusMessageIter body, variant, array;
+	DBusMessageIter variant, array;
 
 	if( !(sig = value_signature(conf)) ) {
 		goto bailout_message;
 	}
 
-	dbus_message_iter_init_append(reply, &body);
-
-	if( !dbus_message_iter_open_container(&body, DBUS_TYPE_VARIANT,
+	if( !dbus_message_iter_open_container(body, DBUS_TYPE_VARIANT,
 					      sig, &variant) ) {
 		goto bailout_message;
 	}
@@ -999,7 +1192,7 @@ static gboolean append_gconf_value_to_dbus_message(DBusMessage *reply, GConfValu
 		goto bailout_variant;
 	}
 
-	if( !dbus_message_iter_close_container(&body, &variant) ) {
+	if( !dbus_message_iter_close_container(body, &variant) ) {
 		goto bailout_message;
 	}
 	return TRUE;
@@ -1008,12 +1201,28 @@ bailout_array:
 	dbus_message_iter_abandon_container(&variant, &array);
 
 bailout_variant:
-	dbus_message_iter_abandon_container(&body, &variant);
+	dbus_message_iter_abandon_container(body, &variant);
 
 bailout_message:
 	return FALSE;
 }
 
+/** Helper for appending GConfValue to dbus message
+ *
+ * @param reply DBusMessage under construction
+ * @param conf GConfValue to be added to the reply
+ *
+ * @return TRUE if the value was succesfully appended, or FALSE on failure
+ */
+static gboolean append_gconf_value_to_dbus_message(DBusMessage *reply, GConfValue *conf)
+{
+	DBusMessageIter body;
+
+	dbus_message_iter_init_append(reply, &body);
+
+	return append_gconf_value_to_dbus_iterator(&body, conf);
+}
+
 /* FIXME: Once the constants are in mce-dev these can be removed */
 #ifndef MCE_CONFIG_GET
 # define MCE_CONFIG_GET         "get_config"
@@ -1021,6 +1230,11 @@ bailout_message:
 # define MCE_CONFIG_CHANGE_SIG  "config_change_ind"
 #endif
 
+#ifndef MCE_CONFIG_GET_BATCH
+# define MCE_CONFIG_GET_BATCH   "get_configs"
+# define MCE_CONFIG_SET_BATCH   "set_configs"
+#endif
+
 /**
  * D-Bus callback for the config get method call
  *
@@ -1324,6 +1538,187 @@ NOREPLY:
 	return TRUE;
 }
 
+/** Apply value from D-Bus message to gconf key
+ *
+ * @param client GConfClient
+ * @param key    gconf key name
+ * @param iter   D-Bus message iterator pointing to the value
+ * @param err    where to store gconf errors
+ *
+ * @return NULL if the value type was acceptable, or error text
+ *         describing why the value could not be used
+ */
+static const char *config_value_apply(GConfClient *client, const char *key,
+				      DBusMessageIter *iter, GError **err)
+{
+	const char *fail = 0;
+	GSList     *list = 0;
+
+	switch( dbus_message_iter_get_arg_type(iter) ) {
+	case DBUS_TYPE_BOOLEAN:
+		{
+			dbus_bool_t arg = 0;
+			dbus_message_iter_get_basic(iter, &arg);
+			gconf_client_set_bool(client, key, arg, err);
+		}
+		break;
+	case DBUS_TYPE_INT32:
+		{
+			dbus_int32_t arg = 0;
+			dbus_message_iter_get_basic(iter, &arg);
+			gconf_client_set_int(client, key, arg, err);
+		}
+		break;
+	case DBUS_TYPE_DOUBLE:
+		{
+			double arg = 0;
+			dbus_message_iter_get_basic(iter, &arg);
+			gconf_client_set_float(client, key, arg, err);
+		}
+		break;
+	case DBUS_TYPE_STRING:
+		{
+			const char *arg = 0;
+			dbus_message_iter_get_basic(iter, &arg);
+			gconf_client_set_string(client, key, arg, err);
+		}
+		break;
+
+	case DBUS_TYPE_ARRAY:
+		switch( dbus_message_iter_get_element_type(iter) ) {
+		case DBUS_TYPE_BOOLEAN:
+			list = value_list_from_bool_array(iter);
+			gconf_client_set_list(client, key, GCONF_VALUE_BOOL, list, err);
+			break;
+		case DBUS_TYPE_INT32:
+			list = value_list_from_int_array(iter);
+			gconf_client_set_list(client, key, GCONF_VALUE_INT, list, err);
+			break;
+		case DBUS_TYPE_DOUBLE:
+			list = value_list_from_float_array(iter);
+			gconf_client_set_list(client, key, GCONF_VALUE_FLOAT, list, err);
+			break;
+		case DBUS_TYPE_STRING:
+			list = value_list_from_string_array(iter);
+			gconf_client_set_list(client, key, GCONF_VALUE_STRING, list, err);
+			break;
+		default:
+			fail = "unexpected value array type";
+			break;
+		}
+		break;
+
+	default:
+		fail = "unexpected value type";
+		break;
+	}
+
+	value_list_free(list);
+
+	return fail;
+}
+
+/** Result of comparing D-Bus value against gconf value */
+typedef enum {
+	CONFIG_VALUE_INVALID   = -1, /**< Types do not match */
+	CONFIG_VALUE_CHANGED   =  0, /**< Types match, values differ */
+	CONFIG_VALUE_UNCHANGED =  1, /**< Types and values match */
+} config_value_cmp_t;
+
+/** Compare value in D-Bus message against gconf value
+ *
+ * @param conf GConfValue
+ * @param iter D-Bus message iterator pointing to the value
+ *
+ * @return CONFIG_VALUE_INVALID, CONFIG_VALUE_CHANGED,
+ *         or CONFIG_VALUE_UNCHANGED
+ */
+static config_value_cmp_t config_value_compare(const GConfValue *conf,
+					       DBusMessageIter *iter)
+{
+	config_value_cmp_t res = CONFIG_VALUE_INVALID;
+	GConfValueType     want;
+
+	switch( dbus_message_iter_get_arg_type(iter) ) {
+	case DBUS_TYPE_BOOLEAN:
+		if( conf->type == GCONF_VALUE_BOOL ) {
+			dbus_bool_t arg = 0;
+			dbus_message_iter_get_basic(iter, &arg);
+			res = ((!arg == !gconf_value_get_bool(conf)) ?
+			       CONFIG_VALUE_UNCHANGED : CONFIG_VALUE_CHANGED);
+		}
+		break;
+	case DBUS_TYPE_INT32:
+		if( conf->type == GCONF_VALUE_INT ) {
+			dbus_int32_t arg = 0;
+			dbus_message_iter_get_basic(iter, &arg);
+			res = ((arg == gconf_value_get_int(conf)) ?
+			       CONFIG_VALUE_UNCHANGED : CONFIG_VALUE_CHANGED);
+		}
+		break;
+	case DBUS_TYPE_DOUBLE:
+		if( conf->type == GCONF_VALUE_FLOAT ) {
+			double arg = 0;
+			dbus_message_iter_get_basic(iter, &arg);
+			res = ((arg == gconf_value_get_float(conf)) ?
+			       CONFIG_VALUE_UNCHANGED : CONFIG_VALUE_CHANGED);
+		}
+		break;
+	case DBUS_TYPE_STRING:
+		if( conf->type == GCONF_VALUE_STRING ) {
+			const char *arg = 0;
+			dbus_message_iter_get_basic(iter, &arg);
+			res = (!strcmp(arg, gconf_value_get_string(conf) ?: "") ?
+			       CONFIG_VALUE_UNCHANGED : CONFIG_VALUE_CHANGED);
+		}
+		break;
+
+	case DBUS_TYPE_ARRAY:
+		if( conf->type != GCONF_VALUE_LIST )
+			break;
+
+		switch( dbus_message_iter_get_element_type(iter) ) {
+		case DBUS_TYPE_BOOLEAN: want = GCONF_VALUE_BOOL;   break;
+		case DBUS_TYPE_INT32:   want = GCONF_VALUE_INT;    break;
+		case DBUS_TYPE_DOUBLE:  want = GCONF_VALUE_FLOAT;  break;
+		case DBUS_TYPE_STRING:  want = GCONF_VALUE_STRING; break;
+		default:                want = GCONF_VALUE_INVALID; break;
+		}
+
+		if( want == GCONF_VALUE_INVALID ||
+		    want != gconf_value_get_list_type(conf) )
+			break;
+
+		{
+			DBusMessageIter  sub;
+			GSList          *item = gconf_value_get_list(conf);
+
+			res = CONFIG_VALUE_UNCHANGED;
+
+			dbus_message_iter_recurse(iter, &sub);
+			while( dbus_message_iter_get_arg_type(&sub) !=
+			       DBUS_TYPE_INVALID ) {
+				if( !item ||
+				    config_value_compare(item->data, &sub) !=
+				    CONFIG_VALUE_UNCHANGED ) {
+					res = CONFIG_VALUE_CHANGED;
+					break;
+				}
+				item = item->next;
+				dbus_message_iter_next(&sub);
+			}
+			if( item )
+				res = CONFIG_VALUE_CHANGED;
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	return res;
+}
+
 /**
  * D-Bus callback for the config set method call
  *
@@ -1338,7 +1733,7 @@ static gboolean config_set_dbus_cb(DBusMessage *const msg)
 	const char *key = NULL;
 	GError *err = NULL;
 	GConfClient *client = 0;
-	GSList *list = 0;
+	const char *fail = 0;
 
 	DBusError error = DBUS_ERROR_INIT;
 	DBusMessageIter body, iter;
@@ -1382,65 +1777,9 @@ static gboolean config_set_dbus_cb(DBusMessage *const msg)
 		goto EXIT;
 	}
 
-	switch( dbus_message_iter_get_arg_type(&iter) ) {
-	case DBUS_TYPE_BOOLEAN:
-		{
-			dbus_bool_t arg = 0;
-			dbus_message_iter_get_basic(&iter, &arg);
-			gconf_client_set_bool(client, key, arg, &err);
-		}
-		break;
-	case DBUS_TYPE_INT32:
-		{
-			dbus_int32_t arg = 0;
-			dbus_message_iter_get_basic(&iter, &arg);
-			gconf_client_set_int(client, key, arg, &err);
-		}
-		break;
-	case DBUS_TYPE_DOUBLE:
-		{
-			double arg = 0;
-			dbus_message_iter_get_basic(&iter, &arg);
-			gconf_client_set_float(client, key, arg, &err);
-		}
-		break;
-	case DBUS_TYPE_STRING:
-		{
-			const char *arg = 0;
-			dbus_message_iter_get_basic(&iter, &arg);
-			gconf_client_set_string(client, key, arg, &err);
-		}
-		break;
-
-	case DBUS_TYPE_ARRAY:
-		switch( dbus_message_iter_get_element_type(&iter) ) {
-		case DBUS_TYPE_BOOLEAN:
-			list = value_list_from_bool_array(&iter);
-			gconf_client_set_list(client, key, GCONF_VALUE_BOOL, list, &err);
-			break;
-		case DBUS_TYPE_INT32:
-			list = value_list_from_int_array(&iter);
-			gconf_client_set_list(client, key, GCONF_VALUE_INT, list, &err);
-			break;
-		case DBUS_TYPE_DOUBLE:
-			list = value_list_from_float_array(&iter);
-			gconf_client_set_list(client, key, GCONF_VALUE_FLOAT, list, &err);
-			break;
-		case DBUS_TYPE_STRING:
-			list = value_list_from_string_array(&iter);
-			gconf_client_set_list(client, key, GCONF_VALUE_STRING, list, &err);
-			break;
-		default:
-			reply = dbus_message_new_error(msg, DBUS_ERROR_INVALID_ARGS,
-						       "unexpected value array type");
-			goto EXIT;
-
-		}
-		break;
-
-	default:
+	if( (fail = config_value_apply(client, key, &iter, &err)) ) {
 		reply = dbus_message_new_error(msg, DBUS_ERROR_INVALID_ARGS,
-					       "unexpected value type");
+					       fail);
 		goto EXIT;
 	}
 
@@ -1471,8 +1810,6 @@ static gboolean config_set_dbus_cb(DBusMessage *const msg)
 	}
 
 EXIT:
-	value_list_free(list);
-
 	/* Send a reply if we have one */
 	if( reply ) {
 		if( dbus_message_get_no_reply(msg) ) {
@@ -1492,85 +1829,258 @@ EXIT:
 }
 
 /**
- * D-Bus rule checker
+ * D-Bus callback for the batched config get method call
+ *
+ * All requested keys must exist; otherwise an error reply is sent.
+ *
+ * @param msg The D-Bus message to reply to
  *
- * @param msg The D-Bus message being checked
- * @param rules The rule string to check against
- * @return TRUE if message matches the rules,
-	   FALSE if not
+ * @return TRUE if reply message was successfully sent, FALSE on failure
  */
-static gboolean check_rules(DBusMessage *const msg,
-			    const char *rules)
+static gboolean config_get_batch_dbus_cb(DBusMessage *const msg)
 {
-	if (rules == NULL)
-		return TRUE;
-	rules += strspn(rules, " ");;
+	gboolean status = FALSE;
+	DBusMessage *reply = NULL;
+	GError *err = NULL;
+	GConfClient *client = 0;
 
-	while (*rules != '\0') {
-		const char *eq;
-		const char *value;
-		const char *value_end;
-		const char *val = NULL;
-		gboolean quot = FALSE;
+	DBusMessageIter body, keys, resp, dict, entry;
 
-		if ((eq = strchr(rules, '=')) == NULL)
-			return FALSE;
-		eq += strspn(eq, " ");
+	mce_log(LL_DEBUG, "Received batched configuration query request");
 
-		if (eq[1] == '\'') {
-			value = eq + 2;
-			value_end = strchr(value, '\'');
-			quot = TRUE;
-		} else {
-			value = eq + 1;
-			value_end = strchrnul(value, ',');
+	if( !(client = gconf_client_get_default()) )
+		goto EXIT;
+
+	dbus_message_iter_init(msg, &body);
+
+	if( dbus_message_iter_get_arg_type(&body) != DBUS_TYPE_ARRAY ||
+	    dbus_message_iter_get_element_type(&body) != DBUS_TYPE_STRING ) {
+		reply = dbus_message_new_error(msg, DBUS_ERROR_INVALID_ARGS,
+					       "expected array of strings");
+		goto EXIT;
+	}
+	dbus_message_iter_recurse(&body, &keys);
+
+	if( !(reply = dbus_new_method_reply(msg)) )
+		goto EXIT;
+
+	dbus_message_iter_init_append(reply, &resp);
+
+	if( !dbus_message_iter_open_container(&resp, DBUS_TYPE_ARRAY,
+					      "{sv}", &dict) )
+		goto FAIL;
+
+	while( dbus_message_iter_get_arg_type(&keys) == DBUS_TYPE_STRING ) {
+		const char *key  = 0;
+		GConfValue *conf = 0;
+		gboolean    ack  = FALSE;
+
+		dbus_message_iter_get_basic(&keys, &key);
+		dbus_message_iter_next(&keys);
+
+		if( !(conf = gconf_client_get(client, key, &err)) ) {
+			dbus_message_iter_abandon_container(&resp, &dict);
+			dbus_message_unref(reply);
+			reply = dbus_message_new_error(msg,
+						       "com.nokia.mce.GConf.Error",
+						       err->message ?: "unknown");
+			goto EXIT;
 		}
 
-		if (value_end == NULL)
-			return FALSE;
+		if( dbus_message_iter_open_container(&dict, DBUS_TYPE_DICT_ENTRY,
+						     0, &entry) ) {
+			dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING,
+						       &key);
+			ack = (append_gconf_value_to_dbus_iterator(&entry, conf) &&
+			       dbus_message_iter_close_container(&dict, &entry));
+		}
 
-		if (strncmp(rules, "arg", 3) == 0) {
-			int fld = atoi(rules + 3);
+		gconf_value_free(conf);
 
-			DBusMessageIter iter;
+		if( !ack )
+			goto FAIL;
+	}
 
-			if (dbus_message_iter_init(msg, &iter) == FALSE)
-				return FALSE;
+	if( dbus_message_iter_close_container(&resp, &dict) )
+		goto EXIT;
 
-			for (; fld; fld--) {
-				if (dbus_message_iter_has_next(&iter) == FALSE)
-					return FALSE;
-				dbus_message_iter_next(&iter);
-			}
+FAIL:
+	dbus_message_unref(reply);
+	reply = dbus_message_new_error(msg,
+				       "com.nokia.mce.GConf.Error",
+				       "constructing reply failed");
 
-			if (dbus_message_iter_get_arg_type(&iter) !=
-			    DBUS_TYPE_STRING)
-				return FALSE;
-			dbus_message_iter_get_basic(&iter, &val);
+EXIT:
+	/* Send a reply if we have one */
+	if( reply ) {
+		if( dbus_message_get_no_reply(msg) ) {
+			dbus_message_unref(reply), reply = 0;
+			status = TRUE;
+		}
+		else {
+			/* dbus_send_message unrefs the reply message */
+			status = dbus_send_message(reply), reply = 0;
+		}
+	}
 
-		} else if (strncmp(rules, "path", 4) == 0) {
-			val = dbus_message_get_path(msg);
+	g_clear_error(&err);
+
+	return status;
+}
+
+/**
+ * D-Bus callback for the batched config set method call
+ *
+ * All values are validated before any of them are applied, so
+ * either all or none of the settings get changed. Change
+ * notifications are issued only for keys whose value actually
+ * changes, and the values file is written once at the end.
+ *
+ * @param msg The D-Bus message to reply to
+ *
+ * @return TRUE if reply message was successfully sent, FALSE on failure
+ */
+static gboolean config_set_batch_dbus_cb(DBusMessage *const msg)
+{
+	gboolean status = FALSE;
+	DBusMessage *reply = NULL;
+	GError *err = NULL;
+	GConfClient *client = 0;
+	int changed = 0;
+
+	DBusMessageIter body, dict, entry, iter;
+
+	mce_log(LL_DEBUG, "Received batched configuration change request");
+
+	if( !(client = gconf_client_get_default()) )
+		goto EXIT;
+
+	dbus_message_iter_init(msg, &body);
+
+	if( dbus_message_iter_get_arg_type(&body) != DBUS_TYPE_ARRAY ||
+	    dbus_message_iter_get_element_type(&body) != DBUS_TYPE_DICT_ENTRY ) {
+		reply = dbus_message_new_error(msg, DBUS_ERROR_INVALID_ARGS,
+					       "expected dictionary");
+		goto EXIT;
+	}
+
+	/* Pass 1: check that all keys exist and value types match */
+	dbus_message_iter_recurse(&body, &dict);
+	while( dbus_message_iter_get_arg_type(&dict) == DBUS_TYPE_DICT_ENTRY ) {
+		const char         *key  = 0;
+		GConfValue         *conf = 0;
+		config_value_cmp_t  cmp;
+
+		dbus_message_iter_recurse(&dict, &entry);
+		dbus_message_iter_next(&dict);
+
+		if( dbus_message_iter_get_arg_type(&entry) != DBUS_TYPE_STRING ) {
+			reply = dbus_message_new_error(msg, DBUS_ERROR_INVALID_ARGS,
+						       "expected string key");
+			goto EXIT;
+		}
+		dbus_message_iter_get_basic(&entry, &key);
+		dbus_message_iter_next(&entry);
+
+		if( dbus_message_iter_get_arg_type(&entry) != DBUS_TYPE_VARIANT ) {
+			reply = dbus_message_new_error(msg, DBUS_ERROR_INVALID_ARGS,
+						       "expected variant");
+			goto EXIT;
+		}
+		dbus_message_iter_recurse(&entry, &iter);
+
+		if( !(conf = gconf_client_get(client, key, &err)) ) {
+			reply = dbus_message_new_error(msg,
+						       "com.nokia.mce.GConf.Error",
+						       err->message ?: "unknown");
+			goto EXIT;
+		}
+
+		cmp = config_value_compare(conf, &iter);
+		gconf_value_free(conf);
+
+		if( cmp == CONFIG_VALUE_INVALID ) {
+			mce_log(LL_WARN, "%s: value type mismatch", key);
+			reply = dbus_message_new_error(msg, DBUS_ERROR_INVALID_ARGS,
+						       "unexpected value type");
+			goto EXIT;
 		}
+	}
+
+	/* Pass 2: apply values that differ from current ones */
+	dbus_message_iter_recurse(&body, &dict);
+	while( dbus_message_iter_get_arg_type(&dict) == DBUS_TYPE_DICT_ENTRY ) {
+		const char         *key  = 0;
+		GConfValue         *conf = 0;
+		config_value_cmp_t  cmp;
 
-		if (((value_end != NULL) &&
-		     ((strncmp(value, val, value_end - value) != 0) ||
-		      (val[value_end - value] != '\0'))) ||
-		    ((value_end == NULL) &&
-		     (strcmp(value, val) != 0)))
-			return FALSE;
+		dbus_message_iter_recurse(&dict, &entry);
+		dbus_message_iter_next(&dict);
 
-		if (value_end == NULL)
+		dbus_message_iter_get_basic(&entry, &key);
+		dbus_message_iter_next(&entry);
+		dbus_message_iter_recurse(&entry, &iter);
+
+		if( !(conf = gconf_client_get(client, key, &err)) )
 			break;
 
-		rules = value_end + (quot == TRUE ? 1 : 0);
-		rules += strspn(rules, " ");;
+		cmp = config_value_compare(conf, &iter);
+		gconf_value_free(conf);
 
-		if (*rules == ',')
-			rules++;
-		rules += strspn(rules, " ");;
+		if( cmp != CONFIG_VALUE_CHANGED )
+			continue;
+
+		config_value_apply(client, key, &iter, &err);
+		if( err )
+			break;
+
+		++changed;
 	}
 
-	return TRUE;
+	if( err ) {
+		/* Not expected after successful validation */
+		reply = dbus_message_new_error(msg,
+					       "com.nokia.mce.GConf.Error",
+					       err->message ?: "unknown");
+		goto EXIT;
+	}
+
+	mce_log(LL_DEBUG, "%d configuration values changed", changed);
+
+	if( changed ) {
+		gconf_client_suggest_sync(client, &err);
+		if( err ) {
+			mce_log(LL_ERR, "gconf_client_suggest_sync: %s",
+				err->message);
+		}
+	}
+
+	if( !(reply = dbus_new_method_reply(msg)) )
+		goto EXIT;
+
+	{
+		dbus_bool_t arg = TRUE;
+		dbus_message_append_args(reply,
+					 DBUS_TYPE_BOOLEAN, &arg,
+					 DBUS_TYPE_INVALID);
+	}
+
+EXIT:
+	/* Send a reply if we have one */
+	if( reply ) {
+		if( dbus_message_get_no_reply(msg) ) {
+			dbus_message_unref(reply), reply = 0;
+			status = TRUE;
+		}
+		else {
+			/* dbus_send_message unrefs the reply message */
+			status = dbus_send_message(reply), reply = 0;
+		}
+	}
+
+	g_clear_error(&err);
+
+	return status;
 }
 
 /** Build a dbus signal match string
@@ -1639,24 +2149,145 @@ EXIT:
 	return;
 }
 
-/** Check if message attribute value matches handler attribute value
+/** Release D-Bus handler lookup table bucket
  *
- * @return true on match, false otherwise
+ * For use as GHashTable value destroy function
  */
-static bool mce_dbus_match(const char *msg_val, const char *hnd_val)
+static void handler_bucket_delete_cb(gpointer self)
 {
-	/* Special case 1: If message attribute has null value,
-	 *                 no handler value can be a match */
-	if( !msg_val )
-		return false;
+	handler_bucket_t *bucket = self;
 
-	/* Special case 2: If handler attribyte has null value,
-	 *                 it mathes any non-null message value. */
-	if( !hnd_val )
-		return true;
+	if( !bucket )
+		goto EXIT;
+
+	g_slist_free(bucket->handlers);
+	g_free(bucket);
+
+EXIT:
+	return;
+}
+
+/** Format D-Bus handler lookup table key
+ *
+ * @param buff      Buffer to format the key into
+ * @param size      Size of the buffer
+ * @param type      DBUS_MESSAGE_TYPE
+ * @param interface D-Bus interface name
+ * @param member    D-Bus member name, or NULL for any member
+ *
+ * @return buff
+ */
+static const char *handler_lut_key(char *buff, size_t size, int type,
+				   const char *interface, const char *member)
+{
+	snprintf(buff, size, "%d %s %s", type, interface, member ?: "*");
+	return buff;
+}
+
+/** Locate D-Bus handler lookup table bucket
+ *
+ * @param type      DBUS_MESSAGE_TYPE
+ * @param interface D-Bus interface name
+ * @param member    D-Bus member name, or NULL for any member
+ *
+ * @return bucket, or NULL if there are no such handlers
+ */
+static handler_bucket_t *handler_lut_lookup(int type,
+					    const char *interface,
+					    const char *member)
+{
+	/* D-Bus names are limited to 255 characters */
+	char key[3 * 256];
+
+	if( !dbus_handler_lut )
+		return 0;
+
+	handler_lut_key(key, sizeof key, type, interface, member);
+	return g_hash_table_lookup(dbus_handler_lut, key);
+}
+
+/** Add D-Bus handler to the lookup table
+ *
+ * @param handler D-Bus handler structure
+ */
+static void handler_lut_add(handler_struct_t *handler)
+{
+	char              key[3 * 256];
+	handler_bucket_t *bucket;
+
+	/* Introspect only entries are never dispatched */
+	if( !handler->callback )
+		goto EXIT;
+
+	if( !dbus_handler_lut )
+		dbus_handler_lut = g_hash_table_new_full(g_str_hash,
+							 g_str_equal,
+							 g_free,
+							 handler_bucket_delete_cb);
+
+	handler_lut_key(key, sizeof key, handler->type,
+			handler->interface, handler->name);
+
+	if( !(bucket = g_hash_table_lookup(dbus_handler_lut, key)) ) {
+		bucket = g_malloc0(sizeof *bucket);
+		g_hash_table_insert(dbus_handler_lut, g_strdup(key), bucket);
+	}
+
+	bucket->handlers = g_slist_prepend(bucket->handlers, handler);
+
+EXIT:
+	return;
+}
+
+/** Detach D-Bus handler from the lookup table
+ *
+ * The bucket list itself is not modified so that possible ongoing
+ * iteration is not adversely affected. Cleanup happens at
+ * handler_lut_squeeze().
+ *
+ * @param handler D-Bus handler structure
+ */
+static void handler_lut_remove(handler_struct_t *handler)
+{
+	handler_bucket_t *bucket;
+	GSList           *item;
+
+	if( !handler->callback )
+		goto EXIT;
+
+	bucket = handler_lut_lookup(handler->type, handler->interface,
+				    handler->name);
+	if( !bucket )
+		goto EXIT;
+
+	if( (item = g_slist_find(bucket->handlers, handler)) )
+		item->data = 0;
+
+EXIT:
+	return;
+}
+
+/** Purge detached handlers and empty buckets from the lookup table
+ */
+static void handler_lut_squeeze(void)
+{
+	GHashTableIter    iter;
+	gpointer          val;
+	handler_bucket_t *bucket;
+
+	if( !dbus_handler_lut )
+		goto EXIT;
+
+	g_hash_table_iter_init(&iter, dbus_handler_lut);
+	while( g_hash_table_iter_next(&iter, 0, &val) ) {
+		bucket = val;
+		mce_dbus_squeeze_slist(&bucket->handlers);
+		if( !bucket->handlers )
+			g_hash_table_iter_remove(&iter);
+	}
 
-	/* Normally we just test for string equality */
-	return !strcmp(msg_val, hnd_val);
+EXIT:
+	return;
 }
 
 /**
@@ -1681,49 +2312,58 @@ static DBusHandlerResult msg_handler(DBusConnection *const connection,
 	const char *interface = dbus_message_get_interface(msg);
 	const char *member    = dbus_message_get_member(msg);
 
-	for( GSList *now = dbus_handlers; now; now = now->next ) {
+	handler_bucket_t *bucket;
+	GSList           *exact = 0;
+	GSList           *any   = 0;
 
-		handler_struct_t *handler = now->data;
+	/* All handlers have interface, and member is needed for
+	 * locating also the handlers that accept any member */
+	if( !interface || !member )
+		goto EXIT;
 
-		/* Skip half removed handlers */
-		if( !handler )
-			continue;
+	if( (bucket = handler_lut_lookup(type, interface, member)) )
+		exact = bucket->handlers;
 
-		/* Skip introspect only entries */
-		if( !handler->callback )
-			continue;
+	if( (bucket = handler_lut_lookup(type, interface, 0)) )
+		any = bucket->handlers;
 
-		/* Skip not applicable handlers */
-		if( handler->type != type )
-			continue;
+	++dbus_handler_dispatching;
 
-		switch( handler->type ) {
-		case DBUS_MESSAGE_TYPE_METHOD_CALL:
-			if( !mce_dbus_match(interface, handler->interface) )
-				break;
+	for( ;; ) {
+		handler_struct_t *handler = 0;
 
-			if( !mce_dbus_match(member, handler->name) )
-				break;
+		/* Skip half removed handlers */
+		while( exact && !exact->data )
+			exact = exact->next;
+		while( any && !any->data )
+			any = any->next;
 
-			handler->callback(msg);
-			status = DBUS_HANDLER_RESULT_HANDLED;
-			goto EXIT;
+		/* Merge the buckets in most recently added first order */
+		if( !exact && !any )
+			break;
 
-		case DBUS_MESSAGE_TYPE_ERROR:
-			if( !mce_dbus_match(member, handler->name) )
-				break;
+		if( !any ) {
+			handler = exact->data, exact = exact->next;
+		}
+		else if( !exact ) {
+			handler = any->data, any = any->next;
+		}
+		else if( ((handler_struct_t *)exact->data)->seq >
+			 ((handler_struct_t *)any->data)->seq ) {
+			handler = exact->data, exact = exact->next;
+		}
+		else {
+			handler = any->data, any = any->next;
+		}
 
+		switch( handler->type ) {
+		case DBUS_MESSAGE_TYPE_METHOD_CALL:
 			handler->callback(msg);
-			break;
+			status = DBUS_HANDLER_RESULT_HANDLED;
+			goto DONE;
 
 		case DBUS_MESSAGE_TYPE_SIGNAL:
-			if( !mce_dbus_match(interface, handler->interface) )
-				break;
-
-			if( !mce_dbus_match(member, handler->name) )
-				break;
-
-			if( !check_rules(msg, handler->rules) )
+			if( !handler_matcher_eval(&handler->matcher, msg) )
 				break;
 
 			handler->callback(msg);
@@ -1736,8 +2376,13 @@ static DBusHandlerResult msg_handler(DBusConnection *const connection,
 		}
 	}
 
+DONE:
 	/* Purge half removed handlers */
-	mce_dbus_squeeze_slist(&dbus_handlers);
+	if( --dbus_handler_dispatching == 0 && dbus_handler_squeeze_needed ) {
+		dbus_handler_squeeze_needed = false;
+		mce_dbus_squeeze_slist(&dbus_handlers);
+		handler_lut_squeeze();
+	}
 
 EXIT:
 	return status;
@@ -1802,7 +2447,9 @@ gconstpointer mce_dbus_handler_add_ex(const gchar *const interface,
 	if( match && callback )
 		dbus_bus_add_match(dbus_connection, match, 0);
 
+	handler->seq = ++dbus_handler_seq;
 	dbus_handlers = g_slist_prepend(dbus_handlers, handler);
+	handler_lut_add(handler);
 
 EXIT:
 	g_free(match);
@@ -1847,6 +2494,8 @@ void mce_dbus_handler_remove(gconstpointer cookie)
 		 * at msg_handler() and mce_dbus_exit().
 		 */
 		item->data = 0;
+		handler_lut_remove(handler);
+		dbus_handler_squeeze_needed = true;
 	}
 
 	if( handler->type == DBUS_MESSAGE_TYPE_SIGNAL ) {
@@ -2472,31 +3121,105 @@ mce_dbus_iter_get_variant(DBusMessageIter *iter, DBusMessageIter *sub)
 	return mce_dbus_iter_get_container(iter, sub, DBUS_TYPE_VARIANT);
 }
 
-/** Register D-Bus message handler
+/** Append histogram bucket counts to dbus message iterator
  *
- * @param self handler data
+ * Appends an array of uint64 values.
+ *
+ * @param iter dbus message iterator
+ * @param hist histogram statistics
+ *
+ * @return true on success, false otherwise
  */
-void
-mce_dbus_handler_register(mce_dbus_handler_t *self)
+bool
+mce_dbus_iter_append_hist_buckets(DBusMessageIter *iter,
+				  const mce_hist_t *hist)
 {
-	if( !self->cookie ) {
-		self->cookie = mce_dbus_handler_add_ex(self->interface,
-						       self->name,
-						       self->args,
-						       self->rules,
-						       self->type,
-						       self->callback);
-		if( !self->cookie )
-			mce_log(LL_ERR, "%s.%s: failed to add handler",
-				self->interface, self->name);
+	bool                 ack  = false;
+	const dbus_uint64_t *bins = hist->histogram;
+	int                  cnt  = MIN(hist->buckets, MCE_HIST_BUCKETS_MAX);
+	DBusMessageIter      sub;
+
+	if( !dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY,
+					      DBUS_TYPE_UINT64_AS_STRING,
+					      &sub) )
+		goto EXIT;
+
+	if( !dbus_message_iter_append_fixed_array(&sub, DBUS_TYPE_UINT64,
+						  &bins, cnt) ) {
+		dbus_message_iter_abandon_container(iter, &sub);
+		goto EXIT;
 	}
+
+	ack = dbus_message_iter_close_container(iter, &sub);
+
+EXIT:
+	return ack;
 }
 
-/** Unregister D-Bus message handler
+/** Append histogram statistics to dbus message iterator
  *
- * @param self handler data
- */
-void
+ * Appends a struct of type MCE_DBUS_HIST_SIGNATURE: name, sample
+ * count, sum of samples, largest sample and bucket counts.
+ *
+ * @param iter dbus message iterator
+ * @param hist histogram statistics
+ *
+ * @return true on success, false otherwise
+ */
+bool
+mce_dbus_iter_append_hist(DBusMessageIter *iter, const mce_hist_t *hist)
+{
+	bool            ack  = false;
+	const char     *name = hist->name ?: "";
+	DBusMessageIter sub;
+
+	if( !dbus_message_iter_open_container(iter, DBUS_TYPE_STRUCT,
+					      0, &sub) )
+		goto EXIT;
+
+	if( !dbus_message_iter_append_basic(&sub, DBUS_TYPE_STRING, &name) ||
+	    !dbus_message_iter_append_basic(&sub, DBUS_TYPE_UINT64,
+					    &hist->count) ||
+	    !dbus_message_iter_append_basic(&sub, DBUS_TYPE_UINT64,
+					    &hist->total) ||
+	    !dbus_message_iter_append_basic(&sub, DBUS_TYPE_UINT64,
+					    &hist->max) ||
+	    !mce_dbus_iter_append_hist_buckets(&sub, hist) ) {
+		dbus_message_iter_abandon_container(iter, &sub);
+		goto EXIT;
+	}
+
+	ack = dbus_message_iter_close_container(iter, &sub);
+
+EXIT:
+	return ack;
+}
+
+/** Register D-Bus message handler
+ *
+ * @param self handler data
+ */
+void
+mce_dbus_handler_register(mce_dbus_handler_t *self)
+{
+	if( !self->cookie ) {
+		self->cookie = mce_dbus_handler_add_ex(self->interface,
+						       self->name,
+						       self->args,
+						       self->rules,
+						       self->type,
+						       self->callback);
+		if( !self->cookie )
+			mce_log(LL_ERR, "%s.%s: failed to add handler",
+				self->interface, self->name);
+	}
+}
+
+/** Unregister D-Bus message handler
+ *
+ * @param self handler data
+ */
+void
 mce_dbus_handler_unregister(mce_dbus_handler_t *self)
 {
 	if( self->cookie )
@@ -3246,6 +3969,514 @@ EXIT:
 	return TRUE;
 }
 
+/* ========================================================================= *
+ * DATAPIPE_STATISTICS
+ * ========================================================================= */
+
+/** Get human readable name for a datapipe filter / trigger function
+ *
+ * Static functions are not visible to dladdr(), in which case the
+ * function is identified by object file name and offset that can be
+ * resolved with addr2line.
+ *
+ * @param callback function pointer, or NULL
+ * @param buff     buffer for constructing the name
+ * @param size     size of the buffer
+ *
+ * @return name of the function
+ */
+static const char *
+datapipe_stats_callback_repr(gpointer callback, char *buff, size_t size)
+{
+	Dl_info info;
+
+	if( !callback ) {
+		snprintf(buff, size, "-");
+	}
+	else if( !dladdr(callback, &info) ) {
+		snprintf(buff, size, "%p", callback);
+	}
+	else if( info.dli_sname ) {
+		snprintf(buff, size, "%s", info.dli_sname);
+	}
+	else {
+		const char *file = info.dli_fname ?: "?";
+		const char *base = strrchr(file, '/');
+		snprintf(buff, size, "%s+0x%lx", base ? base + 1 : file,
+			 (unsigned long)((char *)callback -
+					 (char *)info.dli_fbase));
+	}
+
+	return buff;
+}
+
+/** Callback for appending statistics of one datapipe to D-Bus message
+ *
+ * @param name      datapipe name
+ * @param stats     datapipe execution statistics
+ * @param user_data array iterator as void pointer
+ */
+static void
+datapipe_stats_append_cb(const char *name, const datapipe_stats_t *stats,
+			 gpointer user_data)
+{
+	DBusMessageIter *arr = user_data;
+	DBusMessageIter  sub;
+	char             buff[256];
+	const char      *worst;
+
+	/* Skip datapipes that have not been executed at all */
+	if( !stats->execution.count && !stats->worst_callback )
+		goto EXIT;
+
+	worst = datapipe_stats_callback_repr(stats->worst_callback,
+					     buff, sizeof buff);
+
+	if( !dbus_message_iter_open_container(arr, DBUS_TYPE_STRUCT,
+					      0, &sub) )
+		goto EXIT;
+
+	dbus_message_iter_append_basic(&sub, DBUS_TYPE_STRING, &name);
+	dbus_message_iter_append_basic(&sub, DBUS_TYPE_UINT64,
+				       &stats->execution.count);
+	dbus_message_iter_append_basic(&sub, DBUS_TYPE_UINT64,
+				       &stats->filter_time);
+	dbus_message_iter_append_basic(&sub, DBUS_TYPE_UINT64,
+				       &stats->filter_max);
+	dbus_message_iter_append_basic(&sub, DBUS_TYPE_UINT64,
+				       &stats->input_time);
+	dbus_message_iter_append_basic(&sub, DBUS_TYPE_UINT64,
+				       &stats->input_max);
+	dbus_message_iter_append_basic(&sub, DBUS_TYPE_UINT64,
+				       &stats->output_time);
+	dbus_message_iter_append_basic(&sub, DBUS_TYPE_UINT64,
+				       &stats->output_max);
+	dbus_message_iter_append_basic(&sub, DBUS_TYPE_STRING, &worst);
+	dbus_message_iter_append_basic(&sub, DBUS_TYPE_UINT64,
+				       &stats->worst_callback_time);
+
+	mce_dbus_iter_append_hist_buckets(&sub, &stats->execution);
+
+	dbus_message_iter_close_container(arr, &sub);
+
+EXIT:
+	return;
+}
+
+/** D-Bus callback for the get datapipe statistics method call
+ *
+ * @param msg The D-Bus message to reply to
+ *
+ * @return TRUE
+ */
+static gboolean datapipe_stats_get_dbus_cb(DBusMessage *const msg)
+{
+	DBusMessage     *reply = 0;
+	DBusMessageIter  body, arr;
+
+	mce_log(LL_DEBUG, "Received datapipe statistics request");
+
+	if( dbus_message_get_no_reply(msg) )
+		goto EXIT;
+
+	if( !(reply = dbus_new_method_reply(msg)) )
+		goto EXIT;
+
+	dbus_message_iter_init_append(reply, &body);
+
+	if( !dbus_message_iter_open_container(&body, DBUS_TYPE_ARRAY,
+					      "(stttttttstat)", &arr) ) {
+		mce_log(LL_ERR, "Failed to append reply argument to D-Bus"
+			" message for %s.%s",
+			MCE_REQUEST_IF, MCE_DATAPIPE_STATS_GET);
+		goto EXIT;
+	}
+
+	datapipe_stats_foreach(datapipe_stats_append_cb, &arr);
+
+	dbus_message_iter_close_container(&body, &arr);
+
+	dbus_send_message(reply), reply = 0;
+
+EXIT:
+	if( reply ) dbus_message_unref(reply);
+
+	return TRUE;
+}
+
+/** D-Bus callback for the reset datapipe statistics method call
+ *
+ * @param msg The D-Bus message to reply to
+ *
+ * @return TRUE
+ */
+static gboolean datapipe_stats_reset_dbus_cb(DBusMessage *const msg)
+{
+	DBusMessage *reply = 0;
+
+	mce_log(LL_DEVEL, "Received datapipe statistics reset request");
+
+	datapipe_stats_reset();
+
+	if( dbus_message_get_no_reply(msg) )
+		goto EXIT;
+
+	if( (reply = dbus_new_method_reply(msg)) )
+		dbus_send_message(reply), reply = 0;
+
+EXIT:
+	return TRUE;
+}
+
+/** D-Bus callback for the enable datapipe statistics method call
+ *
+ * @param msg The D-Bus message to reply to
+ *
+ * @return TRUE
+ */
+static gboolean datapipe_stats_enable_dbus_cb(DBusMessage *const msg)
+{
+	DBusMessage *reply   = 0;
+	DBusError    error   = DBUS_ERROR_INIT;
+	dbus_bool_t  enabled = FALSE;
+
+	mce_log(LL_DEVEL, "Received datapipe statistics enable request");
+
+	if( !dbus_message_get_args(msg, &error,
+				   DBUS_TYPE_BOOLEAN, &enabled,
+				   DBUS_TYPE_INVALID) ) {
+		mce_log(LL_ERR, "%s: %s", error.name, error.message);
+		goto EXIT;
+	}
+
+	datapipe_stats_set_enabled(enabled);
+
+	if( dbus_message_get_no_reply(msg) )
+		goto EXIT;
+
+	if( (reply = dbus_new_method_reply(msg)) )
+		dbus_send_message(reply), reply = 0;
+
+EXIT:
+	dbus_error_free(&error);
+	return TRUE;
+}
+
+/** D-Bus callback for the dump flight recorder method call
+ *
+ * @param msg The D-Bus message to reply to
+ *
+ * @return TRUE
+ */
+static gboolean flight_recorder_dump_dbus_cb(DBusMessage *const msg)
+{
+	DBusMessage *reply = 0;
+	const char  *path  = 0;
+
+	mce_log(LL_DEVEL, "Received flight recorder dump request");
+
+	if( !(path = mce_log_dump_recorder(0)) ) {
+		mce_log(LL_ERR, "Failed to dump flight recorder: %m");
+		path = "";
+	}
+
+	if( dbus_message_get_no_reply(msg) )
+		goto EXIT;
+
+	if( !(reply = dbus_new_method_reply(msg)) )
+		goto EXIT;
+
+	dbus_message_append_args(reply,
+				 DBUS_TYPE_STRING, &path,
+				 DBUS_TYPE_INVALID);
+
+	dbus_send_message(reply), reply = 0;
+
+EXIT:
+	return TRUE;
+}
+
+/* ========================================================================= *
+ * STATE_QUERY
+ * ========================================================================= */
+
+/** Value of one state query item */
+typedef union
+{
+	const char   *s; /**< Value for DBUS_TYPE_STRING items */
+	dbus_bool_t   b; /**< Value for DBUS_TYPE_BOOLEAN items */
+	dbus_int32_t  i; /**< Value for DBUS_TYPE_INT32 items */
+} state_query_value_t;
+
+/** State query item */
+typedef struct
+{
+	const char *key;                          /**< Dictionary key */
+	int         type;                         /**< DBUS_TYPE_xxx */
+	void      (*eval)(state_query_value_t *); /**< Value getter */
+} state_query_item_t;
+
+/** Display status as reported by MCE_DISPLAY_STATUS_GET */
+static void state_query_display_status(state_query_value_t *val)
+{
+	switch( datapipe_get_gint(display_state_next_pipe) ) {
+	case MCE_DISPLAY_ON:
+		val->s = MCE_DISPLAY_ON_STRING;
+		break;
+	case MCE_DISPLAY_DIM:
+		val->s = MCE_DISPLAY_DIM_STRING;
+		break;
+	default:
+		val->s = MCE_DISPLAY_OFF_STRING;
+		break;
+	}
+}
+
+/** Tklock mode as reported by MCE_TKLOCK_MODE_GET */
+static void state_query_tklock_mode(state_query_value_t *val)
+{
+	submode_t submode = datapipe_get_gint(submode_pipe);
+
+	val->s = (submode & MCE_TKLOCK_SUBMODE) ?
+		MCE_TK_LOCKED : MCE_TK_UNLOCKED;
+}
+
+/** Call state as reported by MCE_CALL_STATE_GET */
+static void state_query_call_state(state_query_value_t *val)
+{
+	val->s = call_state_repr(datapipe_get_gint(call_state_pipe));
+}
+
+/** Call type as reported by MCE_CALL_STATE_GET */
+static void state_query_call_type(state_query_value_t *val)
+{
+	val->s = call_type_repr(datapipe_get_gint(call_type_pipe));
+}
+
+/** Blanking policy as reported by MCE_BLANKING_POLICY_GET */
+static void state_query_blanking_policy(state_query_value_t *val)
+{
+	val->s = uiexctype_to_dbus(datapipe_get_gint(exception_state_pipe));
+}
+
+/** Power saving mode as reported by MCE_PSM_STATE_GET */
+static void state_query_psm_state(state_query_value_t *val)
+{
+	val->b = datapipe_get_gint(power_saving_mode_pipe) != 0;
+}
+
+/** Inactivity as reported by MCE_INACTIVITY_STATUS_GET */
+static void state_query_inactivity_status(state_query_value_t *val)
+{
+	val->b = datapipe_get_gint(device_inactive_pipe) != 0;
+}
+
+/** Key backlight as reported by MCE_KEY_BACKLIGHT_STATE_GET */
+static void state_query_key_backlight_state(state_query_value_t *val)
+{
+	val->b = datapipe_get_gint(key_backlight_pipe) != 0;
+}
+
+/** Master radio switch state */
+static void state_query_master_radio(state_query_value_t *val)
+{
+	val->b = datapipe_get_gint(master_radio_pipe) != 0;
+}
+
+/** System state */
+static void state_query_system_state(state_query_value_t *val)
+{
+	val->s = system_state_repr(datapipe_get_gint(system_state_pipe));
+}
+
+/** Charger state */
+static void state_query_charger_state(state_query_value_t *val)
+{
+	val->s = charger_state_repr(datapipe_get_gint(charger_state_pipe));
+}
+
+/** Battery status */
+static void state_query_battery_status(state_query_value_t *val)
+{
+	val->s = battery_status_repr(datapipe_get_gint(battery_status_pipe));
+}
+
+/** Battery level [%] */
+static void state_query_battery_level(state_query_value_t *val)
+{
+	val->i = datapipe_get_gint(battery_level_pipe);
+}
+
+/** USB cable state */
+static void state_query_usb_cable_state(state_query_value_t *val)
+{
+	val->s = usb_cable_state_repr(datapipe_get_gint(usb_cable_pipe));
+}
+
+/** Device lock state */
+static void state_query_device_lock_state(state_query_value_t *val)
+{
+	val->s = device_lock_state_repr(datapipe_get_gint(device_lock_state_pipe));
+}
+
+/** States available via MCE_STATE_QUERY_GET */
+static const state_query_item_t state_query_items[] =
+{
+	{ "display_status",      DBUS_TYPE_STRING,  state_query_display_status      },
+	{ "tklock_mode",         DBUS_TYPE_STRING,  state_query_tklock_mode         },
+	{ "call_state",          DBUS_TYPE_STRING,  state_query_call_state          },
+	{ "call_type",           DBUS_TYPE_STRING,  state_query_call_type           },
+	{ "blanking_policy",     DBUS_TYPE_STRING,  state_query_blanking_policy     },
+	{ "psm_state",           DBUS_TYPE_BOOLEAN, state_query_psm_state           },
+	{ "inactivity_status",   DBUS_TYPE_BOOLEAN, state_query_inactivity_status   },
+	{ "key_backlight_state", DBUS_TYPE_BOOLEAN, state_query_key_backlight_state },
+	{ "master_radio",        DBUS_TYPE_BOOLEAN, state_query_master_radio        },
+	{ "system_state",        DBUS_TYPE_STRING,  state_query_system_state        },
+	{ "charger_state",       DBUS_TYPE_STRING,  state_query_charger_state       },
+	{ "battery_status",      DBUS_TYPE_STRING,  state_query_battery_status      },
+	{ "battery_level",       DBUS_TYPE_INT32,   state_query_battery_level       },
+	{ "usb_cable_state",     DBUS_TYPE_STRING,  state_query_usb_cable_state     },
+	{ "device_lock_state",   DBUS_TYPE_STRING,  state_query_device_lock_state   },
+};
+
+/** Check if state query key is included in the optional key filter
+ *
+ * @param filter iterator pointing to array of strings, or NULL
+ * @param key    state query item key
+ *
+ * @return true if the key should be included in the reply
+ */
+static bool state_query_wanted(const DBusMessageIter *filter, const char *key)
+{
+	DBusMessageIter arr = *filter;
+	bool            empty = true;
+
+	while( dbus_message_iter_get_arg_type(&arr) == DBUS_TYPE_STRING ) {
+		const char *want = 0;
+		dbus_message_iter_get_basic(&arr, &want);
+		if( !strcmp(want, key) )
+			return true;
+		dbus_message_iter_next(&arr);
+		empty = false;
+	}
+
+	/* Empty filter: everything is included */
+	return empty;
+}
+
+/** Append one state query item to dictionary
+ *
+ * @param dict dictionary iterator
+ * @param item state query item
+ *
+ * @return true on success, false on failure
+ */
+static bool state_query_append(DBusMessageIter *dict,
+			       const state_query_item_t *item)
+{
+	DBusMessageIter     ent, var;
+	state_query_value_t val = { .s = 0 };
+	char                sig[2] = { (char)item->type, 0 };
+
+	item->eval(&val);
+
+	if( !dbus_message_iter_open_container(dict, DBUS_TYPE_DICT_ENTRY,
+					      0, &ent) )
+		return false;
+
+	dbus_message_iter_append_basic(&ent, DBUS_TYPE_STRING, &item->key);
+
+	if( !dbus_message_iter_open_container(&ent, DBUS_TYPE_VARIANT,
+					      sig, &var) )
+		return false;
+
+	dbus_message_iter_append_basic(&var, item->type, &val);
+
+	return (dbus_message_iter_close_container(&ent, &var) &&
+		dbus_message_iter_close_container(dict, &ent));
+}
+
+/** D-Bus callback for the bulk state query method call
+ *
+ * Optional argument is an array of keys to include in the reply;
+ * if omitted or empty, all states are included.
+ *
+ * @param msg The D-Bus message to reply to
+ *
+ * @return TRUE
+ */
+static gboolean state_query_get_dbus_cb(DBusMessage *const msg)
+{
+	DBusMessage     *reply = 0;
+	DBusMessageIter  body, filter, dict;
+
+	mce_log(LL_DEBUG, "Received state query request");
+
+	if( dbus_message_get_no_reply(msg) )
+		goto EXIT;
+
+	dbus_message_iter_init(msg, &body);
+
+	switch( dbus_message_iter_get_arg_type(&body) ) {
+	case DBUS_TYPE_INVALID:
+		/* No filter; iterator at end yields empty filter */
+		filter = body;
+		break;
+
+	case DBUS_TYPE_ARRAY:
+		if( dbus_message_iter_get_element_type(&body) ==
+		    DBUS_TYPE_STRING ) {
+			dbus_message_iter_recurse(&body, &filter);
+			break;
+		}
+		/* Fall through */
+
+	default:
+		reply = dbus_message_new_error(msg, DBUS_ERROR_INVALID_ARGS,
+					       "expected array of strings");
+		goto SEND;
+	}
+
+	if( !(reply = dbus_new_method_reply(msg)) )
+		goto EXIT;
+
+	dbus_message_iter_init_append(reply, &body);
+
+	if( !dbus_message_iter_open_container(&body, DBUS_TYPE_ARRAY,
+					      "{sv}", &dict) )
+		goto FAIL;
+
+	for( size_t i = 0; i < G_N_ELEMENTS(state_query_items); ++i ) {
+		if( !state_query_wanted(&filter, state_query_items[i].key) )
+			continue;
+		if( !state_query_append(&dict, state_query_items + i) )
+			goto FAIL;
+	}
+
+	if( !dbus_message_iter_close_container(&body, &dict) )
+		goto FAIL;
+
+	goto SEND;
+
+FAIL:
+	mce_log(LL_ERR, "Failed to append reply argument to D-Bus"
+		" message for %s.%s",
+		MCE_REQUEST_IF, MCE_STATE_QUERY_GET);
+	dbus_message_unref(reply);
+	reply = dbus_message_new_error(msg, DBUS_ERROR_FAILED,
+				       "constructing reply failed");
+
+SEND:
+	/* dbus_send_message unrefs the reply message */
+	if( reply )
+		dbus_send_message(reply), reply = 0;
+
+EXIT:
+	if( reply ) dbus_message_unref(reply);
+
+	return TRUE;
+}
+
 /* ========================================================================= *
  * DBUS_NAME_OWNER_TRACKING
  * ========================================================================= */
@@ -3604,6 +4835,24 @@ static mce_dbus_handler_t mce_dbus_handlers[] =
 			"    <arg direction=\"in\" name=\"key_value\" type=\"v\"/>\n"
 			"    <arg direction=\"out\" name=\"success\" type=\"b\"/>\n"
 	},
+	{
+		.interface = MCE_REQUEST_IF,
+		.name      = MCE_CONFIG_GET_BATCH,
+		.type      = DBUS_MESSAGE_TYPE_METHOD_CALL,
+		.callback  = config_get_batch_dbus_cb,
+		.args      =
+			"    <arg direction=\"in\" name=\"key_names\" type=\"as\"/>\n"
+			"    <arg direction=\"out\" name=\"key_values\" type=\"a{sv}\"/>\n"
+	},
+	{
+		.interface = MCE_REQUEST_IF,
+		.name      = MCE_CONFIG_SET_BATCH,
+		.type      = DBUS_MESSAGE_TYPE_METHOD_CALL,
+		.callback  = config_set_batch_dbus_cb,
+		.args      =
+			"    <arg direction=\"in\" name=\"key_values\" type=\"a{sv}\"/>\n"
+			"    <arg direction=\"out\" name=\"success\" type=\"b\"/>\n"
+	},
 	{
 		.interface = MCE_REQUEST_IF,
 		.name      = MCE_CONFIG_RESET,
@@ -3613,6 +4862,47 @@ static mce_dbus_handler_t mce_dbus_handlers[] =
 			"    <arg direction=\"in\" name=\"key_part\" type=\"s\"/>\n"
 			"    <arg direction=\"out\" name=\"count\" type=\"i\"/>\n"
 	},
+	{
+		.interface = MCE_REQUEST_IF,
+		.name      = MCE_DATAPIPE_STATS_GET,
+		.type      = DBUS_MESSAGE_TYPE_METHOD_CALL,
+		.callback  = datapipe_stats_get_dbus_cb,
+		.args      =
+			"    <arg direction=\"out\" name=\"stats\" type=\"a(stttttttstat)\"/>\n"
+	},
+	{
+		.interface = MCE_REQUEST_IF,
+		.name      = MCE_DATAPIPE_STATS_RESET,
+		.type      = DBUS_MESSAGE_TYPE_METHOD_CALL,
+		.callback  = datapipe_stats_reset_dbus_cb,
+		.args      =
+			""
+	},
+	{
+		.interface = MCE_REQUEST_IF,
+		.name      = MCE_DATAPIPE_STATS_ENABLE,
+		.type      = DBUS_MESSAGE_TYPE_METHOD_CALL,
+		.callback  = datapipe_stats_enable_dbus_cb,
+		.args      =
+			"    <arg direction=\"in\" name=\"enabled\" type=\"b\"/>\n"
+	},
+	{
+		.interface = MCE_REQUEST_IF,
+		.name      = MCE_FLIGHT_RECORDER_DUMP,
+		.type      = DBUS_MESSAGE_TYPE_METHOD_CALL,
+		.callback  = flight_recorder_dump_dbus_cb,
+		.args      =
+			"    <arg direction=\"out\" name=\"path\" type=\"s\"/>\n"
+	},
+	{
+		.interface = MCE_REQUEST_IF,
+		.name      = MCE_STATE_QUERY_GET,
+		.type      = DBUS_MESSAGE_TYPE_METHOD_CALL,
+		.callback  = state_query_get_dbus_cb,
+		.args      =
+			"    <arg direction=\"in\" name=\"keys\" type=\"as\"/>\n"
+			"    <arg direction=\"out\" name=\"states\" type=\"a{sv}\"/>\n"
+	},
 	{
 		.interface = DBUS_INTERFACE_INTROSPECTABLE,
 		.name      = "Introspect",
@@ -3705,6 +4995,9 @@ void mce_dbus_exit(void)
 		dbus_handlers = 0;
 	}
 
+	if( dbus_handler_lut )
+		g_hash_table_unref(dbus_handler_lut), dbus_handler_lut = 0;
+
 	/* If there is an established D-Bus connection, unreference it */
 	if (dbus_connection != NULL) {
 		mce_log(LL_DEBUG, "Unreferencing D-Bus connection");
@@ -22,6 +22,7 @@
 #define _MCE_DBUS_H_
 
 #include "builtin-gconf.h"
+#include "mce-lib.h"
 
 #include <stdbool.h>
 
@@ -72,6 +73,41 @@
 /** Current usb mode changed signal */
 #define USB_MODED_MODE_CHANGED_SIG  "sig_usb_state_ind"
 
+/* ========================================================================= *
+ * MCE DIAGNOSTIC METHODS
+ * ========================================================================= */
+
+/** Query datapipe execution statistics */
+#define MCE_DATAPIPE_STATS_GET      "get_datapipe_stats"
+
+/** Reset datapipe execution statistics */
+#define MCE_DATAPIPE_STATS_RESET    "reset_datapipe_stats"
+
+/** Enable / disable collecting datapipe execution statistics */
+#define MCE_DATAPIPE_STATS_ENABLE   "set_datapipe_stats_enabled"
+
+/** Query input latency histograms */
+#define MCE_INPUT_LATENCY_GET       "get_input_latency"
+
+/** Reset input latency histograms */
+#define MCE_INPUT_LATENCY_RESET     "reset_input_latency"
+
+/** Dump flight recorder of recent log events to a file */
+#define MCE_FLIGHT_RECORDER_DUMP    "dump_flight_recorder"
+
+/** Query display state machine transition timing statistics */
+#define MCE_DISPLAY_STM_STATS_GET   "get_display_stm_stats"
+
+/** Reset display state machine transition timing statistics */
+#define MCE_DISPLAY_STM_STATS_RESET "reset_display_stm_stats"
+
+/* ========================================================================= *
+ * MCE STATE QUERY METHODS
+ * ========================================================================= */
+
+/** Query cached MCE states in one dictionary */
+#define MCE_STATE_QUERY_GET         "get_states"
+
 DBusConnection *dbus_connection_get(void);
 
 DBusMessage *dbus_new_signal(const gchar *const path,
@@ -160,6 +196,13 @@ void mce_dbus_handler_unregister(mce_dbus_handler_t *self);
 void mce_dbus_handler_register_array(mce_dbus_handler_t *array);
 void mce_dbus_handler_unregister_array(mce_dbus_handler_t *array);
 
+/** D-Bus signature of histogram statistics struct */
+#define MCE_DBUS_HIST_SIGNATURE "(stttat)"
+
+bool mce_dbus_iter_append_hist_buckets(DBusMessageIter *iter,
+				       const mce_hist_t *hist);
+bool mce_dbus_iter_append_hist(DBusMessageIter *iter, const mce_hist_t *hist);
+
 char *mce_dbus_message_repr(DBusMessage *const msg);
 char *mce_dbus_message_iter_repr(DBusMessageIter *iter);
 
@@ -500,6 +500,18 @@ void mce_gconf_track_string(const gchar *key, gchar **val, const gchar *def,
 	g_free(path);
 }
 
+/**
+ * Write pending GConf changes to persistent storage
+ *
+ * Changes are saved with a delay; this forces them out immediately
+ * and blocks until the write has finished.
+ */
+void mce_gconf_flush(void)
+{
+	if( gconf_client )
+		gconf_client_flush(gconf_client, NULL);
+}
+
 /**
  * Init function for the mce-gconf component
  *
@@ -527,6 +539,9 @@ EXIT:
 void mce_gconf_exit(void)
 {
 	if( gconf_client ) {
+		/* Make sure delayed changes do not get lost */
+		gconf_client_flush(gconf_client, NULL);
+
 		/* Free the list of GConf notifiers */
 		g_slist_foreach(gconf_notifiers, mce_gconf_notifier_remove_cb, 0);
 		gconf_notifiers = 0;
@@ -43,6 +43,8 @@ void mce_gconf_track_int(const gchar *key, gint *val, gint def,
 void mce_gconf_track_string(const gchar *key, gchar **val, const gchar *def,
 			    GConfClientNotifyFunc cb, guint *cb_id);
 
+void mce_gconf_flush(void);
+
 gboolean mce_gconf_init(void);
 void mce_gconf_exit(void);
 
@@ -28,6 +28,7 @@
 
 #include "mce.h"
 #include "mce-log.h"
+#include "mce-conf.h"
 
 #ifdef ENABLE_WAKELOCKS
 # include "libwakelock.h"
@@ -35,6 +36,8 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/epoll.h>
 
 #include <stdlib.h>
 #include <stdint.h>
@@ -46,6 +49,14 @@
 
 #include <iphbd/libiphb.h>
 
+#ifndef CLOCK_BOOTTIME_ALARM
+# define CLOCK_BOOTTIME_ALARM 9
+#endif
+
+#ifndef EPOLLWAKEUP
+# define EPOLLWAKEUP (1u << 29)
+#endif
+
 /* ========================================================================= *
  * Types and functions
  * ========================================================================= */
@@ -69,11 +80,29 @@ struct mce_hbtimer_t
     /** Timer delay in milliseconds */
     int         hbt_period;
 
+    /** How late the timer is allowed to trigger, in milliseconds */
+    int         hbt_slack;
+
+    /** Flag for: restarting only extends the deadline */
+    bool        hbt_lazy;
+
+    /** Lazily extended trigger time, or NO_TICK */
+    int64_t     hbt_deadline;
+
     /** Flag for: control within hbt_notify() */
     bool        hbt_in_notify;
 
     /** User data to pass to hbt_notify() */
     void       *hbt_user_data;
+
+    /** Position in mht_queue_heap, or -1 if not queued */
+    ssize_t     hbt_heap_index;
+
+    /** Flag for: timer is in mht_queue_due_list */
+    bool        hbt_due;
+
+    /** Next timer in mht_queue_due_list */
+    mce_hbtimer_t *hbt_due_next;
 };
 
 mce_hbtimer_t * mce_hbtimer_create         (const char *name, int period, GSourceFunc notify, void *user_data);
@@ -82,6 +111,8 @@ void            mce_hbtimer_delete         (mce_hbtimer_t *self);
 bool            mce_hbtimer_is_active      (const mce_hbtimer_t *self);
 const char     *mce_hbtimer_get_name       (const mce_hbtimer_t *self);
 void            mce_hbtimer_set_period     (mce_hbtimer_t *self, int period);
+void            mce_hbtimer_set_slack      (mce_hbtimer_t *self, int slack);
+void            mce_hbtimer_set_lazy       (mce_hbtimer_t *self, bool lazy);
 void            mce_hbtimer_start          (mce_hbtimer_t *self);
 void            mce_hbtimer_stop           (mce_hbtimer_t *self);
 
@@ -102,12 +133,32 @@ static guint    mht_add_iowatch            (int fd, bool close_on_unref, GIOCond
  * QUEUE_MANAGEMENT
  * ------------------------------------------------------------------------- */
 
-/** List of registered timers */
-static GSList *mht_queue_timer_list = 0;
+/** Set of registered timers */
+static GHashTable *mht_queue_timer_set = 0;
+
+/** Binary min-heap of active timers, ordered by hbt_trigger */
+static mce_hbtimer_t **mht_queue_heap = 0;
+
+/** Number of timers in mht_queue_heap */
+static size_t mht_queue_heap_len = 0;
+
+/** Number of slots allocated for mht_queue_heap */
+static size_t mht_queue_heap_size = 0;
+
+/** Triggered timers waiting to be notified during dispatching */
+static mce_hbtimer_t *mht_queue_due_list = 0;
+
+static void     mht_queue_heap_place       (mce_hbtimer_t *self, size_t pos);
+static void     mht_queue_heap_sift_up     (size_t pos);
+static void     mht_queue_heap_sift_down   (size_t pos);
+static void     mht_queue_heap_insert      (mce_hbtimer_t *self);
+static void     mht_queue_heap_remove      (mce_hbtimer_t *self);
+static void     mht_queue_update_timer     (mce_hbtimer_t *self);
+static void     mht_queue_unlink_due       (mce_hbtimer_t *self);
+static int64_t  mht_queue_heap_deadline    (size_t pos, int64_t deadline);
 
 void            mht_queue_dispatch_timers  (void);
 static void     mht_queue_schedule_wakeups (void);
-static void     mht_queue_garbage_collect  (void);
 static void     mht_queue_add_timer        (mce_hbtimer_t *self);
 static void     mht_queue_remove_timer     (mce_hbtimer_t *self);
 static bool     mht_queue_has_timer        (const mce_hbtimer_t *self);
@@ -122,6 +173,42 @@ static guint mce_hbtimer_glib_wait_id = 0;
 static gboolean mht_glib_wakeup_cb         (gpointer aptr);
 static void     mht_glib_set_wakeup        (int64_t trigger, int64_t now);
 
+/* ------------------------------------------------------------------------- *
+ * TIMERFD_WAKEUPS
+ * ------------------------------------------------------------------------- */
+
+/** Configuration group for heartbeat timer tunables */
+#define MCE_CONF_HBTIMER_GROUP          "HeartbeatTimer"
+
+/** Configuration key for clock to use with timerfd wakeups */
+#define MCE_CONF_HBTIMER_TIMERFD_CLOCK  "TimerfdClock"
+
+/** Default value for MCE_CONF_HBTIMER_TIMERFD_CLOCK */
+#define DEFAULT_HBTIMER_TIMERFD_CLOCK   "alarm"
+
+/** File descriptor for timerfd wakeups, or -1 if not in use */
+static int      mht_timerfd_fd = -1;
+
+/** Flag for: timerfd can wake the device up from suspend */
+static bool     mht_timerfd_wakes_up = false;
+
+/** Cached timestamp of last programmed timerfd wakeup */
+static int64_t  mht_timerfd_wakeup_tick = NO_TICK;
+
+/** Source id for timerfd wakeup input watch
+ *
+ * The watch is attached to an epoll set holding the timerfd. With
+ * alarm timers the timerfd is added with EPOLLWAKEUP, so that kernel
+ * keeps the device from suspending again between alarm triggering
+ * and mce getting to obtain a wakelock. */
+static guint    mht_timerfd_wakeup_watch_id = 0;
+
+static gboolean mht_timerfd_wakeup_cb      (GIOChannel *chn, GIOCondition cnd, gpointer data);
+static void     mht_timerfd_set_wakeup     (int64_t trigger);
+static bool     mht_timerfd_is_open        (void);
+static void     mht_timerfd_open           (void);
+static void     mht_timerfd_close          (void);
+
 /* ------------------------------------------------------------------------- *
  * IPHB_WAKEUPS
  * ------------------------------------------------------------------------- */
@@ -271,9 +358,15 @@ mce_hbtimer_create(const char  *name,
     self->hbt_name      = name ? strdup(name) : 0;
     self->hbt_notify    = notify;
     self->hbt_period    = period;
+    self->hbt_slack     = 0;
+    self->hbt_lazy      = false;
+    self->hbt_deadline  = NO_TICK;
     self->hbt_user_data = user_data;
     self->hbt_trigger   = NO_TICK;
     self->hbt_in_notify = false;
+    self->hbt_heap_index = -1;
+    self->hbt_due       = false;
+    self->hbt_due_next  = 0;
 
     mht_queue_add_timer(self);
 
@@ -347,6 +440,65 @@ mce_hbtimer_set_period(mce_hbtimer_t *self, int period)
         self->hbt_period = period;
 }
 
+/** Set how late heartbeat timer is allowed to trigger
+ *
+ * Timers with slack can be notified together with other timers
+ * that trigger within the slack window, which reduces the number
+ * of separate wakeups needed.
+ *
+ * @param self  heartbeat timer object, or NULL
+ * @param slack allowed delay [ms]
+ */
+void
+mce_hbtimer_set_slack(mce_hbtimer_t *self, int slack)
+{
+    if( !self )
+        goto EXIT;
+
+    if( slack < 0 )
+        slack = 0;
+
+    if( self->hbt_slack == slack )
+        goto EXIT;
+
+    self->hbt_slack = slack;
+
+    if( self->hbt_heap_index >= 0 )
+        mht_queue_schedule_wakeups();
+
+EXIT:
+    return;
+}
+
+/** Set heartbeat timer deadline extension mode
+ *
+ * When lazy mode is enabled, restarting an active timer so that it
+ * triggers later than currently scheduled only updates the deadline
+ * time stamp. The timer is re-armed when it triggers early, which
+ * avoids rescheduling wakeups for frequently restarted timers.
+ *
+ * @param self heartbeat timer object, or NULL
+ * @param lazy true to enable deadline extension mode
+ */
+void
+mce_hbtimer_set_lazy(mce_hbtimer_t *self, bool lazy)
+{
+    if( !self )
+        goto EXIT;
+
+    self->hbt_lazy = lazy;
+
+    /* Apply pending deadline extension */
+    if( !lazy && self->hbt_deadline != NO_TICK ) {
+        int64_t trigger = self->hbt_deadline;
+        self->hbt_deadline = NO_TICK;
+        mce_hbtimer_set_trigger(self, trigger);
+    }
+
+EXIT:
+    return;
+}
+
 /** Call heatbeat timer notification functiom
  *
  * @param self   heartbeat timer object, or NULL
@@ -365,6 +517,8 @@ mce_hbtimer_notify(mce_hbtimer_t *self)
 
     self->hbt_in_notify = true;
     self->hbt_trigger   = NO_TICK;
+    self->hbt_deadline  = NO_TICK;
+    mht_queue_update_timer(self);
 
     bool again = self->hbt_notify(self->hbt_user_data);
 
@@ -397,6 +551,7 @@ mce_hbtimer_set_trigger(mce_hbtimer_t *self, int64_t trigger)
         goto EXIT;
 
     self->hbt_trigger = trigger;
+    mht_queue_update_timer(self);
     mht_queue_schedule_wakeups();
 
 EXIT:
@@ -417,6 +572,16 @@ mce_hbtimer_start(mce_hbtimer_t *self)
             self->hbt_period);
     int64_t now = mht_get_monotick();
     int64_t trigger = now + self->hbt_period;
+
+    /* Lazy timers that are queued to trigger earlier just
+     * get the deadline extended and re-armed on trigger */
+    if( self->hbt_lazy && self->hbt_heap_index >= 0 &&
+        trigger >= self->hbt_trigger ) {
+        self->hbt_deadline = trigger;
+        goto EXIT;
+    }
+
+    self->hbt_deadline = NO_TICK;
     mce_hbtimer_set_trigger(self, trigger);
 
 EXIT:
@@ -434,6 +599,7 @@ mce_hbtimer_stop(mce_hbtimer_t *self)
         goto EXIT;
 
     mce_log(LL_DEBUG, "stop %s", mce_hbtimer_get_name(self));
+    self->hbt_deadline = NO_TICK;
     mce_hbtimer_set_trigger(self, NO_TICK);
     mht_queue_schedule_wakeups();
 
@@ -445,31 +611,208 @@ EXIT:
  * QUEUE_MANAGEMENT
  * ========================================================================= */
 
-/** Clean up unused timer list slots
+/** Store heartbeat timer at given heap position
  *
- * When timers are deleted, the associated node in mht_queue_timer_list
- * is left in place with data pointer set to zero.
+ * @param self heartbeat timer object
+ * @param pos  heap index
+ */
+static void
+mht_queue_heap_place(mce_hbtimer_t *self, size_t pos)
+{
+    mht_queue_heap[pos] = self;
+    self->hbt_heap_index = (ssize_t)pos;
+}
+
+/** Move heap entry towards root until heap order is restored
  *
- * This function can be used to remove such stale entries in suitable
- * point outside the dispatch iteration loop.
+ * @param pos heap index
  */
 static void
-mht_queue_garbage_collect(void)
+mht_queue_heap_sift_up(size_t pos)
 {
-    GSList **tail = &mht_queue_timer_list;
+    mce_hbtimer_t *self = mht_queue_heap[pos];
 
-    GSList *item;
+    while( pos > 0 ) {
+        size_t parent = (pos - 1) / 2;
 
-    while( (item = *tail) ) {
-        if( item->data ) {
-            tail = &item->next;
-        }
-        else {
-            *tail = item->next;
-            item->next = 0;
-            g_slist_free(item);
+        if( mht_queue_heap[parent]->hbt_trigger <= self->hbt_trigger )
+            break;
+
+        mht_queue_heap_place(mht_queue_heap[parent], pos);
+        pos = parent;
+    }
+
+    mht_queue_heap_place(self, pos);
+}
+
+/** Move heap entry towards leaves until heap order is restored
+ *
+ * @param pos heap index
+ */
+static void
+mht_queue_heap_sift_down(size_t pos)
+{
+    mce_hbtimer_t *self = mht_queue_heap[pos];
+
+    for( ;; ) {
+        size_t child = pos * 2 + 1;
+
+        if( child >= mht_queue_heap_len )
+            break;
+
+        if( child + 1 < mht_queue_heap_len &&
+            mht_queue_heap[child + 1]->hbt_trigger <
+            mht_queue_heap[child]->hbt_trigger )
+            ++child;
+
+        if( self->hbt_trigger <= mht_queue_heap[child]->hbt_trigger )
+            break;
+
+        mht_queue_heap_place(mht_queue_heap[child], pos);
+        pos = child;
+    }
+
+    mht_queue_heap_place(self, pos);
+}
+
+/** Add heartbeat timer to heap of active timers
+ *
+ * @param self heartbeat timer object that is not in the heap
+ */
+static void
+mht_queue_heap_insert(mce_hbtimer_t *self)
+{
+    if( mht_queue_heap_len == mht_queue_heap_size ) {
+        mht_queue_heap_size = mht_queue_heap_size ? mht_queue_heap_size * 2 : 16;
+        mht_queue_heap = g_renew(mce_hbtimer_t *, mht_queue_heap,
+                                 mht_queue_heap_size);
+    }
+
+    mht_queue_heap_place(self, mht_queue_heap_len++);
+    mht_queue_heap_sift_up(self->hbt_heap_index);
+}
+
+/** Remove heartbeat timer from heap of active timers
+ *
+ * @param self heartbeat timer object that is in the heap
+ */
+static void
+mht_queue_heap_remove(mce_hbtimer_t *self)
+{
+    size_t pos = (size_t)self->hbt_heap_index;
+
+    self->hbt_heap_index = -1;
+
+    if( pos == --mht_queue_heap_len )
+        goto EXIT;
+
+    /* Fill the hole with the last entry and restore heap order */
+    mht_queue_heap_place(mht_queue_heap[mht_queue_heap_len], pos);
+
+    if( pos > 0 &&
+        mht_queue_heap[pos]->hbt_trigger <
+        mht_queue_heap[(pos - 1) / 2]->hbt_trigger )
+        mht_queue_heap_sift_up(pos);
+    else
+        mht_queue_heap_sift_down(pos);
+
+EXIT:
+    mht_queue_heap[mht_queue_heap_len] = 0;
+}
+
+/** Sync heap position of heartbeat timer with its trigger time
+ *
+ * Active timers are kept in the heap, inactive ones are removed.
+ *
+ * Timers that are waiting to be notified during dispatching are
+ * not added back to the heap unless they are rescheduled.
+ *
+ * @param self heartbeat timer object
+ */
+static void
+mht_queue_update_timer(mce_hbtimer_t *self)
+{
+    if( !mht_queue_has_timer(self) )
+        goto EXIT;
+
+    if( self->hbt_trigger == NO_TICK ) {
+        if( self->hbt_heap_index >= 0 )
+            mht_queue_heap_remove(self);
+    }
+    else if( self->hbt_heap_index < 0 ) {
+        if( !self->hbt_due )
+            mht_queue_heap_insert(self);
+    }
+    else {
+        size_t pos = (size_t)self->hbt_heap_index;
+
+        if( pos > 0 &&
+            self->hbt_trigger < mht_queue_heap[(pos - 1) / 2]->hbt_trigger )
+            mht_queue_heap_sift_up(pos);
+        else
+            mht_queue_heap_sift_down(pos);
+    }
+
+EXIT:
+    return;
+}
+
+/** Find the latest wakeup time that satisfies all heartbeat timers
+ *
+ * Only subtrees with timers triggering before the current deadline
+ * need to be visited, so the cost depends on the number of timers
+ * that can be coalesced rather than on the number of active timers.
+ *
+ * @param pos      heap index to start from
+ * @param deadline deadline found so far
+ *
+ * @return deadline for wakeup
+ */
+static int64_t
+mht_queue_heap_deadline(size_t pos, int64_t deadline)
+{
+    if( pos >= mht_queue_heap_len )
+        goto EXIT;
+
+    const mce_hbtimer_t *timer = mht_queue_heap[pos];
+
+    /* This and all child timers get triggered by the wakeup */
+    if( timer->hbt_trigger >= deadline )
+        goto EXIT;
+
+    if( deadline > timer->hbt_trigger + timer->hbt_slack )
+        deadline = timer->hbt_trigger + timer->hbt_slack;
+
+    deadline = mht_queue_heap_deadline(pos * 2 + 1, deadline);
+    deadline = mht_queue_heap_deadline(pos * 2 + 2, deadline);
+
+EXIT:
+    return deadline;
+}
+
+/** Remove heartbeat timer from list of triggered timers
+ *
+ * @param self heartbeat timer object
+ */
+static void
+mht_queue_unlink_due(mce_hbtimer_t *self)
+{
+    if( !self->hbt_due )
+        goto EXIT;
+
+    for( mce_hbtimer_t **tail = &mht_queue_due_list; *tail;
+         tail = &(*tail)->hbt_due_next ) {
+        if( *tail == self ) {
+            *tail = self->hbt_due_next;
+            break;
         }
     }
+
+    self->hbt_due      = false;
+    self->hbt_due_next = 0;
+
+EXIT:
+    return;
 }
 
 /** Predicate for: heartbeat timer is registered
@@ -483,10 +826,10 @@ mht_queue_has_timer(const mce_hbtimer_t *self)
 {
     bool has_timer = false;
 
-    if( !self )
+    if( !self || !mht_queue_timer_set )
         goto EXIT;
 
-    has_timer = g_slist_find(mht_queue_timer_list, self) != 0;
+    has_timer = g_hash_table_lookup(mht_queue_timer_set, self) != 0;
 
 EXIT:
     return has_timer;
@@ -502,13 +845,13 @@ mht_queue_add_timer(mce_hbtimer_t *self)
     if( !self )
         goto EXIT;
 
-    /* Try to find recyclable vacated timer slot */
-    GSList *item = g_slist_find(mht_queue_timer_list, 0);
+    if( !mht_queue_timer_set )
+        mht_queue_timer_set = g_hash_table_new(g_direct_hash,
+                                               g_direct_equal);
 
-    if( item )
-        item->data = self;
-    else
-        mht_queue_timer_list = g_slist_prepend(mht_queue_timer_list, self);
+    g_hash_table_add(mht_queue_timer_set, self);
+
+    mht_queue_update_timer(self);
 
 EXIT:
     return;
@@ -521,20 +864,30 @@ EXIT:
 static void
 mht_queue_remove_timer(mce_hbtimer_t *self)
 {
-    if( !self )
+    if( !mht_queue_has_timer(self) )
         goto EXIT;
 
-    GSList *item = g_slist_find(mht_queue_timer_list, self);
+    if( self->hbt_heap_index >= 0 )
+        mht_queue_heap_remove(self);
+
+    mht_queue_unlink_due(self);
+
+    g_hash_table_remove(mht_queue_timer_set, self);
 
-    /* Vacate the slot by clearing the data link */
-    if( item )
-        item->data = 0;
+    if( g_hash_table_size(mht_queue_timer_set) == 0 ) {
+        g_hash_table_unref(mht_queue_timer_set),
+            mht_queue_timer_set = 0;
+
+        g_free(mht_queue_heap),
+            mht_queue_heap = 0,
+            mht_queue_heap_size = 0;
+    }
 
 EXIT:
     return;
 }
 
-/** Scan registered heartbeat timers and schdule nearest wakeup
+/** Schedule wakeup for dispatching heartbeat timers
  */
 static void
 mht_queue_schedule_wakeups(void)
@@ -542,34 +895,37 @@ mht_queue_schedule_wakeups(void)
     if( !mce_hbtimer_initialized )
         goto EXIT;
 
-    int64_t trigger = NO_TICK;
-    bool    compact = false;
-
-    for( GSList *item = mht_queue_timer_list; item; item = item->next ) {
-        mce_hbtimer_t *timer = item->data;
-
-        if( !timer )
-            compact = true;
-        else if( trigger > timer->hbt_trigger )
-            trigger = timer->hbt_trigger;
-    }
-
-    if( compact )
-        mht_queue_garbage_collect();
+    /* Delay the wakeup as much as timer slacks allow, so that
+     * timers triggering close to each other get dispatched
+     * together */
+    int64_t trigger = mht_queue_heap_deadline(0, NO_TICK);
 
     int64_t now = mht_get_monotick();
 
     if( trigger < now )
         trigger = now;
 
-    mht_glib_set_wakeup(trigger, now);
-    mht_iphb_set_wakeup(trigger, now);
+    /* Timerfd wakeups use CLOCK_BOOTTIME base and thus make
+     * glib timeouts redundant. Iphb is needed only when the
+     * timerfd can't wake up the device from suspend. */
+    if( mht_timerfd_is_open() ) {
+        mht_timerfd_set_wakeup(trigger);
+        mht_glib_set_wakeup(NO_TICK, now);
+    }
+    else {
+        mht_glib_set_wakeup(trigger, now);
+    }
+
+    if( mht_timerfd_wakes_up )
+        mht_iphb_set_wakeup(NO_TICK, now);
+    else
+        mht_iphb_set_wakeup(trigger, now);
 
 EXIT:
     return;
 }
 
-/** Scan registered heartbeat timers and notify triggered ones
+/** Notify heartbeat timers that have triggered
  */
 void
 mht_queue_dispatch_timers(void)
@@ -593,23 +949,50 @@ mht_queue_dispatch_timers(void)
 
     int64_t now = mht_get_monotick();
 
-    for( GSList *item = mht_queue_timer_list; item; item = item->next ) {
-        mce_hbtimer_t *timer = item->data;
+    /* Move triggered timers from heap to due list, so that timers
+     * that get restarted from notify callbacks are not notified
+     * again during this dispatch round */
+    mce_hbtimer_t **tail = &mht_queue_due_list;
 
-        if( !timer )
-            continue;
+    while( mht_queue_heap_len > 0 &&
+           mht_queue_heap[0]->hbt_trigger <= now ) {
+        mce_hbtimer_t *timer = mht_queue_heap[0];
 
-        if( timer->hbt_trigger == NO_TICK )
-            continue;
+        mht_queue_heap_remove(timer);
 
-        mce_log(LL_DEBUG, "%s T%+"PRId64" ms",
-                mce_hbtimer_get_name(timer),
-                now - timer->hbt_trigger);
+        timer->hbt_due      = true;
+        timer->hbt_due_next = 0;
+        *tail = timer, tail = &timer->hbt_due_next;
+    }
+
+    mce_hbtimer_t *timer;
+
+    while( (timer = mht_queue_due_list) ) {
+        mht_queue_due_list  = timer->hbt_due_next;
+        timer->hbt_due      = false;
+        timer->hbt_due_next = 0;
+
+        /* Skip timers that were stopped or restarted
+         * from notify callbacks of other timers */
+        if( timer->hbt_trigger == NO_TICK || timer->hbt_trigger > now ) {
+            /* Not triggered */
+        }
+        else if( timer->hbt_deadline != NO_TICK &&
+                 timer->hbt_deadline > now ) {
+            /* Lazily extended deadline not reached yet - re-arm */
+            timer->hbt_trigger  = timer->hbt_deadline;
+            timer->hbt_deadline = NO_TICK;
+        }
+        else {
+            mce_log(LL_DEBUG, "%s T%+"PRId64" ms",
+                    mce_hbtimer_get_name(timer),
+                    now - timer->hbt_trigger);
 
-        if( now < timer->hbt_trigger )
-            continue;
+            mce_hbtimer_notify(timer);
+        }
 
-        mce_hbtimer_notify(timer);
+        /* Requeue if still active */
+        mht_queue_update_timer(timer);
     }
 
     /* Check the next timer to trigger */
@@ -687,6 +1070,257 @@ mht_glib_set_wakeup(int64_t trigger, int64_t now)
     }
 }
 
+/* ========================================================================= *
+ * TIMERFD_WAKEUPS
+ * ========================================================================= */
+
+/** Timerfd wakeup callback for dispatching heartbeat timers
+ *
+ * Called when the epoll set holding the timerfd becomes readable.
+ *
+ * @param chn  io channel
+ * @param cnd  io condition
+ * @param data (unused)
+ *
+ * @return TRUE to keep io watch alive, or FALSE to disable it
+ */
+static gboolean
+mht_timerfd_wakeup_cb(GIOChannel *chn, GIOCondition cnd, gpointer data)
+{
+    (void)data;
+
+    gboolean keep_going = FALSE;
+
+#ifdef ENABLE_WAKELOCKS
+    /* Take over from the kernel side wakeup source before
+     * releasing it, so that suspend stays blocked until
+     * triggered timers have been dispatched */
+    wakelock_lock("mce_hbtimer_wakeup", -1);
+#endif
+
+    if( !mht_timerfd_wakeup_watch_id )
+        goto cleanup_nak;
+
+    int fd = g_io_channel_unix_get_fd(chn);
+
+    if( fd < 0 )
+        goto cleanup_nak;
+
+    if( cnd & ~G_IO_IN )
+        goto cleanup_nak;
+
+    if( !(cnd & G_IO_IN) )
+        goto cleanup_ack;
+
+    uint64_t count = 0;
+
+    int rc = read(mht_timerfd_fd, &count, sizeof count);
+
+    /* Polling the epoll set after the timerfd has been read
+     * releases the kernel side wakeup source */
+    struct epoll_event ev;
+    epoll_wait(fd, &ev, 1, 0);
+
+    if( rc == -1 ) {
+        if( errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK )
+            goto cleanup_ack;
+
+        mce_log(LL_ERR, "timerfd read error: %m");
+        goto cleanup_nak;
+    }
+
+    /* clear programmed state */
+    mht_timerfd_wakeup_tick = NO_TICK;
+
+    /* notify */
+    mce_log(LL_DEBUG, "timerfd wakeup; dispatch hbtimers");
+    mht_queue_dispatch_timers();
+
+cleanup_ack:
+    keep_going = TRUE;
+
+cleanup_nak:
+
+    if( !keep_going ) {
+        mht_timerfd_wakeup_watch_id = 0;
+        mht_timerfd_close();
+
+        /* Fall back to glib / iphb wakeups */
+        mht_queue_schedule_wakeups();
+    }
+
+#ifdef ENABLE_WAKELOCKS
+    wakelock_unlock("mce_hbtimer_wakeup");
+#endif
+
+    return keep_going;
+}
+
+/** Reprogram timerfd for dispatching heartbeat timers
+ *
+ * @param trigger when to trigger, or NO_TICK to disarm
+ */
+static void
+mht_timerfd_set_wakeup(int64_t trigger)
+{
+    if( !mht_timerfd_is_open() )
+        goto EXIT;
+
+    if( mht_timerfd_wakeup_tick == trigger )
+        goto EXIT;
+
+    /* Zero it_value disarms the timer */
+    struct itimerspec its;
+    memset(&its, 0, sizeof its);
+
+    if( trigger != NO_TICK ) {
+        its.it_value.tv_sec  = (time_t)(trigger / 1000);
+        its.it_value.tv_nsec = (long)(trigger % 1000) * 1000000;
+    }
+
+    if( timerfd_settime(mht_timerfd_fd, TFD_TIMER_ABSTIME, &its, 0) == -1 ) {
+        mce_log(LL_ERR, "timerfd_settime: %m");
+        mht_timerfd_wakeup_tick = NO_TICK;
+        goto EXIT;
+    }
+
+    mht_timerfd_wakeup_tick = trigger;
+
+    if( trigger == NO_TICK )
+        mce_log(LL_DEBUG, "timerfd wakeup disarmed");
+    else
+        mce_log(LL_DEBUG, "timerfd wakeup at %"PRId64" ms", trigger);
+
+EXIT:
+    return;
+}
+
+/** Predicate for: timerfd wakeups are in use
+ *
+ * @return true if timerfd is open, false otherwise
+ */
+static bool
+mht_timerfd_is_open(void)
+{
+    return mht_timerfd_fd != -1;
+}
+
+/** Create timerfd for dispatching heartbeat timers
+ *
+ * The clock to use is read from configuration:
+ * - "alarm"    CLOCK_BOOTTIME_ALARM, falls back to CLOCK_BOOTTIME
+ *              if the process is not allowed to set alarm timers
+ * - "boottime" CLOCK_BOOTTIME, does not wake up from suspend and
+ *              is mainly useful for testing
+ * - "none"     use only glib timeouts and iphb wakeups
+ */
+static void
+mht_timerfd_open(void)
+{
+    gchar *clk = 0;
+    int    fd  = -1;
+    int    epfd = -1;
+
+    if( mht_timerfd_is_open() )
+        goto EXIT;
+
+    clk = mce_conf_get_string(MCE_CONF_HBTIMER_GROUP,
+                              MCE_CONF_HBTIMER_TIMERFD_CLOCK,
+                              DEFAULT_HBTIMER_TIMERFD_CLOCK);
+
+    if( !clk || !strcmp(clk, "none") )
+        goto EXIT;
+
+    bool wakes_up = false;
+
+    if( !strcmp(clk, "alarm") ) {
+        fd = timerfd_create(CLOCK_BOOTTIME_ALARM, TFD_NONBLOCK | TFD_CLOEXEC);
+        if( fd != -1 )
+            wakes_up = true;
+        else
+            mce_log(LL_WARN, "timerfd_create(CLOCK_BOOTTIME_ALARM): %m");
+    }
+    else if( strcmp(clk, "boottime") ) {
+        mce_log(LL_WARN, "unknown timerfd clock '%s'", clk);
+    }
+
+    if( fd == -1 ) {
+        fd = timerfd_create(CLOCK_BOOTTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+        if( fd == -1 ) {
+            mce_log(LL_WARN, "timerfd_create(CLOCK_BOOTTIME): %m");
+            goto EXIT;
+        }
+    }
+
+    if( (epfd = epoll_create1(EPOLL_CLOEXEC)) == -1 ) {
+        mce_log(LL_WARN, "epoll_create1: %m");
+        goto EXIT;
+    }
+
+    /* Alarm wakeups must block suspend until handled */
+    struct epoll_event ev = {
+        .events  = EPOLLIN | (wakes_up ? EPOLLWAKEUP : 0),
+        .data.fd = fd,
+    };
+
+    if( epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == -1 ) {
+        mce_log(LL_WARN, "epoll_ctl: %m");
+        goto EXIT;
+    }
+
+    /* The io watch owns the epoll set from now on */
+    mht_timerfd_wakeup_watch_id =
+        mht_add_iowatch(epfd, true, G_IO_IN, mht_timerfd_wakeup_cb, 0);
+
+    if( !mht_timerfd_wakeup_watch_id )
+        goto EXIT;
+
+    mht_timerfd_fd          = fd;
+    mht_timerfd_wakes_up    = wakes_up;
+    mht_timerfd_wakeup_tick = NO_TICK;
+    fd = epfd = -1;
+
+    mce_log(LL_DEBUG, "timerfd wakeups using %s",
+            wakes_up ? "CLOCK_BOOTTIME_ALARM" : "CLOCK_BOOTTIME");
+
+    /* Iphb is not needed if timerfd can wake up from suspend */
+    if( mht_timerfd_wakes_up )
+        mht_connection_close();
+
+EXIT:
+    if( epfd != -1 )
+        close(epfd);
+
+    if( fd != -1 )
+        close(fd);
+
+    g_free(clk);
+}
+
+/** Stop using timerfd for dispatching heartbeat timers
+ */
+static void
+mht_timerfd_close(void)
+{
+    /* Removing the io watch closes the epoll set */
+    if( mht_timerfd_wakeup_watch_id ) {
+        g_source_remove(mht_timerfd_wakeup_watch_id),
+            mht_timerfd_wakeup_watch_id = 0;
+    }
+
+    if( mht_timerfd_is_open() ) {
+        mce_log(LL_DEBUG, "timerfd closed");
+        close(mht_timerfd_fd), mht_timerfd_fd = -1;
+    }
+
+    mht_timerfd_wakes_up    = false;
+    mht_timerfd_wakeup_tick = NO_TICK;
+
+    /* Reconnect to iphb if it is still needed */
+    if( mce_hbtimer_initialized && dsme_available == SERVICE_STATE_RUNNING )
+        mht_connection_open();
+}
+
 /* ========================================================================= *
  * IPHB_WAKEUPS
  * ========================================================================= */
@@ -935,7 +1569,10 @@ mht_connection_is_pending(void)
 static void
 mht_connection_open(void)
 {
-    if( mht_connection_is_pending() ) {
+    if( mht_timerfd_wakes_up ) {
+        // Timerfd handles wakeups from suspend
+    }
+    else if( mht_connection_is_pending() ) {
         // Retry timer already set up
     }
     else if( !mht_connection_try_to_open() ) {
@@ -1075,6 +1712,9 @@ static void mht_datapipe_quit(void)
 void
 mce_hbtimer_init(void)
 {
+    /* Select timerfd wakeups if available */
+    mht_timerfd_open();
+
     /* Connect to datapipes */
     mht_datapipe_init();
 
@@ -1101,4 +1741,7 @@ mce_hbtimer_quit(void)
 
     /* close iphb connection */
     mht_connection_close();
+
+    /* close timerfd */
+    mht_timerfd_close();
 }
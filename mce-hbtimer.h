@@ -42,6 +42,8 @@ void            mce_hbtimer_delete      (mce_hbtimer_t *self);
 bool            mce_hbtimer_is_active   (const mce_hbtimer_t *self);
 const char     *mce_hbtimer_get_name    (const mce_hbtimer_t *self);
 void            mce_hbtimer_set_period  (mce_hbtimer_t *self, int period);
+void            mce_hbtimer_set_slack   (mce_hbtimer_t *self, int slack);
+void            mce_hbtimer_set_lazy    (mce_hbtimer_t *self, bool lazy);
 
 void            mce_hbtimer_start       (mce_hbtimer_t *self);
 void            mce_hbtimer_stop        (mce_hbtimer_t *self);
@@ -36,6 +36,8 @@
 #include <errno.h>
 #include <fcntl.h>
 
+#include <sys/stat.h>
+
 #include <glib/gstdio.h>
 
 /* ========================================================================= *
@@ -61,6 +63,8 @@ struct mce_io_mon_t {
 	gchar          *path;		/**< Monitored file */
 	iomon_type      type;		/**< Monitor type */
 	gulong          chunk_size;	/**< Read-chunk size */
+	gchar          *chunk_buf;	/**< Persistent read buffer */
+	gsize           chunk_buf_size;	/**< Size of chunk_buf */
 
 	gboolean        seekable;	/**< is the I/O channel seekable */
 	gboolean        suspended;	/**< Is the I/O monitor suspended? */
@@ -85,6 +89,9 @@ struct mce_io_mon_t {
 /** List of all file monitors */
 static GSList *file_monitors = NULL;
 
+/** I/O monitor whose input is being passed to notify callback */
+static mce_io_mon_t *mce_io_mon_current = NULL;
+
 /* ========================================================================= *
  * PROTOTYPES
  * ========================================================================= */
@@ -124,6 +131,7 @@ void                 mce_io_mon_resume                  (mce_io_mon_t *iomon);
 
 const gchar         *mce_io_mon_get_path                (const mce_io_mon_t *iomon);
 int                  mce_io_mon_get_fd                  (const mce_io_mon_t *iomon);
+mce_io_mon_t        *mce_io_mon_get_current             (void);
 
 // MISC_UTILS
 
@@ -335,6 +343,8 @@ static mce_io_mon_t *mce_io_mon_create(const char *path, mce_io_mon_delete_cb de
 	self->path          = g_strdup(path);
 	self->type          = IOMON_UNSET;
 	self->chunk_size    = 0;
+	self->chunk_buf     = 0;
+	self->chunk_buf_size = 0;
 
 	self->seekable      = FALSE;
 	self->suspended     = TRUE;
@@ -421,6 +431,9 @@ static void mce_io_mon_delete(mce_io_mon_t *self)
 		self->iochan = 0;
 	}
 
+	/* Release read buffer */
+	g_free(self->chunk_buf), self->chunk_buf = 0;
+
 	/* Forget file path */
 	g_free(self->path), self->path = 0;
 
@@ -478,13 +491,12 @@ static gboolean mce_io_mon_read_chunks(GIOChannel *source,
 	gboolean      status      = FALSE;
 
 	mce_io_mon_t  *iomon      = data;
-	gchar        *buffer      = NULL;
-	gsize         bytes_want  = 4096;
 	gsize         bytes_have  = 0;
 	gsize         chunks_have = 0;
 	gsize         chunks_done = 0;
 	GError       *error       = NULL;
 	GIOStatus     io_status   = G_IO_STATUS_NORMAL;
+	ssize_t       rc          = 0;
 
 #ifdef ENABLE_WAKELOCKS
 	/* Since the locks on kernel side are released once all
@@ -514,31 +526,31 @@ static gboolean mce_io_mon_read_chunks(GIOChannel *source,
 		}
 	}
 
-	/* Adjust read size to multiples of small sized chunks,
-	 * or size of one larger chunk */
-	if( iomon->chunk_size < bytes_want )
-		bytes_want -= bytes_want % iomon->chunk_size;
-	else
-		bytes_want = iomon->chunk_size;
-
-	/* Allocate read buffer */
-	buffer = g_malloc(bytes_want);
+	/* The channel is unbuffered, so reading directly from the
+	 * file descriptor into the persistent buffer is equivalent
+	 * to g_io_channel_read_chars() minus the heap traffic */
+	rc = TEMP_FAILURE_RETRY(read(g_io_channel_unix_get_fd(source),
+				     iomon->chunk_buf,
+				     iomon->chunk_buf_size));
 
-	io_status = g_io_channel_read_chars(source, buffer,
-					    bytes_want, &bytes_have, &error);
+	if( rc == -1 ) {
+		/* Nothing available after all, ignore */
+		if( errno == EAGAIN || errno == EWOULDBLOCK ) {
+			io_status = G_IO_STATUS_AGAIN;
+			status = TRUE;
+			goto EXIT;
+		}
 
-	/* If the read was interrupted, ignore */
-	if( io_status == G_IO_STATUS_AGAIN ) {
-		status = TRUE;
+		mce_log(LL_ERR, "Error when reading from %s: %m",
+			iomon->path);
+		io_status = G_IO_STATUS_ERROR;
 		goto EXIT;
 	}
 
-	if( error ) {
-		mce_log(LL_ERR, "Error when reading from %s: %s",
-			iomon->path, error->message);
-		g_clear_error(&error);
-		goto EXIT;
-	}
+	if( rc == 0 )
+		io_status = G_IO_STATUS_EOF;
+
+	bytes_have = (gsize)rc;
 
 	if( bytes_have % iomon->chunk_size ) {
 		mce_log(LL_WARN, "Incomplete chunks read from: %s",
@@ -551,11 +563,15 @@ static gboolean mce_io_mon_read_chunks(GIOChannel *source,
 		mce_log(LL_ERR, "Empty read from %s", iomon->path);
 	}
 	else {
-		gchar *chunk = buffer;
+		gchar *chunk = iomon->chunk_buf;
 		for( ; chunks_done < chunks_have ; chunk += iomon->chunk_size ) {
 			++chunks_done;
 
-			if( !iomon->nofity_cb(chunk, iomon->chunk_size) ) {
+			mce_io_mon_current = iomon;
+			gboolean flush = iomon->nofity_cb(chunk, iomon->chunk_size);
+			mce_io_mon_current = 0;
+
+			if( !flush ) {
 				continue;
 			}
 
@@ -585,7 +601,6 @@ static gboolean mce_io_mon_read_chunks(GIOChannel *source,
 
 EXIT:
 	g_clear_error(&error);
-	g_free(buffer);
 
 #ifdef ENABLE_WAKELOCKS
 	/* Release the lock after we're done with processing it */
@@ -1054,9 +1069,22 @@ mce_io_mon_t *mce_io_mon_register_chunk(const gint fd,
 	g_io_channel_set_flags(iomon->iochan, G_IO_FLAG_NONBLOCK, &error);
 	g_clear_error(&error);
 
-	/* Set the I/O monitor type and call resume to add an I/O watch */
+	/* Set the I/O monitor type */
 	iomon->type       = IOMON_CHUNK;
 	iomon->chunk_size = chunk_size;
+
+	/* Allocate read buffer that is used for the lifetime of
+	 * the monitor: multiples of small sized chunks, or size of
+	 * one larger chunk. Heap memory is suitably aligned for
+	 * any chunk type, e.g. an array of struct input_event. */
+	iomon->chunk_buf_size = 4096;
+	if( chunk_size < iomon->chunk_buf_size )
+		iomon->chunk_buf_size -= iomon->chunk_buf_size % chunk_size;
+	else
+		iomon->chunk_buf_size = chunk_size;
+	iomon->chunk_buf = g_malloc(iomon->chunk_buf_size);
+
+	/* Call resume to add an I/O watch */
 	mce_io_mon_resume(iomon);
 
 EXIT:
@@ -1139,6 +1167,19 @@ void *mce_io_mon_get_user_data(const mce_io_mon_t *iomon)
 	return iomon ? iomon->user_data : 0;
 }
 
+/** Get I/O monitor whose input is currently being processed
+ *
+ * Chunk notify callbacks do not get the I/O monitor as a parameter;
+ * this can be used from within the callback to access per monitor
+ * state, e.g. the user data block.
+ *
+ * @return I/O monitor, or NULL when called outside notify callback
+ */
+mce_io_mon_t *mce_io_mon_get_current(void)
+{
+	return mce_io_mon_current;
+}
+
 /* ========================================================================= *
  * MISC_UTILS
  * ========================================================================= */
@@ -1510,12 +1551,47 @@ EXIT:
 
 void mce_close_output(output_state_t *output)
 {
-	if( output && output->file ) {
-		if( fclose(output->file) == EOF ) {
+	if( output && output->fd > 0 ) {
+		if( close(output->fd) == -1 ) {
 			mce_log(LL_WARN,"%s: can't close %s: %m", output->context, output->path);
 		}
-		output->file = 0;
+		output->fd = 0;
 	}
+
+	/* Value can change while the file is not held open */
+	if( output )
+		output->cached_valid = FALSE;
+}
+
+/** Open output file descriptor
+ *
+ * Zero is used for denoting closed output, so descriptors in the
+ * stdio range are moved out of the way.
+ *
+ * @param output control structure for writing to a file
+ *
+ * @return file descriptor, or -1 on failure
+ */
+static int mce_open_output(output_state_t *output)
+{
+	int flags = O_WRONLY | O_CLOEXEC;
+
+	if( !output->truncate_file )
+		flags |= O_APPEND;
+
+	int fd = open(output->path, flags);
+
+	if( fd != -1 && fd <= STDERR_FILENO ) {
+		int tmp = fcntl(fd, F_DUPFD_CLOEXEC, STDERR_FILENO + 1);
+		close(fd), fd = tmp;
+	}
+
+	struct stat st;
+
+	output->regular_file = (fd != -1 && fstat(fd, &st) == 0 &&
+				S_ISREG(st.st_mode));
+
+	return fd;
 }
 
 /**
@@ -1525,6 +1601,11 @@ void mce_close_output(output_state_t *output)
  * It should thus not be used in cases where atomicity is expected.
  * For atomic replace, use mce_write_number_string_to_file_atomic()
  *
+ * The number is written with a single pwrite() call. If the file
+ * is kept open and the value equals the last successfully written
+ * one, no system calls are made at all - unless output->uncached
+ * is set.
+ *
  * @param output control structure for writing to a file
  * @param number The number to write
  *
@@ -1553,43 +1634,57 @@ gboolean mce_write_number_string_to_file(output_state_t *output, const gulong nu
 		goto EXIT;
 	}
 
-	if( !output->file ) {
-		output->file = fopen(output->path, output->truncate_file ? "w" : "a");
-		if( !output->file ) {
+	if( output->cached_valid && output->cached_value == number &&
+	    output->fd > 0 && output->truncate_file ) {
+		status = TRUE;
+		goto EXIT;
+	}
+
+	output->cached_valid = FALSE;
+
+	if( output->fd <= 0 ) {
+		output->fd = mce_open_output(output);
+		if( output->fd == -1 ) {
+			output->fd = 0;
 			mce_log(LL_ERR,"%s: can't open %s: %m", output->context, output->path);
 			goto EXIT;
 		}
 	}
-	else if( output->truncate_file )
-	{
-		rewind(output->file);
-		if( ftruncate(fileno(output->file), 0) == -1 ) {
-			mce_log(LL_WARN,"%s: can't truncate %s: %m", output->context, output->path);
-		}
-	}
 
-	// from now on assume success
-	status = TRUE;
+	char    data[32];
+	int     size = snprintf(data, sizeof data, "%lu", number);
+	ssize_t rc;
 
-	if( fprintf(output->file, "%lu", number) < 0 ) {
-		mce_log(LL_WARN,"%s: can't write %s: %m", output->context, output->path);
-		status = FALSE;
+	/* Sysfs attributes are rewritten from offset zero; files opened
+	 * in append mode ignore the offset */
+	rc = TEMP_FAILURE_RETRY(pwrite(output->fd, data, (size_t)size, 0));
+
+	if( rc != size ) {
+		if( rc == -1 )
+			mce_log(LL_WARN,"%s: can't write %s: %m", output->context, output->path);
+		else
+			mce_log(LL_WARN,"%s: short write to %s", output->context, output->path);
+		goto EXIT;
 	}
 
-	if( fflush(output->file) == EOF ) {
-		mce_log(LL_WARN,"%s: can't flush %s: %m", output->context, output->path);
-		status = FALSE;
+	if( output->truncate_file && output->regular_file &&
+	    ftruncate(output->fd, size) == -1 ) {
+		mce_log(LL_WARN,"%s: can't truncate %s: %m", output->context, output->path);
 	}
 
-EXIT:
+	status = TRUE;
 
-	if( output->close_on_exit && output->file ) {
-		if( fclose(output->file) == EOF ) {
-			mce_log(LL_WARN,"%s: can't close %s: %m", output->context, output->path);
-		}
-		output->file = 0;
+	if( output->truncate_file && !output->close_on_exit &&
+	    !output->uncached ) {
+		output->cached_valid = TRUE;
+		output->cached_value = number;
 	}
 
+EXIT:
+
+	if( output->close_on_exit )
+		mce_close_output(output);
+
 	return status;
 }
 
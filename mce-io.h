@@ -55,6 +55,11 @@ typedef struct {
 	 *  FALSE to leave the file open */
 	gboolean close_on_exit;
 
+	/** TRUE to write every value, for files whose content can be
+	 *  changed by other means, e.g. led engines or triggers;
+	 *  FALSE to skip rewriting the last written value */
+	gboolean uncached;
+
 	/* runtime configuration */
 
 	/** Path to the file, or NULL (in which case one misconfiguration
@@ -63,8 +68,20 @@ typedef struct {
 
 	/* dynamic state */
 
-	/** Cached output stream, use mce_close_output() to close */
-	FILE *file;
+	/** Cached file descriptor, or 0 if not open;
+	 *  use mce_close_output() to close */
+	int fd;
+
+	/** TRUE if the open file is a regular file that needs to be
+	 *  truncated after rewrites, FALSE for sysfs attributes etc */
+	gboolean regular_file;
+
+	/** TRUE if cached_value holds the last successfully written
+	 *  value of a file that has been kept open */
+	gboolean cached_valid;
+
+	/** Last successfully written value */
+	gulong cached_value;
 
 	/** TRUE if missing path configuration error has already been
 	 *  written for this file */
@@ -119,6 +136,8 @@ void mce_io_mon_set_user_data(mce_io_mon_t *iomon,
 
 void *mce_io_mon_get_user_data(const mce_io_mon_t *iomon);
 
+mce_io_mon_t *mce_io_mon_get_current(void);
+
 /* output_state_t funtions */
 
 void mce_close_output(output_state_t *output);
@@ -358,3 +358,45 @@ gboolean strmemcmp(guint8 *mem, const gchar *str, gulong len)
 EXIT:
 	return result;
 }
+
+/**
+ * Add a sample to histogram statistics
+ *
+ * @param self  The histogram to update
+ * @param value The sample to add
+ */
+void mce_hist_add(mce_hist_t *self, guint64 value)
+{
+	guint buckets = MIN(self->buckets, MCE_HIST_BUCKETS_MAX);
+	guint bucket = 0;
+
+	if (buckets == 0)
+		goto EXIT;
+
+	while (bucket < buckets - 1 && value >= self->limits[bucket])
+		bucket++;
+
+	self->count++;
+	self->total += value;
+	if (self->max < value)
+		self->max = value;
+	self->histogram[bucket]++;
+
+EXIT:
+	return;
+}
+
+/**
+ * Clear histogram statistics
+ *
+ * The name and bucket limits are retained.
+ *
+ * @param self The histogram to clear
+ */
+void mce_hist_reset(mce_hist_t *self)
+{
+	self->count = 0;
+	self->total = 0;
+	self->max = 0;
+	memset(self->histogram, 0, sizeof self->histogram);
+}
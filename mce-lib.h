@@ -55,4 +55,37 @@ gchar *strstr_delim(const gchar *const haystack, const char *needle,
 		    const char *const delimiter);
 gboolean strmemcmp(guint8 *mem, const gchar *str, gulong len);
 
+/** Maximum number of buckets in a mce_hist_t histogram */
+#define MCE_HIST_BUCKETS_MAX 10
+
+/** Sample statistics with a histogram
+ *
+ * The unit of samples and bucket limits is up to the user.
+ */
+typedef struct {
+	const char *name;		/**< Name used in reports */
+	const guint64 *limits;		/**< Upper limits of all but
+					 *   the last bucket
+					 */
+	guint buckets;			/**< Number of buckets in use */
+	guint64 count;			/**< Number of samples */
+	guint64 total;			/**< Sum of samples */
+	guint64 max;			/**< Largest sample */
+	guint64 histogram[MCE_HIST_BUCKETS_MAX]; /**< Samples per bucket */
+} mce_hist_t;
+
+/** Initializer for mce_hist_t
+ *
+ * @param NAME_   name used in reports
+ * @param LIMITS_ array of bucket upper limits, in ascending order
+ */
+#define MCE_HIST_INIT(NAME_, LIMITS_) {\
+	.name = (NAME_),\
+	.limits = (LIMITS_),\
+	.buckets = G_N_ELEMENTS(LIMITS_) + 1,\
+}
+
+void mce_hist_add(mce_hist_t *self, guint64 value);
+void mce_hist_reset(mce_hist_t *self);
+
 #endif /* _MCE_LIB_H_ */
@@ -25,13 +25,20 @@
 
 #include <sys/time.h>
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
 #include <fnmatch.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <semaphore.h>
 
 #include <glib/gprintf.h>
 
+#include <errno.h>
+
 static unsigned int logverbosity = LL_WARN;	/**< Log verbosity */
 static int logtype = MCE_LOG_STDERR;		/**< Output for log messages */
 static char *logname = NULL;
@@ -52,11 +59,22 @@ static void monotime(struct timeval *tv)
 	clock_gettime(CLOCK_BOOTTIME, &ts);
 	TIMESPEC_TO_TIMEVAL(tv, &ts);
 }
+
+/** Mutex for serializing stderr output and log burst tracking
+ *
+ * Messages get written out both from the asynchronous logging writer
+ * thread and synchronously from other threads.
+ */
+static pthread_mutex_t mce_log_emit_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/** Convert monotonic time stamp to time since start of log burst
+ *
+ * Note: Must be called while holding mce_log_emit_mutex.
+ */
 static void timestamp(struct timeval *tv)
 {
 	static struct timeval start, prev;
 	struct timeval diff;
-	monotime(tv);
 	if( !timerisset(&start) )
 		prev = start = *tv;
 	timersub(tv, &prev, &diff);
@@ -157,6 +175,720 @@ EXIT:
 	return str;
 }
 
+/** Write formatted log message to stderr or syslog
+ *
+ * @param loglevel level for the message
+ * @param tv       monotonic time stamp for the message
+ * @param msg      message text
+ */
+static void mce_log_emit(loglevel_t loglevel, struct timeval *tv,
+			 const char *msg)
+{
+	if (logtype == MCE_LOG_STDERR) {
+		pthread_mutex_lock(&mce_log_emit_mutex);
+		timestamp(tv);
+		fprintf(stderr, "%s: T+%ld.%03ld %s: %s\n",
+			mce_log_name(),
+			(long)tv->tv_sec, (long)(tv->tv_usec/1000),
+			mce_log_level_tag(loglevel),
+			msg);
+		pthread_mutex_unlock(&mce_log_emit_mutex);
+	} else {
+		/* LL_EXTRA = devel flavor notice */
+		if( loglevel == LL_EXTRA )
+			loglevel = LL_NOTICE;
+
+		/* loglevels are subset of syslog priorities, so
+		 * we can use loglevel as is for syslog priority */
+		syslog(loglevel, "%s", msg);
+	}
+}
+
+/** Number of slots in asynchronous logging ring buffer, power of two */
+#define MCE_LOG_RING_SIZE 512
+
+/** Maximum length of message text in ring buffer slot */
+#define MCE_LOG_RING_TEXT 512
+
+/** Message slot in asynchronous logging ring buffer */
+typedef struct
+{
+	/** Level of the message */
+	loglevel_t     level;
+
+	/** Monotonic time stamp taken when the message was logged */
+	struct timeval tv;
+
+	/** Formatted message text, truncated if needed */
+	char           text[MCE_LOG_RING_TEXT];
+} mce_log_slot_t;
+
+/** Ring buffer slots; written by logging thread only */
+static mce_log_slot_t mce_log_ring[MCE_LOG_RING_SIZE];
+
+/** Count of messages added to the ring; updated by logging thread */
+static unsigned mce_log_ring_head = 0;
+
+/** Count of messages written out; updated by writer thread */
+static unsigned mce_log_ring_tail = 0;
+
+/** Count of messages dropped due to full ring buffer */
+static unsigned mce_log_ring_dropped = 0;
+
+/** Flag for: writer thread should exit after draining the ring */
+static bool mce_log_ring_exit = false;
+
+/** Flag for: asynchronous logging is in use */
+static bool mce_log_ring_active = false;
+
+/** Thread that is allowed to append to the ring buffer */
+static pthread_t mce_log_ring_owner;
+
+/** Writer thread draining the ring buffer */
+static pthread_t mce_log_ring_writer;
+
+/** Semaphore for waking up the writer thread */
+static sem_t mce_log_ring_sem;
+
+/** Mutex for waiting the writer thread to drain the ring */
+static pthread_mutex_t mce_log_ring_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/** Condition signaled by the writer thread after draining the ring */
+static pthread_cond_t mce_log_ring_drained = PTHREAD_COND_INITIALIZER;
+
+/** Write out messages that have been added to the ring buffer
+ *
+ * @param aptr (unused)
+ *
+ * @return NULL
+ */
+static void *mce_log_ring_writer_cb(void *aptr)
+{
+	(void)aptr;
+
+	unsigned reported = 0;
+
+	for( ;; ) {
+		unsigned head = __atomic_load_n(&mce_log_ring_head,
+						__ATOMIC_ACQUIRE);
+		unsigned tail = mce_log_ring_tail;
+
+		while( tail != head ) {
+			mce_log_slot_t *slot =
+				&mce_log_ring[tail % MCE_LOG_RING_SIZE];
+
+			mce_log_emit(slot->level, &slot->tv, slot->text);
+
+			__atomic_store_n(&mce_log_ring_tail, ++tail,
+					 __ATOMIC_RELEASE);
+		}
+
+		unsigned dropped = __atomic_load_n(&mce_log_ring_dropped,
+						   __ATOMIC_RELAXED);
+		if( reported != dropped ) {
+			char text[64];
+			struct timeval tv;
+			monotime(&tv);
+			snprintf(text, sizeof text,
+				 "%u log messages dropped", dropped - reported);
+			mce_log_emit(LL_WARN, &tv, text);
+			reported = dropped;
+		}
+
+		/* Wake up mce_log_flush() waiters */
+		pthread_mutex_lock(&mce_log_ring_mutex);
+		pthread_cond_broadcast(&mce_log_ring_drained);
+		pthread_mutex_unlock(&mce_log_ring_mutex);
+
+		if( __atomic_load_n(&mce_log_ring_exit, __ATOMIC_ACQUIRE) &&
+		    __atomic_load_n(&mce_log_ring_head,
+				    __ATOMIC_ACQUIRE) == tail )
+			break;
+
+		while( sem_wait(&mce_log_ring_sem) == -1 && errno == EINTR ) {
+			/* retry */
+		}
+	}
+
+	return 0;
+}
+
+/** Try to add message to the ring buffer
+ *
+ * @param loglevel level for the message
+ * @param file     source file name, or NULL
+ * @param function function name, or NULL
+ * @param fmt      printf style format string
+ * @param va       arguments for the format string
+ *
+ * @return true if message was added or dropped, false if it
+ *         needs to be written out synchronously
+ */
+static bool mce_log_ring_append(loglevel_t loglevel, const char *file,
+				const char *function, const char *fmt,
+				va_list va)
+{
+	if( !mce_log_ring_active )
+		return false;
+
+	/* Only the thread that enabled async logging is allowed
+	 * to append, others use synchronous logging */
+	if( !pthread_equal(pthread_self(), mce_log_ring_owner) )
+		return false;
+
+	/* Errors are often followed by exit() or abort() that would
+	 * kill the writer thread; write them out synchronously, after
+	 * the preceding messages */
+	if( loglevel == LL_CRIT || loglevel == LL_ERR ) {
+		mce_log_flush();
+		return false;
+	}
+
+	unsigned head = mce_log_ring_head;
+	unsigned tail = __atomic_load_n(&mce_log_ring_tail,
+					__ATOMIC_ACQUIRE);
+
+	if( head - tail >= MCE_LOG_RING_SIZE ) {
+		__atomic_add_fetch(&mce_log_ring_dropped, 1,
+				   __ATOMIC_RELAXED);
+		return true;
+	}
+
+	mce_log_slot_t *slot = &mce_log_ring[head % MCE_LOG_RING_SIZE];
+	size_t          used = 0;
+
+	slot->level = loglevel;
+	monotime(&slot->tv);
+
+	if( file && function ) {
+		int rc = snprintf(slot->text, sizeof slot->text,
+				  "%s: %s(): ", file, function);
+		if( rc > 0 )
+			used = ((size_t)rc < sizeof slot->text) ?
+				(size_t)rc : sizeof slot->text - 1;
+	}
+
+	vsnprintf(slot->text + used, sizeof slot->text - used, fmt, va);
+
+	if( file && function )
+		mce_log_strip_string(slot->text + used);
+
+	__atomic_store_n(&mce_log_ring_head, head + 1, __ATOMIC_RELEASE);
+	sem_post(&mce_log_ring_sem);
+
+	return true;
+}
+
+/** Wait until messages added to the ring buffer have been written out
+ *
+ * Also registered as atexit() handler, so that messages logged
+ * just before exit() do not get lost.
+ */
+void mce_log_flush(void)
+{
+	if( !mce_log_ring_active )
+		goto EXIT;
+
+	unsigned head = __atomic_load_n(&mce_log_ring_head,
+					__ATOMIC_ACQUIRE);
+
+	pthread_mutex_lock(&mce_log_ring_mutex);
+	sem_post(&mce_log_ring_sem);
+	while( __atomic_load_n(&mce_log_ring_tail, __ATOMIC_ACQUIRE) != head )
+		pthread_cond_wait(&mce_log_ring_drained, &mce_log_ring_mutex);
+	pthread_mutex_unlock(&mce_log_ring_mutex);
+
+EXIT:
+	return;
+}
+
+/** Enable or disable asynchronous logging
+ *
+ * When enabled, messages logged from the calling thread are
+ * formatted into a ring buffer and written out by a separate
+ * writer thread. If the ring buffer gets full, messages are
+ * dropped and the number of dropped messages is logged later on.
+ *
+ * Must not be enabled before daemonizing as the writer thread
+ * does not survive fork().
+ *
+ * @param enable true to enable, false to flush and disable
+ */
+void mce_log_set_async(bool enable)
+{
+	static bool flush_at_exit = false;
+
+	if( mce_log_ring_active == enable )
+		goto EXIT;
+
+	if( enable ) {
+		if( !flush_at_exit )
+			flush_at_exit = (atexit(mce_log_flush) == 0);
+
+		if( sem_init(&mce_log_ring_sem, 0, 0) == -1 )
+			goto EXIT;
+
+		mce_log_ring_exit  = false;
+		mce_log_ring_owner = pthread_self();
+
+		if( pthread_create(&mce_log_ring_writer, 0,
+				   mce_log_ring_writer_cb, 0) != 0 ) {
+			sem_destroy(&mce_log_ring_sem);
+			goto EXIT;
+		}
+		mce_log_ring_active = true;
+	}
+	else {
+		mce_log_ring_active = false;
+
+		__atomic_store_n(&mce_log_ring_exit, true, __ATOMIC_RELEASE);
+		sem_post(&mce_log_ring_sem);
+		pthread_join(mce_log_ring_writer, 0);
+		sem_destroy(&mce_log_ring_sem);
+	}
+
+EXIT:
+	return;
+}
+
+/** Number of entries in flight recorder, power of two */
+#define MCE_LOG_FR_SIZE 1024
+
+/** Maximum number of arguments stored per flight recorder entry */
+#define MCE_LOG_FR_ARGS 8
+
+/** Space for string arguments stored per flight recorder entry */
+#define MCE_LOG_FR_TEXT 64
+
+/** Path to flight recorder dump file */
+#define MCE_LOG_FR_PATH G_STRINGIFY(MCE_VAR_DIR)"/flight-recorder.log"
+
+/** Raw argument stored in flight recorder entry */
+typedef union
+{
+	long long  i;
+	double     d;
+	const void *p;
+} mce_log_frarg_t;
+
+/** Unformatted log event stored in flight recorder */
+typedef struct
+{
+	/** Call site: source file, or NULL for raw logging */
+	const char      *file;
+
+	/** Call site: function name, or NULL for raw logging */
+	const char      *function;
+
+	/** Call site: format string, or NULL for unused entry */
+	const char      *fmt;
+
+	/** Monotonic time stamp */
+	struct timeval   tv;
+
+	/** Level of the message */
+	loglevel_t       level;
+
+	/** Value of errno at time of logging, for %m */
+	int              err;
+
+	/** Number of stored arguments */
+	unsigned         nargs;
+
+	/** Flag for: arguments were not evaluated */
+	bool             noargs;
+
+	/** Arguments in order of appearance in format string */
+	mce_log_frarg_t  args[MCE_LOG_FR_ARGS];
+
+	/** Copies of string arguments, referred to by offset */
+	char             text[MCE_LOG_FR_TEXT];
+} mce_log_frec_t;
+
+/** Flight recorder entries */
+static mce_log_frec_t mce_log_fr[MCE_LOG_FR_SIZE];
+
+/** Count of events added to the flight recorder */
+static unsigned mce_log_fr_head = 0;
+
+/** Parsed printf conversion specification */
+typedef struct
+{
+	/** Conversion character, or 0 for unsupported spec */
+	char   conv;
+
+	/** Length modifier: 0, 'h', 'H' (hh), 'l', 'q' (ll), 'j', 'z', 't', 'L' */
+	char   len;
+
+	/** Width is given as argument */
+	bool   star_width;
+
+	/** Precision is given as argument */
+	bool   star_prec;
+
+	/** Length of the specification in format string */
+	size_t size;
+} mce_log_spec_t;
+
+/** Parse printf conversion specification
+ *
+ * @param fmt  format string position after '%' character
+ * @param spec where to store parsed specification
+ */
+static void mce_log_parse_spec(const char *fmt, mce_log_spec_t *spec)
+{
+	const char *pos = fmt;
+
+	memset(spec, 0, sizeof *spec);
+
+	while( *pos && strchr("-+ #0'", *pos) ) ++pos;
+
+	if( *pos == '*' )
+		spec->star_width = true, ++pos;
+	else
+		while( *pos >= '0' && *pos <= '9' ) ++pos;
+
+	if( *pos == '.' ) {
+		++pos;
+		if( *pos == '*' )
+			spec->star_prec = true, ++pos;
+		else
+			while( *pos >= '0' && *pos <= '9' ) ++pos;
+	}
+
+	switch( *pos ) {
+	case 'h':
+		spec->len = (pos[1] == 'h') ? (++pos, 'H') : 'h', ++pos;
+		break;
+	case 'l':
+		spec->len = (pos[1] == 'l') ? (++pos, 'q') : 'l', ++pos;
+		break;
+	case 'q': case 'j': case 'z': case 't': case 'L':
+		spec->len = *pos++;
+		break;
+	default:
+		break;
+	}
+
+	if( *pos && strchr("diouxXcsSpmneEfFgGaA%", *pos) )
+		spec->conv = *pos++;
+
+	spec->size = (size_t)(pos - fmt);
+}
+
+/** Fetch integer argument according to length modifier
+ *
+ * @param len length modifier from mce_log_parse_spec()
+ * @param va  argument list
+ * @param uns true for unsigned conversions
+ *
+ * @return argument value
+ */
+static long long mce_log_fetch_int(char len, va_list *va, bool uns)
+{
+	switch( len ) {
+	case 'l':
+		return uns ? (long long)va_arg(*va, unsigned long)
+			   : (long long)va_arg(*va, long);
+	case 'q':
+		return va_arg(*va, long long);
+	case 'j':
+		return (long long)va_arg(*va, intmax_t);
+	case 'z':
+		return (long long)va_arg(*va, size_t);
+	case 't':
+		return (long long)va_arg(*va, ptrdiff_t);
+	default:
+		break;
+	}
+	return uns ? (long long)va_arg(*va, unsigned) : va_arg(*va, int);
+}
+
+/** Claim flight recorder entry and fill in the call site details
+ *
+ * @param loglevel level for the message
+ * @param file     source file name, or NULL
+ * @param function function name, or NULL
+ * @param fmt      printf style format string
+ *
+ * @return flight recorder entry without arguments
+ */
+static mce_log_frec_t *mce_log_record_claim(loglevel_t loglevel,
+					    const char *file,
+					    const char *function,
+					    const char *fmt)
+{
+	int      err  = errno;
+	unsigned slot = __atomic_fetch_add(&mce_log_fr_head, 1,
+					   __ATOMIC_RELAXED);
+
+	mce_log_frec_t *rec = &mce_log_fr[slot % MCE_LOG_FR_SIZE];
+
+	rec->file     = file;
+	rec->function = function;
+	rec->fmt      = fmt;
+	rec->level    = loglevel;
+	rec->err      = err;
+	rec->nargs    = 0;
+	rec->noargs   = false;
+	monotime(&rec->tv);
+
+	return rec;
+}
+
+/** Store unformatted log event in flight recorder
+ *
+ * Only the call site pointers, time stamp and raw argument values
+ * are stored; formatting is done only if the recorder gets dumped.
+ *
+ * @param loglevel level for the message
+ * @param file     source file name, or NULL
+ * @param function function name, or NULL
+ * @param fmt      printf style format string
+ * @param va       arguments for the format string
+ */
+static void mce_log_record_va(loglevel_t loglevel, const char *file,
+			      const char *function, const char *fmt,
+			      va_list va)
+{
+	mce_log_frec_t *rec  = mce_log_record_claim(loglevel, file,
+						    function, fmt);
+	size_t          used = 0;
+	va_list         ap;
+
+	va_copy(ap, va);
+
+	for( const char *pos = fmt; (pos = strchr(pos, '%')); ) {
+		mce_log_spec_t spec;
+
+		mce_log_parse_spec(++pos, &spec);
+		pos += spec.size;
+
+		/* Unknown conversion: stop before arguments get misaligned */
+		if( !spec.conv )
+			break;
+
+		if( spec.conv == '%' || spec.conv == 'm' )
+			continue;
+
+		if( rec->nargs + spec.star_width + spec.star_prec >=
+		    MCE_LOG_FR_ARGS )
+			break;
+
+		if( spec.star_width )
+			rec->args[rec->nargs++].i = va_arg(ap, int);
+		if( spec.star_prec )
+			rec->args[rec->nargs++].i = va_arg(ap, int);
+
+		mce_log_frarg_t *arg = &rec->args[rec->nargs++];
+
+		switch( spec.conv ) {
+		case 'd': case 'i': case 'c':
+			arg->i = mce_log_fetch_int(spec.len, &ap, false);
+			break;
+		case 'o': case 'u': case 'x': case 'X':
+			arg->i = mce_log_fetch_int(spec.len, &ap, true);
+			break;
+		case 'e': case 'E': case 'f': case 'F':
+		case 'g': case 'G': case 'a': case 'A':
+			if( spec.len == 'L' )
+				arg->d = (double)va_arg(ap, long double);
+			else
+				arg->d = va_arg(ap, double);
+			break;
+		case 's': {
+			const char *str = va_arg(ap, const char *);
+			arg->i = -1;
+			if( str && used < sizeof rec->text ) {
+				arg->i = (long long)used;
+				size_t n = strlen(str);
+				if( n > sizeof rec->text - used - 1 )
+					n = sizeof rec->text - used - 1;
+				memcpy(rec->text + used, str, n);
+				rec->text[used + n] = 0;
+				used += n + 1;
+			}
+			break;
+		}
+		default:
+			/* 'p', 'n' and wide strings: keep the pointer only */
+			arg->p = va_arg(ap, const void *);
+			break;
+		}
+	}
+
+	va_end(ap);
+}
+
+/**
+ * Store unformatted log event in flight recorder
+ *
+ * Used for recording events whose arguments are known to be
+ * cheap to evaluate and free of side effects.
+ *
+ * @param loglevel The level of severity for this message
+ * @param fmt The format string for this message
+ * @param ... Input to the format string
+ */
+void mce_log_record(loglevel_t loglevel, const char *const file,
+		    const char *const function, const char *const fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	mce_log_record_va(loglevel, file, function, fmt, args);
+	va_end(args);
+}
+
+/**
+ * Store call site of a filtered out log message in flight recorder
+ *
+ * Used for messages that are not logged due to verbosity settings.
+ * Arguments are not passed in so that they do not get evaluated.
+ *
+ * @param loglevel The level of severity for this message
+ * @param file     source file name
+ * @param function function name
+ * @param fmt      The format string for this message
+ */
+void mce_log_record_site(loglevel_t loglevel, const char *const file,
+			 const char *const function, const char *const fmt)
+{
+	mce_log_frec_t *rec = mce_log_record_claim(loglevel, file,
+						   function, fmt);
+	rec->noargs = true;
+}
+
+/** Write single flight recorder entry in human readable form
+ *
+ * @param file output stream
+ * @param rec  flight recorder entry
+ */
+static void mce_log_dump_entry(FILE *file, const mce_log_frec_t *rec)
+{
+	unsigned nargs = 0;
+
+	fprintf(file, "T+%ld.%03ld %s: ",
+		(long)rec->tv.tv_sec, (long)(rec->tv.tv_usec / 1000),
+		mce_log_level_tag(rec->level));
+
+	if( rec->file && rec->function )
+		fprintf(file, "%s: %s(): ", rec->file, rec->function);
+
+	if( rec->noargs ) {
+		fprintf(file, "%s [args not recorded]\n", rec->fmt);
+		return;
+	}
+
+	for( const char *pos = rec->fmt; *pos; ) {
+		const char *end = strchr(pos, '%');
+
+		if( !end ) {
+			fputs(pos, file);
+			break;
+		}
+
+		fwrite(pos, 1, (size_t)(end - pos), file);
+
+		mce_log_spec_t spec;
+		mce_log_parse_spec(end + 1, &spec);
+		pos = end + 1 + spec.size;
+
+		if( !spec.conv ) {
+			fputs(end, file);
+			break;
+		}
+
+		if( spec.conv == '%' ) {
+			fputc('%', file);
+			continue;
+		}
+
+		if( spec.conv == 'm' ) {
+			fputs(strerror(rec->err), file);
+			continue;
+		}
+
+		if( nargs + spec.star_width + spec.star_prec >= rec->nargs ) {
+			fputs("<...>", file);
+			break;
+		}
+
+		/* Field width, precision and flags are not reproduced */
+		nargs += spec.star_width + spec.star_prec;
+		const mce_log_frarg_t *arg = &rec->args[nargs++];
+
+		switch( spec.conv ) {
+		case 'd': case 'i':
+			fprintf(file, "%lld", arg->i);
+			break;
+		case 'u':
+			fprintf(file, "%llu", (unsigned long long)arg->i);
+			break;
+		case 'o':
+			fprintf(file, "%llo", (unsigned long long)arg->i);
+			break;
+		case 'x': case 'X':
+			fprintf(file, "%llx", (unsigned long long)arg->i);
+			break;
+		case 'c':
+			fputc((int)arg->i, file);
+			break;
+		case 'e': case 'E': case 'f': case 'F':
+		case 'g': case 'G': case 'a': case 'A':
+			fprintf(file, "%g", arg->d);
+			break;
+		case 's':
+			fputs((arg->i < 0) ? "(null)" : rec->text + arg->i, file);
+			break;
+		default:
+			fprintf(file, "%p", arg->p);
+			break;
+		}
+	}
+
+	fputc('\n', file);
+}
+
+/** Write flight recorder contents to a file
+ *
+ * @param path file to write, or NULL to use the default path
+ *
+ * @return path to the file written, or NULL on failure
+ */
+const char *mce_log_dump_recorder(const char *path)
+{
+	const char *res  = 0;
+	FILE       *file = 0;
+
+	if( !path )
+		path = MCE_LOG_FR_PATH;
+
+	if( !(file = fopen(path, "w")) )
+		goto EXIT;
+
+	unsigned head = __atomic_load_n(&mce_log_fr_head, __ATOMIC_RELAXED);
+	unsigned tail = head - MCE_LOG_FR_SIZE;
+
+	if( head < MCE_LOG_FR_SIZE )
+		tail = 0;
+
+	fprintf(file, "%s: flight recorder, %u events\n",
+		mce_log_name(), head - tail);
+
+	for( ; tail != head; ++tail ) {
+		const mce_log_frec_t *rec = &mce_log_fr[tail % MCE_LOG_FR_SIZE];
+		if( rec->fmt )
+			mce_log_dump_entry(file, rec);
+	}
+
+	if( fclose(file) == 0 )
+		res = path;
+
+EXIT:
+	return res;
+}
+
 /**
  * Log debug message with optional filename and function name attached
  *
@@ -171,8 +903,21 @@ void mce_log_file(loglevel_t loglevel, const char *const file,
 
 	loglevel = mce_log_level_normalize(loglevel);
 
+	va_start(args, fmt);
+	mce_log_record_va(loglevel, file, function, fmt, args);
+	va_end(args);
+
 	if( mce_log_p_(loglevel, file, function) ) {
 		gchar *msg = 0;
+		bool   done;
+
+		va_start(args, fmt);
+		done = mce_log_ring_append(loglevel, file, function,
+					   fmt, args);
+		va_end(args);
+
+		if( done )
+			goto EXIT;
 
 		va_start(args, fmt);
 		g_vasprintf(&msg, fmt, args);
@@ -184,26 +929,15 @@ void mce_log_file(loglevel_t loglevel, const char *const file,
 			g_free(msg), msg = tmp;
 		}
 
-		if (logtype == MCE_LOG_STDERR) {
-			struct timeval tv;
-			timestamp(&tv);
-			fprintf(stderr, "%s: T+%ld.%03ld %s: %s\n",
-				mce_log_name(),
-				(long)tv.tv_sec, (long)(tv.tv_usec/1000),
-				mce_log_level_tag(loglevel),
-				msg);
-		} else {
-			/* LL_EXTRA = devel flavor notice */
-			if( loglevel == LL_EXTRA )
-				loglevel = LL_NOTICE;
-
-			/* loglevels are subset of syslog priorities, so
-			 * we can use loglevel as is for syslog priority */
-			syslog(loglevel, "%s", msg);
-		}
+		struct timeval tv;
+		monotime(&tv);
+		mce_log_emit(loglevel, &tv, msg);
 
 		g_free(msg);
 	}
+
+EXIT:
+	return;
 }
 
 /**
@@ -238,6 +972,9 @@ void mce_log_open(const char *const name, const int facility, const int type)
  */
 void mce_log_close(void)
 {
+	/* Write out messages still in the ring buffer */
+	mce_log_set_async(false);
+
 	/* Logging (to stderr) after this will use default identity */
 	g_free(logname), logname = 0;
 
@@ -249,6 +986,10 @@ void mce_log_close(void)
 static GSList     *mce_log_patterns = 0;
 static GHashTable *mce_log_functions = 0;
 
+/** Mutex for mce_log_functions cache; logging is done also from
+ *  helper threads, e.g. the display brightness fader */
+static pthread_mutex_t mce_log_functions_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 void mce_log_add_pattern(const char *pat)
 {
 	// NB these are never released by desing
@@ -268,8 +1009,10 @@ static bool mce_log_check_pattern(const char *func)
 	if( !mce_log_functions )
 		goto EXIT;
 
+	pthread_mutex_lock(&mce_log_functions_mutex);
+
 	if( (hit = g_hash_table_lookup(mce_log_functions, func)) )
-		goto EXIT;
+		goto UNLOCK;
 
 	hit = GINT_TO_POINTER(1);
 
@@ -282,6 +1025,9 @@ static bool mce_log_check_pattern(const char *func)
 	}
 	g_hash_table_replace(mce_log_functions, strdup(func), hit);
 
+UNLOCK:
+	pthread_mutex_unlock(&mce_log_functions_mutex);
+
 EXIT:
 	return GPOINTER_TO_INT(hit) > 1;
 }
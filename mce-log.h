@@ -22,6 +22,7 @@
 # define MCE_LOG_H_
 
 # include <syslog.h>
+# include <stdbool.h>
 
 # define MCE_LOG_SYSLOG		1	/**< Log to syslog */
 # define MCE_LOG_STDERR		0	/**< Log to stderr */
@@ -60,6 +61,22 @@ void mce_log_file(loglevel_t loglevel, const char *const file,
 
 void mce_log_open(const char *const name, const int facility, const int type);
 void mce_log_close(void);
+void mce_log_set_async(bool enable);
+void mce_log_flush(void);
+
+void mce_log_record(loglevel_t loglevel, const char *const file,
+		    const char *const function, const char *const fmt, ...)
+		    __attribute__((format(printf, 4, 5)));
+void mce_log_record_site(loglevel_t loglevel, const char *const file,
+			 const char *const function, const char *const fmt);
+const char *mce_log_dump_recorder(const char *path);
+
+/** Least severe level that is stored in flight recorder when not logged
+ *
+ * Arguments of filtered out messages are never evaluated, only the
+ * call site and format string get recorded.
+ */
+#  define MCE_LOG_RECORD_LEVEL LL_DEBUG
 
 #  define mce_log_p(LEV_)\
 	mce_log_p_(LEV_,__FILE__,__FUNCTION__)
@@ -72,6 +89,9 @@ void mce_log_close(void);
 		if( mce_log_p(LEV_) )\
 			mce_log_file(LEV_, __FILE__, __FUNCTION__,\
 				     FMT_ , ## ARGS_);\
+		else if( (LEV_) <= MCE_LOG_RECORD_LEVEL )\
+			mce_log_record_site(LEV_, __FILE__, __FUNCTION__,\
+					    FMT_);\
 	} while(0)
 
 # else
@@ -80,6 +100,11 @@ void mce_log_close(void);
 #  define mce_log_set_verbosity(LEV_)           do {} while (0)
 #  define mce_log_open(NAME_, FACILITY_, TYPE_) do {} while (0)
 #  define mce_log_close()                       do {} while (0)
+#  define mce_log_set_async(ENABLE_)            do {} while (0)
+#  define mce_log_flush()                       do {} while (0)
+#  define mce_log_record(LEV_, FILE_, FN_, FMT_, ...) do {} while (0)
+#  define mce_log_record_site(LEV_, FILE_, FN_, FMT_) do {} while (0)
+#  define mce_log_dump_recorder(PATH_)          NULL
 #  define mce_log_p(LEV_)                       0
 #  define mce_log(LEV_, FMT_, ...)              do {} while (0)
 #  define mce_log_raw(LEV_, FMT_, ARGS_...)     do {} while (0)
@@ -116,6 +116,7 @@ static void mce_cleanup_wakelocks(void)
 	wakelock_unlock("mce_lpm_off");
 	wakelock_unlock("mce_tklock_notify");
 	wakelock_unlock("mce_hbtimer_dispatch");
+	wakelock_unlock("mce_hbtimer_wakeup");
 	wakelock_unlock("mce_inactivity_notify");
 }
 #endif // ENABLE_WAKELOCKS
@@ -152,9 +153,18 @@ static void mce_exit_via_signal(int signr)
 }
 
 /** Suspend safe replacement for _exit(1), abort() etc
+ *
+ * Note: Not async-signal-safe due to flight recorder dumping,
+ *       signal handlers must use mce_exit_via_signal() instead.
  */
 void mce_abort(void)
 {
+	/* Write out messages still in asynchronous logging queue */
+	mce_log_flush();
+
+	/* Save recent events for post-mortem analysis */
+	mce_log_dump_recorder(0);
+
 	mce_exit_via_signal(SIGABRT);
 }
 
@@ -169,6 +179,9 @@ static void signal_handler(const gint signr)
 {
 	switch (signr) {
 	case SIGUSR1:
+		/* save what happened before debug logging got enabled */
+		mce_log_dump_recorder(0);
+
 		/* switch to debug verbosity */
 		mce_log_set_verbosity(LL_DEBUG);
 		mce_log(LL_DEBUG, "switching to DEBUG verbosity level");
@@ -320,7 +333,7 @@ static void mce_tx_signal_cb(int sig)
 		no_error_check_write(STDERR_FILENO, msg, sizeof msg - 1);
 
 		if( !mainloop || ++exit_tries >= 2 ) {
-			mce_abort();
+			mce_exit_via_signal(SIGABRT);
 		}
 		break;
 
@@ -349,7 +362,7 @@ static void mce_tx_signal_cb(int sig)
 	int did = TEMP_FAILURE_RETRY(write(signal_pipe[1], &sig, sizeof sig));
 
 	if( did != (int)sizeof sig ) {
-		mce_abort();
+		mce_exit_via_signal(SIGABRT);
 	}
 }
 
@@ -927,6 +940,11 @@ int main(int argc, char **argv)
 	if( mce_args.daemonflag )
 		daemonize();
 
+	/* Move writing of log messages off the main thread; the writer
+	 * thread does not survive fork() and must be started only after
+	 * daemonizing */
+	mce_log_set_async(true);
+
 	/* Register a mainloop */
 	mainloop = g_main_loop_new(NULL, FALSE);
 
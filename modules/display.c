@@ -42,6 +42,8 @@
 #endif
 
 #include <sys/ptrace.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
 
 #include <stdlib.h>
 #include <unistd.h>
@@ -49,6 +51,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <glob.h>
+#include <poll.h>
 #include <pthread.h>
 
 #include <mce/dbus-names.h>
@@ -93,6 +96,12 @@
 /** Maximum duration for compositor based ui dimming animation */
 #define MCE_FADER_DURATION_UI_MAX 5000
 
+/** How long speculatively resumed frame buffer waits for unblanking [ms]
+ *
+ * Needs to cover power key press + double press detection delay.
+ */
+#define MDY_PRERESUME_TIMEOUT 2000
+
 /* ========================================================================= *
  * TYPEDEFS
  * ========================================================================= */
@@ -229,8 +238,41 @@ typedef enum
     STM_ENTER_LOGICAL_OFF,
     STM_STAY_LOGICAL_OFF,
     STM_LEAVE_LOGICAL_OFF,
+    STM_INIT_PRERESUME,
+    STM_WAIT_PRERESUME,
+    STM_STAY_PRERESUMED,
+    STM_INIT_UNDO_PRERESUME,
+    STM_WAIT_UNDO_PRERESUME,
 } stm_state_t;
 
+/** Phases of display state transitions that are timed separately */
+typedef enum
+{
+    /** Whole transition from leaving one display state to entering next */
+    STM_PHASE_TOTAL,
+
+    /** Waiting for compositor to enable updates */
+    STM_PHASE_UI_START,
+
+    /** Waiting for compositor to disable updates */
+    STM_PHASE_UI_STOP,
+
+    /** Waiting for frame buffer to suspend */
+    STM_PHASE_FB_SUSPEND,
+
+    /** Waiting for frame buffer to resume */
+    STM_PHASE_FB_RESUME,
+
+    /** Waiting for backlight to reach target brightness */
+    STM_PHASE_BACKLIGHT_ON,
+
+    /** Waiting for backlight to fade to black */
+    STM_PHASE_BACKLIGHT_OFF,
+
+    /** Number of timed phases */
+    STM_PHASE_COUNT
+} stm_phase_t;
+
 /** Delays for display blank/unblank related debug led patterns [ms] */
 enum
 {
@@ -269,6 +311,7 @@ static bool                mdy_shutdown_in_progress(void);
 static void                mdy_datapipe_packagekit_locked_cb(gconstpointer data);;
 static void                mdy_datapipe_system_state_cb(gconstpointer data);
 static void                mdy_datapipe_submode_cb(gconstpointer data);
+static void                mdy_datapipe_display_preresume_cb(gconstpointer data);
 static gpointer            mdy_datapipe_display_state_filter_cb(gpointer data);
 static void                mdy_datapipe_display_state_cb(gconstpointer data);
 static void                mdy_datapipe_display_state_next_cb(gconstpointer data);
@@ -334,6 +377,15 @@ typedef enum
     FADER_NUMOF
 } fader_type_t;
 
+/** Brightness interpolation curves */
+typedef enum {
+    /** Linear change in brightness level */
+    FADER_CURVE_LINEAR,
+
+    /** Linear change in perceived brightness */
+    FADER_CURVE_PERCEPTUAL,
+} fader_curve_t;
+
 static const char *
 fader_type_name(fader_type_t type)
 {
@@ -355,11 +407,11 @@ static void                mdy_brightness_set_level_hybris(int number);
 static void                mdy_brightness_set_level_default(int number);
 static void                mdy_brightness_set_level(int number);
 
-static void                mdy_brightness_force_level(int number);
+static gint                mdy_brightness_get_cached_level(void);
+static void                mdy_brightness_set_cached_level(gint level);
 
-static void                mdy_brightness_set_priority_boost(bool enable);
+static void                mdy_brightness_force_level(int number);
 
-static gboolean            mdy_brightness_fade_timer_cb(gpointer data);
 static void                mdy_brightness_cleanup_fade_timer(void);
 static void                mdy_brightness_stop_fade_timer(void);
 static void                mdy_brightness_start_fade_timer(fader_type_t type, gint step_time);
@@ -378,6 +430,22 @@ static int                 mdy_brightness_get_dim_threshold_lo(void);
 static int                 mdy_brightness_get_dim_threshold_hi(void);
 
 static void                mdy_brightness_set_on_level(gint hbm_and_level);
+
+/* ------------------------------------------------------------------------- *
+ * BRIGHTNESS_FADER_THREAD
+ * ------------------------------------------------------------------------- */
+
+static uint32_t            mdy_fader_isqrt(uint64_t val);
+static void                mdy_fader_lut_init(void);
+static int                 mdy_fader_level_to_perc(int level);
+static int                 mdy_fader_perc_to_level(int perc);
+static fader_curve_t       mdy_fader_curve_for_type(fader_type_t type);
+
+static void               *mdy_fader_thread_entry(void *aptr);
+static gboolean            mdy_fader_done_cb(GIOChannel *chn, GIOCondition cnd, gpointer aptr);
+static void                mdy_fader_post(bool active, fader_curve_t curve, int step_ms);
+static bool                mdy_fader_thread_start(void);
+static void                mdy_fader_thread_stop(void);
 static void                mdy_brightness_set_dim_level(void);
 static void                mdy_brightness_set_lpm_level(gint level);
 
@@ -610,6 +678,12 @@ static bool                mdy_stm_is_fb_resume_finished(void);
 static void                mdy_stm_release_wakelock(void);
 static void                mdy_stm_acquire_wakelock(void);
 
+// speculative frame buffer resume before unblanking
+static bool                mdy_stm_is_preresume_wanted(void);
+static gboolean            mdy_stm_preresume_timer_cb(gpointer aptr);
+static void                mdy_stm_preresume_cancel(void);
+static void                mdy_stm_preresume_start(void);
+
 // display_state changing
 static void                mdy_stm_push_target_change(display_state_t next_state);
 static bool                mdy_stm_pull_target_change(void);
@@ -634,6 +708,17 @@ static void                mdy_stm_cancel_rethink(void);
 static void                mdy_stm_schedule_rethink(void);
 static void                mdy_stm_force_rethink(void);
 
+/* ------------------------------------------------------------------------- *
+ * DISPLAY_STATE_MACHINE_STATS
+ * ------------------------------------------------------------------------- */
+
+static int64_t             mdy_stm_stats_tick(void);
+static stm_phase_t         mdy_stm_stats_phase_for_state(stm_state_t state);
+static void                mdy_stm_stats_record(stm_phase_t phase, int64_t us);
+static void                mdy_stm_stats_finish(void);
+static void                mdy_stm_stats_trans(stm_state_t prev, stm_state_t next);
+static void                mdy_stm_stats_reset(void);
+
 /* ------------------------------------------------------------------------- *
  * CPU_SCALING_GOVERNOR
  * ------------------------------------------------------------------------- */
@@ -677,6 +762,9 @@ static gboolean            mdy_dbus_handle_blanking_pause_cancel_req(DBusMessage
 
 static gboolean            mdy_dbus_handle_desktop_started_sig(DBusMessage *const msg);
 
+static gboolean            mdy_dbus_handle_stm_stats_get_req(DBusMessage *const msg);
+static gboolean            mdy_dbus_handle_stm_stats_reset_req(DBusMessage *const msg);
+
 static void                mdy_dbus_init(void);
 static void                mdy_dbus_quit(void);
 
@@ -1476,6 +1564,24 @@ EXIT:
     return;
 }
 
+/** Handle display_preresume_pipe notifications
+ *
+ * @param data TRUE if display unblank is likely to follow soon,
+ *             or FALSE if it is not expected anymore
+ */
+static void mdy_datapipe_display_preresume_cb(gconstpointer data)
+{
+    gboolean expected = GPOINTER_TO_INT(data);
+
+    if( expected )
+        mdy_stm_preresume_start();
+    else
+        mdy_stm_preresume_cancel();
+
+    /* Start frame buffer resume / suspend immediately */
+    mdy_stm_force_rethink();
+}
+
 /** Cached proximity sensor state */
 static cover_state_t proximity_state = COVER_UNDEF;
 
@@ -1760,6 +1866,10 @@ static datapipe_handler_t mdy_datapipe_handlers[] =
         .datapipe  = &proximity_sensor_pipe,
         .output_cb = mdy_datapipe_proximity_sensor_cb,
     },
+    {
+        .datapipe  = &display_preresume_pipe,
+        .output_cb = mdy_datapipe_display_preresume_cb,
+    },
     {
         .datapipe  = &alarm_ui_state_pipe,
         .output_cb = mdy_datapipe_alarm_ui_state_cb,
@@ -2044,7 +2154,10 @@ static gint mdy_brightness_level_maximum = DEFAULT_MAXIMUM_DISPLAY_BRIGHTNESS;
 /** File used to get maximum display brightness */
 static gchar *mdy_brightness_level_maximum_path = NULL;
 
-/** Cached brightness, last value written; [0, mdy_brightness_level_maximum] */
+/** Cached brightness, last value written; [0, mdy_brightness_level_maximum]
+ *
+ * Written also by the fader thread; use mdy_brightness_get_cached_level()
+ * and mdy_brightness_set_cached_level() for access. */
 static gint mdy_brightness_level_cached = -1;
 
 /** Brightness, when display is not off; [0, mdy_brightness_level_maximum] */
@@ -2070,7 +2183,7 @@ static output_state_t mdy_brightness_level_output =
 
 /** Hook for setting brightness
  *
- * Note: For use from mdy_brightness_set_level() only!
+ * Note: For use from mdy_brightness_set_level() and the fader thread only!
  *
  * @param number brightness value; after bounds checking
  */
@@ -2088,8 +2201,8 @@ static output_state_t mdy_brightness_hw_fading_output =
     .close_on_exit = TRUE,
 };
 
-/** Brightness fade timeout callback ID */
-static guint mdy_brightness_fade_timer_id = 0;
+/** Flag for: brightness fade is in progress in the fader thread */
+static bool mdy_brightness_fade_running = false;
 
 /** Type of ongoing brightness fade */
 static fader_type_t mdy_brightness_fade_type = FADER_IDLE;
@@ -2183,6 +2296,28 @@ static void mdy_brightness_set_level_hybris(int number)
 }
 #endif
 
+/** Get last brightness level written to hw
+ *
+ * The cached level is updated also from the fader thread,
+ * so it must be accessed only via these helpers.
+ *
+ * @return brightness in 0 to mdy_brightness_level_maximum range,
+ *         or -1 if not known
+ */
+static gint mdy_brightness_get_cached_level(void)
+{
+    return __atomic_load_n(&mdy_brightness_level_cached, __ATOMIC_RELAXED);
+}
+
+/** Set last brightness level written to hw
+ *
+ * @param level brightness in 0 to mdy_brightness_level_maximum range
+ */
+static void mdy_brightness_set_cached_level(gint level)
+{
+    __atomic_store_n(&mdy_brightness_level_cached, level, __ATOMIC_RELAXED);
+}
+
 /** Helper for updating backlight brightness with bounds checking
  *
  * @param number brightness in 0 to mdy_brightness_level_maximum range
@@ -2206,8 +2341,8 @@ static void mdy_brightness_set_level(int number)
     else
         mce_log(LL_DEBUG, "value=%d", number);
 
-    if( mdy_brightness_level_cached != number ) {
-        mdy_brightness_level_cached = number;
+    if( mdy_brightness_get_cached_level() != number ) {
+        mdy_brightness_set_cached_level(number);
         mdy_brightness_set_level_hook(number);
     }
 
@@ -2215,70 +2350,6 @@ static void mdy_brightness_set_level(int number)
     //       and power it up at non-zero brightness???
 }
 
-/** Helper for boosting mce scheduling priority during brightness fading
- *
- * Any scheduling hiccups during backlight brightness tuning are really
- * visible. To make it less likely to occur, this function is used to
- * move mce process to SCHED_FIFO while fade timer is active.
- *
- * Note: Currently this is the only place where mce needs to tweak
- * the scheduling parameters. If that ever changes, a better interface
- * needs to be built.
- */
-static void mdy_brightness_set_priority_boost(bool enable)
-{
-    /* Initialize cached state to default scheduler */
-    static int normal_scheduler = SCHED_OTHER;
-    static int normal_priority  = 0;
-
-    /* Initially boosted priority is not in use */
-    static bool is_enabled = false;
-
-    if( is_enabled == enable )
-        goto EXIT;
-
-    int scheduler = SCHED_OTHER;
-
-    struct sched_param param;
-    memset(&param, 0, sizeof param);
-
-    if( enable ) {
-        /* Cache current scheduling parameters */
-        if( (scheduler = sched_getscheduler(0)) == -1 )
-            mce_log(LL_WARN, "sched_getscheduler: %m");
-        else if( sched_getparam(0, &param) == -1 )
-            mce_log(LL_WARN, "sched_getparam: %m");
-        else {
-            normal_scheduler = scheduler;
-            normal_priority = param.sched_priority;
-        }
-
-        /* Switch to medium priority fifo scheduling */
-        scheduler = SCHED_FIFO;
-        param.sched_priority = (sched_get_priority_min(scheduler) +
-                                sched_get_priority_max(scheduler)) / 2;
-    }
-    else {
-        /* Switch back to cached scheduling parameters */
-        scheduler = normal_scheduler;
-        param.sched_priority = normal_priority;
-    }
-
-    mce_log(LL_DEBUG, "sched=%d, prio=%d", scheduler, param.sched_priority);
-
-    if( sched_setscheduler(0, scheduler, &param) == -1 ) {
-        mce_log(LL_WARN, "can't %s high priority mode: %m",
-                enable ? "enter" : "leave");
-    }
-
-    /* The logical change is made even if we fail to actually change
-     * the scheduling parameters */
-    is_enabled = enable;
-
-EXIT:
-    return;
-}
-
 /** Helper for cancelling brightness fade and forcing a brightness level
  *
  * @param number brightness in 0 to mdy_brightness_level_maximum range
@@ -2286,7 +2357,7 @@ EXIT:
 static void mdy_brightness_force_level(int number)
 {
     mce_log(LL_DEBUG, "brightness from %d to %d",
-            mdy_brightness_level_cached, number);
+            mdy_brightness_get_cached_level(), number);
 
     mdy_brightness_stop_fade_timer();
 
@@ -2355,125 +2426,71 @@ EXIT:
     return;
 }
 
-/**
- * Timeout callback for the brightness fade
+/** Helper function for cleaning up brightness fade state
  *
- * @param data Unused
- * @return Returns TRUE to repeat, until the cached brightness has reached
- *         the destination value; when this happens, FALSE is returned
- */
-static gboolean mdy_brightness_fade_timer_cb(gpointer data)
-{
-    (void)data;
-
-    gboolean keep_going = FALSE;
-
-    if( !mdy_brightness_fade_timer_id )
-        goto EXIT;
-
-    /* Assume end of transition brightness is to be used */
-    int lev = mdy_brightness_fade_end_level;
-
-    /* Get current time */
-    int64_t now = mdy_get_boot_tick();
-
-    if( mdy_brightness_fade_start_time <= now &&
-        now < mdy_brightness_fade_end_time ) {
-        /* Linear interpolation */
-        int weight_end = (int)(now - mdy_brightness_fade_start_time);
-        int weight_beg = (int)(mdy_brightness_fade_end_time - now);
-        int weight_tot = weight_end + weight_beg;
-
-        lev = (weight_end * mdy_brightness_fade_end_level +
-               weight_beg * mdy_brightness_fade_start_level +
-               weight_tot/2) / weight_tot;
-
-        keep_going = TRUE;
-    }
-
-    mdy_brightness_set_level(lev);
-
-    /* Cleanup if finished */
-    if( !keep_going ) {
-        /* Cache fade type that just finished */
-        fader_type_t fader_type = mdy_brightness_fade_type;
-
-        /* Reset fader state */
-        mdy_brightness_fade_timer_id = 0;
-        mdy_brightness_cleanup_fade_timer();
-        mce_log(LL_DEBUG, "fader finished");
-
-        /* Check if we need to continue with als tuning */
-        mdy_brightness_fade_continue_with_als(fader_type);
-    }
-
-EXIT:
-    return keep_going;
-}
-
-/** Helper function for cleaning up brightness fade timer
- *
- * Common fader timer cancellation logic
+ * Common fader cancellation logic
  *
- * NOTE: For use from mdy_brightness_fade_timer_cb() and
+ * NOTE: For use from mdy_fader_done_cb() and
  * mdy_brightness_stop_fade_timer() functions only.
  */
 static void mdy_brightness_cleanup_fade_timer(void)
 {
-    /* Remove timer source */
-    if( mdy_brightness_fade_timer_id )
-        g_source_remove(mdy_brightness_fade_timer_id),
-        mdy_brightness_fade_timer_id = 0;
+    /* Stop the fader thread */
+    if( mdy_brightness_fade_running ) {
+        mdy_brightness_fade_running = false;
+        mdy_fader_post(false, FADER_CURVE_LINEAR, 0);
+    }
 
     /* Clear ongoing fade type */
     mdy_brightness_fade_type = FADER_IDLE;
 
     /* Unblock display off transition */
     mdy_stm_schedule_rethink();
-
-    /* Cancel scheduling priority boost */
-    mdy_brightness_set_priority_boost(false);
 }
 
 /**
- * Cancel the brightness fade timeout
+ * Cancel the brightness fade
  */
 static void mdy_brightness_stop_fade_timer(void)
 {
-    /* Cleanup if timer is active */
-    if( mdy_brightness_fade_timer_id )
+    /* Cleanup if fading is active */
+    if( mdy_brightness_fade_running )
         mdy_brightness_cleanup_fade_timer();
 }
 
 /**
- * Setup the brightness fade timeout
+ * Start brightness fade in the fader thread
  *
+ * @param type      fade type
  * @param step_time The time between each brightness step
  */
 static void mdy_brightness_start_fade_timer(fader_type_t type,
                                             gint step_time)
 {
-    if( !mdy_brightness_fade_timer_id ) {
-        mce_log(LL_DEBUG, "fader started");
-        mdy_brightness_set_priority_boost(true);
+    if( !mdy_fader_thread_start() ) {
+        /* No fader thread -> no fading */
+        mdy_brightness_force_level(mdy_brightness_fade_end_level);
+        goto EXIT;
     }
-    else {
+
+    if( !mdy_brightness_fade_running )
+        mce_log(LL_DEBUG, "fader started");
+    else
         mce_log(LL_DEBUG, "fader restarted");
-        g_source_remove(mdy_brightness_fade_timer_id),
-            mdy_brightness_fade_timer_id = 0;
-    }
 
-    /* Setup new timeout */
-    mdy_brightness_fade_timer_id =
-        g_timeout_add(step_time, mdy_brightness_fade_timer_cb, NULL);
+    mdy_brightness_fade_running = true;
+    mdy_fader_post(true, mdy_fader_curve_for_type(type), step_time);
 
     /* Set ongoing fade type */
     mdy_brightness_fade_type = type;
+
+EXIT:
+    return;
 }
 
 static bool mdy_brightness_fade_is_active(void)
 {
-    return mdy_brightness_fade_timer_id != 0;
+    return mdy_brightness_fade_running;
 }
 
 /** Check if starting brightness fade of given type is allowed
@@ -2544,7 +2561,7 @@ static void mdy_brightness_set_fade_target_ex(fader_type_t type,
 
     /* Negative transition time: constant velocity change [%/s] */
     if( transition_time < 0 ) {
-        int d = abs(new_brightness - mdy_brightness_level_cached);
+        int d = abs(new_brightness - mdy_brightness_get_cached_level());
         // velocity: percent/sec -> steps/sec
         int v = mce_xlat_int(1, 100,
                              1, mdy_brightness_level_maximum,
@@ -2562,7 +2579,7 @@ static void mdy_brightness_set_fade_target_ex(fader_type_t type,
 
     mce_log(LL_DEBUG, "type %s fade from %d to %d in %d ms",
             fader_type_name(type),
-            mdy_brightness_level_cached,
+            mdy_brightness_get_cached_level(),
             new_brightness, transition_time);
 
     if( !mdy_brightness_is_fade_allowed(type) ) {
@@ -2574,14 +2591,14 @@ static void mdy_brightness_set_fade_target_ex(fader_type_t type,
 
     /* If we're already at the target level, stop any
      * ongoing fading activity */
-    if( mdy_brightness_level_cached == new_brightness ) {
+    if( mdy_brightness_get_cached_level() == new_brightness ) {
         mdy_brightness_stop_fade_timer();
         goto EXIT;
     }
 
     /* Small enough changes are made immediately instead of
      * using fading timer */
-    if( abs(mdy_brightness_level_cached - new_brightness) <= 1 ) {
+    if( abs(mdy_brightness_get_cached_level() - new_brightness) <= 1 ) {
         mce_log(LL_DEBUG, "small change; not using fader");
         mdy_brightness_force_level(new_brightness);
         goto EXIT;
@@ -2611,7 +2628,7 @@ static void mdy_brightness_set_fade_target_ex(fader_type_t type,
     }
 
     /* Set up fade start and end brightness levels */
-    mdy_brightness_fade_start_level = mdy_brightness_level_cached;
+    mdy_brightness_fade_start_level = mdy_brightness_get_cached_level();
     mdy_brightness_fade_end_level   = new_brightness;
 
     /* If the - possibly adjusted - transition time is so short that
@@ -2949,19 +2966,526 @@ static void mdy_brightness_set_on_level(gint hbm_and_level)
         mdy_brightness_set_fade_target_als(mdy_brightness_level_display_dim);
         break;
 
-    default:
-    case MCE_DISPLAY_POWER_DOWN:
-    case MCE_DISPLAY_POWER_UP:
-    case MCE_DISPLAY_UNDEF:
-        break;
+    default:
+    case MCE_DISPLAY_POWER_DOWN:
+    case MCE_DISPLAY_POWER_UP:
+    case MCE_DISPLAY_UNDEF:
+        break;
+
+    case MCE_DISPLAY_ON:
+        mdy_brightness_set_fade_target_als(mdy_brightness_level_display_on);
+        break;
+    }
+
+EXIT:
+    return;
+}
+
+/* ========================================================================= *
+ * BRIGHTNESS_FADER_THREAD
+ * ========================================================================= */
+
+/** Resolution of perceptual brightness scale */
+#define MDY_FADER_PERC_MAX 1023
+
+/** Lookup table for converting perceptual brightness to hw level */
+static int mdy_fader_perc_to_level_lut[MDY_FADER_PERC_MAX + 1];
+
+/** Maximum brightness level mdy_fader_perc_to_level_lut was made for */
+static int mdy_fader_lut_level_max = 0;
+
+/** Fade request passed from mainloop to fader thread */
+typedef struct
+{
+    /** Request sequence number */
+    unsigned      seq;
+
+    /** Fading should be in progress */
+    bool          active;
+
+    /** Interpolation curve to use */
+    fader_curve_t curve;
+
+    /** Delay between brightness steps [ms] */
+    int           step_ms;
+
+    /** Fade start time [ms, CLOCK_BOOTTIME] */
+    int64_t       beg_time;
+
+    /** Fade end time [ms, CLOCK_BOOTTIME] */
+    int64_t       end_time;
+
+    /** Brightness level at the end of fade */
+    int           end_level;
+} mdy_fader_req_t;
+
+/** Latest fade request; protected by mdy_fader_mutex */
+static mdy_fader_req_t mdy_fader_req;
+
+/** Sequence number of request taken in use by fader thread */
+static unsigned mdy_fader_ack_seq = 0;
+
+/** Sequence number of request that fader thread has finished */
+static unsigned mdy_fader_done_seq = 0;
+
+/** Flag for: fader thread should exit */
+static bool mdy_fader_exit = false;
+
+/** Mutex for passing requests to fader thread */
+static pthread_mutex_t mdy_fader_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/** Condition for waiting fader thread to take request in use */
+static pthread_cond_t mdy_fader_cond = PTHREAD_COND_INITIALIZER;
+
+/** Fader thread */
+static pthread_t mdy_fader_thread = 0;
+
+/** Eventfd for waking up fader thread */
+static int mdy_fader_req_fd = -1;
+
+/** Eventfd for signaling fade completion to mainloop */
+static int mdy_fader_done_fd = -1;
+
+/** Timerfd driving brightness steps in fader thread */
+static int mdy_fader_timer_fd = -1;
+
+/** I/O watch id for mdy_fader_done_fd */
+static guint mdy_fader_done_id = 0;
+
+/** Integer square root
+ *
+ * @param val value
+ *
+ * @return largest integer whose square is <= val
+ */
+static uint32_t mdy_fader_isqrt(uint64_t val)
+{
+    uint64_t res = 0;
+    uint64_t bit = 1ull << 62;
+
+    while( bit > val )
+        bit >>= 2;
+
+    while( bit ) {
+        if( val >= res + bit ) {
+            val -= res + bit;
+            res = (res >> 1) + bit;
+        }
+        else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (uint32_t)res;
+}
+
+/** Precompute perceptual brightness lookup table
+ *
+ * Perceived brightness is approximated with gamma 2 curve, i.e.
+ * hw level = max * perc^2.
+ */
+static void mdy_fader_lut_init(void)
+{
+    int64_t max = mdy_brightness_level_maximum;
+    int64_t div = (int64_t)MDY_FADER_PERC_MAX * MDY_FADER_PERC_MAX;
+
+    for( int64_t p = 0; p <= MDY_FADER_PERC_MAX; ++p )
+        mdy_fader_perc_to_level_lut[p] = (int)((max * p * p + div / 2) / div);
+
+    mdy_fader_lut_level_max = (int)max;
+}
+
+/** Convert hw brightness level to perceptual brightness
+ *
+ * @param level brightness level in 0 ... mdy_fader_lut_level_max range
+ *
+ * @return perceptual brightness in 0 ... MDY_FADER_PERC_MAX range
+ */
+static int mdy_fader_level_to_perc(int level)
+{
+    if( mdy_fader_lut_level_max <= 0 || level <= 0 )
+        return 0;
+
+    if( level >= mdy_fader_lut_level_max )
+        return MDY_FADER_PERC_MAX;
+
+    uint64_t sq = (uint64_t)MDY_FADER_PERC_MAX * MDY_FADER_PERC_MAX;
+
+    return (int)mdy_fader_isqrt(sq * (uint64_t)level /
+                                (uint64_t)mdy_fader_lut_level_max);
+}
+
+/** Convert perceptual brightness to hw brightness level
+ *
+ * @param perc perceptual brightness in 0 ... MDY_FADER_PERC_MAX range
+ *
+ * @return brightness level
+ */
+static int mdy_fader_perc_to_level(int perc)
+{
+    if( perc < 0 )
+        perc = 0;
+    else if( perc > MDY_FADER_PERC_MAX )
+        perc = MDY_FADER_PERC_MAX;
+
+    return mdy_fader_perc_to_level_lut[perc];
+}
+
+/** Select interpolation curve for fade type
+ *
+ * Fades associated with display power transitions are short and
+ * kept linear so that changes near black are not stretched out.
+ *
+ * @param type fade type
+ *
+ * @return interpolation curve
+ */
+static fader_curve_t mdy_fader_curve_for_type(fader_type_t type)
+{
+    fader_curve_t curve = FADER_CURVE_PERCEPTUAL;
+
+    switch( type ) {
+    case FADER_BLANK:
+    case FADER_UNBLANK:
+        curve = FADER_CURVE_LINEAR;
+        break;
+    default:
+        break;
+    }
+
+    return curve;
+}
+
+/** Fader thread
+ *
+ * Waits for fade requests from mainloop and executes brightness
+ * steps driven by timerfd, so that fading is not affected by
+ * mainloop load.
+ *
+ * While a fade is active the fader thread has exclusive use of the
+ * brightness control; mdy_fader_post() does not return from stop
+ * requests until the thread has acknowledged them. Errors from the
+ * brightness control are logged from this thread, which is ok as
+ * mce_log() is thread safe and logs from non-mainloop threads are
+ * written out synchronously.
+ *
+ * @param aptr (unused)
+ *
+ * @return 0
+ */
+static void *mdy_fader_thread_entry(void *aptr)
+{
+    (void)aptr;
+
+    /* Only the fader thread runs with elevated priority */
+    struct sched_param param;
+    memset(&param, 0, sizeof param);
+    param.sched_priority = (sched_get_priority_min(SCHED_FIFO) +
+                            sched_get_priority_max(SCHED_FIFO)) / 2;
+    if( pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0 )
+        mce_log(LL_WARN, "fader: can't enter high priority mode");
+
+    mdy_fader_req_t req = { .active = false };
+    int  beg_level = 0;
+    int  beg_perc  = 0;
+    int  end_perc  = 0;
+
+    struct pollfd pfd[2] = {
+        { .fd = mdy_fader_req_fd,   .events = POLLIN },
+        { .fd = mdy_fader_timer_fd, .events = POLLIN },
+    };
+
+    for( ;; ) {
+        uint64_t cnt = 0;
+
+        if( poll(pfd, 2, -1) == -1 ) {
+            if( errno == EINTR )
+                continue;
+            mce_log(LL_ERR, "fader: poll: %m");
+            break;
+        }
+
+        /* Set when timer can't be used and fade must end immediately */
+        bool expired = false;
+
+        /* Handle requests before timer ticks so that after stop
+         * request has been acked no more brightness changes are made */
+        if( pfd[0].revents ) {
+            if( read(mdy_fader_req_fd, &cnt, sizeof cnt) == -1 &&
+                errno != EAGAIN && errno != EINTR )
+                break;
+
+            pthread_mutex_lock(&mdy_fader_mutex);
+            bool quit = mdy_fader_exit;
+            req = mdy_fader_req;
+            mdy_fader_ack_seq = req.seq;
+            pthread_cond_broadcast(&mdy_fader_cond);
+            pthread_mutex_unlock(&mdy_fader_mutex);
+
+            if( quit )
+                break;
+
+            struct itimerspec its;
+            memset(&its, 0, sizeof its);
+
+            if( req.active ) {
+                beg_level = mdy_brightness_get_cached_level();
+                beg_perc  = mdy_fader_level_to_perc(beg_level);
+                end_perc  = mdy_fader_level_to_perc(req.end_level);
+
+                /* Zero step would disarm the timer */
+                int step_ms = req.step_ms > 0 ? req.step_ms : 1;
+
+                its.it_value.tv_sec  = step_ms / 1000;
+                its.it_value.tv_nsec = step_ms % 1000 * 1000000L;
+                its.it_interval      = its.it_value;
+            }
+
+            if( timerfd_settime(mdy_fader_timer_fd, 0, &its, 0) == -1 ) {
+                mce_log(LL_ERR, "fader: timer: %m");
+                expired = true;
+            }
+
+            /* Without timer the fade would never finish; jump
+             * directly to the end level instead */
+            if( !expired )
+                continue;
+        }
+        else {
+            if( !pfd[1].revents )
+                continue;
+
+            if( read(mdy_fader_timer_fd, &cnt, sizeof cnt) == -1 )
+                continue;
+        }
+
+        if( !req.active )
+            continue;
+
+        int     lev = req.end_level;
+        int64_t now = mdy_get_boot_tick();
+        bool    done = true;
+
+        if( !expired && req.beg_time <= now && now < req.end_time ) {
+            int64_t we = now - req.beg_time;
+            int64_t wb = req.end_time - now;
+            int64_t wt = we + wb;
+
+            if( req.curve == FADER_CURVE_PERCEPTUAL ) {
+                int perc = (int)((we * end_perc + wb * beg_perc + wt/2) / wt);
+                lev = mdy_fader_perc_to_level(perc);
+            }
+            else {
+                lev = (int)((we * req.end_level + wb * beg_level + wt/2) / wt);
+            }
+            done = false;
+        }
+
+        lev = mce_clip_int(0, mdy_brightness_level_maximum, lev);
+
+        if( lev != mdy_brightness_get_cached_level() ) {
+            mdy_brightness_set_cached_level(lev);
+            mdy_brightness_set_level_hook(lev);
+        }
+
+        if( done ) {
+            struct itimerspec its;
+            memset(&its, 0, sizeof its);
+            timerfd_settime(mdy_fader_timer_fd, 0, &its, 0);
+            req.active = false;
+
+            __atomic_store_n(&mdy_fader_done_seq, req.seq, __ATOMIC_RELEASE);
+            cnt = 1;
+            if( write(mdy_fader_done_fd, &cnt, sizeof cnt) == -1 )
+                mce_log(LL_ERR, "fader: notify: %m");
+        }
+    }
+
+    return 0;
+}
+
+/** Handle fade finished notification from fader thread
+ *
+ * @param chn  io channel
+ * @param cnd  io condition
+ * @param aptr (unused)
+ *
+ * @return TRUE to keep io watch alive, or FALSE to remove it
+ */
+static gboolean mdy_fader_done_cb(GIOChannel *chn, GIOCondition cnd,
+                                  gpointer aptr)
+{
+    (void)aptr;
+
+    gboolean keep = FALSE;
+    uint64_t cnt  = 0;
+
+    if( !mdy_fader_done_id )
+        goto EXIT;
+
+    if( cnd & (G_IO_ERR | G_IO_HUP | G_IO_NVAL) )
+        goto EXIT;
+
+    if( read(g_io_channel_unix_get_fd(chn), &cnt, sizeof cnt) == -1 ) {
+        if( errno == EINTR || errno == EAGAIN )
+            keep = TRUE;
+        else
+            mce_log(LL_ERR, "read fader events: %m");
+        goto EXIT;
+    }
+
+    keep = TRUE;
+
+    /* Ignore notifications about superseded requests */
+    if( !mdy_brightness_fade_running ||
+        __atomic_load_n(&mdy_fader_done_seq,
+                        __ATOMIC_ACQUIRE) != mdy_fader_req.seq )
+        goto EXIT;
+
+    /* Cache fade type that just finished */
+    fader_type_t fader_type = mdy_brightness_fade_type;
+
+    /* Reset fader state */
+    mdy_brightness_fade_running = false;
+    mdy_brightness_cleanup_fade_timer();
+    mce_log(LL_DEBUG, "fader finished at %d", mdy_brightness_get_cached_level());
+
+    /* Check if we need to continue with als tuning */
+    mdy_brightness_fade_continue_with_als(fader_type);
+
+EXIT:
+    if( !keep && mdy_fader_done_id ) {
+        mdy_fader_done_id = 0;
+        mce_log(LL_CRIT, "fader notifications stopped");
+        mdy_fader_thread_stop();
+    }
+    return keep;
+}
+
+/** Pass fade request to fader thread
+ *
+ * Fading parameters are taken from mdy_brightness_fade_xxx variables.
+ * Stop requests are synchronous; after returning the fader thread
+ * does not make further brightness changes.
+ *
+ * @param active  true to start fading, false to stop
+ * @param curve   interpolation curve
+ * @param step_ms delay between brightness steps [ms]
+ */
+static void mdy_fader_post(bool active, fader_curve_t curve, int step_ms)
+{
+    if( !mdy_fader_thread )
+        goto EXIT;
+
+    pthread_mutex_lock(&mdy_fader_mutex);
+
+    mdy_fader_req.seq      += 1;
+    mdy_fader_req.active    = active;
+    mdy_fader_req.curve     = curve;
+    mdy_fader_req.step_ms   = step_ms;
+    mdy_fader_req.beg_time  = mdy_brightness_fade_start_time;
+    mdy_fader_req.end_time  = mdy_brightness_fade_end_time;
+    mdy_fader_req.end_level = mdy_brightness_fade_end_level;
+
+    uint64_t cnt = 1;
+    if( write(mdy_fader_req_fd, &cnt, sizeof cnt) == -1 )
+        mce_log(LL_ERR, "fader request: %m");
+    else if( !active ) {
+        while( mdy_fader_ack_seq != mdy_fader_req.seq )
+            pthread_cond_wait(&mdy_fader_cond, &mdy_fader_mutex);
+    }
+
+    pthread_mutex_unlock(&mdy_fader_mutex);
+
+EXIT:
+    return;
+}
+
+/** Start fader thread if not already running
+ *
+ * @return true if fader thread is running, false otherwise
+ */
+static bool mdy_fader_thread_start(void)
+{
+    GIOChannel *chn = 0;
+
+    if( mdy_fader_thread || mdy_unloading_module )
+        goto EXIT;
+
+    if( mdy_fader_lut_level_max != mdy_brightness_level_maximum )
+        mdy_fader_lut_init();
+
+    mdy_fader_req_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    mdy_fader_done_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    mdy_fader_timer_fd = timerfd_create(CLOCK_MONOTONIC,
+                                        TFD_CLOEXEC | TFD_NONBLOCK);
+
+    if( mdy_fader_req_fd == -1 || mdy_fader_done_fd == -1 ||
+        mdy_fader_timer_fd == -1 ) {
+        mce_log(LL_ERR, "fader fd setup: %m");
+        goto EXIT;
+    }
+
+    if( !(chn = g_io_channel_unix_new(mdy_fader_done_fd)) )
+        goto EXIT;
+
+    mdy_fader_done_id = g_io_add_watch(chn,
+                                       G_IO_IN | G_IO_ERR |
+                                       G_IO_HUP | G_IO_NVAL,
+                                       mdy_fader_done_cb, 0);
+    if( !mdy_fader_done_id )
+        goto EXIT;
+
+    mdy_fader_exit = false;
+
+    if( pthread_create(&mdy_fader_thread, 0, mdy_fader_thread_entry, 0) ) {
+        mce_log(LL_ERR, "failed to create fader thread");
+        mdy_fader_thread = 0;
+        goto EXIT;
+    }
+
+    mce_log(LL_DEBUG, "fader thread started");
+
+EXIT:
+    if( chn ) g_io_channel_unref(chn);
+
+    /* all or nothing */
+    if( !mdy_fader_thread )
+        mdy_fader_thread_stop();
+
+    return mdy_fader_thread != 0;
+}
+
+/** Stop fader thread and release associated resources
+ */
+static void mdy_fader_thread_stop(void)
+{
+    if( mdy_fader_thread ) {
+        pthread_mutex_lock(&mdy_fader_mutex);
+        mdy_fader_exit = true;
+        uint64_t cnt = 1;
+        if( write(mdy_fader_req_fd, &cnt, sizeof cnt) == -1 )
+            mce_log(LL_ERR, "fader exit request: %m");
+        pthread_mutex_unlock(&mdy_fader_mutex);
 
-    case MCE_DISPLAY_ON:
-        mdy_brightness_set_fade_target_als(mdy_brightness_level_display_on);
-        break;
+        pthread_join(mdy_fader_thread, 0), mdy_fader_thread = 0;
+        mce_log(LL_DEBUG, "fader thread stopped");
     }
 
-EXIT:
-    return;
+    if( mdy_fader_done_id )
+        g_source_remove(mdy_fader_done_id), mdy_fader_done_id = 0;
+
+    if( mdy_fader_req_fd != -1 )
+        close(mdy_fader_req_fd), mdy_fader_req_fd = -1;
+
+    if( mdy_fader_done_fd != -1 )
+        close(mdy_fader_done_fd), mdy_fader_done_fd = -1;
+
+    if( mdy_fader_timer_fd != -1 )
+        close(mdy_fader_timer_fd), mdy_fader_timer_fd = -1;
+
+    mdy_brightness_fade_running = false;
 }
 
 /* ========================================================================= *
@@ -6125,6 +6649,11 @@ static const char *mdy_stm_state_name(stm_state_t state)
         DO(ENTER_LOGICAL_OFF);
         DO(STAY_LOGICAL_OFF);
         DO(LEAVE_LOGICAL_OFF);
+        DO(INIT_PRERESUME);
+        DO(WAIT_PRERESUME);
+        DO(STAY_PRERESUMED);
+        DO(INIT_UNDO_PRERESUME);
+        DO(WAIT_UNDO_PRERESUME);
     default: break;
     }
 #undef DO
@@ -6325,6 +6854,76 @@ static bool mdy_stm_is_fb_resume_finished(void)
     return res;
 }
 
+/** Speculative frame buffer resume allowed; from ini file */
+static gboolean mdy_stm_preresume_enabled = DEFAULT_DISPLAY_PRERESUME;
+
+/** Timer id for expiring speculative frame buffer resume */
+static guint mdy_stm_preresume_timer_id = 0;
+
+/** Predicate for: speculative frame buffer resume is wanted
+ */
+static bool mdy_stm_is_preresume_wanted(void)
+{
+    return mdy_stm_preresume_timer_id != 0;
+}
+
+/** Timer callback for expiring speculative frame buffer resume
+ */
+static gboolean mdy_stm_preresume_timer_cb(gpointer aptr)
+{
+    (void)aptr;
+
+    if( !mdy_stm_preresume_timer_id )
+        goto EXIT;
+
+    mdy_stm_preresume_timer_id = 0;
+
+    mce_log(LL_DEBUG, "pre-resume expired without unblanking");
+    mdy_stm_schedule_rethink();
+
+EXIT:
+    return FALSE;
+}
+
+/** Stop expecting display unblank request
+ */
+static void mdy_stm_preresume_cancel(void)
+{
+    if( mdy_stm_preresume_timer_id ) {
+        g_source_remove(mdy_stm_preresume_timer_id),
+            mdy_stm_preresume_timer_id = 0;
+        mce_log(LL_DEBUG, "pre-resume cancelled");
+    }
+}
+
+/** Start expecting display unblank request
+ *
+ * Frame buffer resume is started already before the display state
+ * request arrives. If it does not arrive within MDY_PRERESUME_TIMEOUT
+ * ms, the frame buffer is suspended again.
+ */
+static void mdy_stm_preresume_start(void)
+{
+    if( !mdy_stm_preresume_enabled )
+        goto EXIT;
+
+    /* Only when resting at display off; restarts extend the timeout */
+    if( !mdy_stm_preresume_timer_id && mdy_stm_dstate != STM_STAY_POWER_OFF )
+        goto EXIT;
+
+    if( mdy_stm_preresume_timer_id )
+        g_source_remove(mdy_stm_preresume_timer_id);
+    else
+        mce_log(LL_DEBUG, "pre-resume started");
+
+    mdy_stm_preresume_timer_id = g_timeout_add(MDY_PRERESUME_TIMEOUT,
+                                               mdy_stm_preresume_timer_cb,
+                                               0);
+
+EXIT:
+    return;
+}
+
 /** Release display wakelock to allow late suspend
  */
 static void mdy_stm_release_wakelock(void)
@@ -6361,6 +6960,7 @@ static void mdy_stm_trans(stm_state_t state)
         mce_log(LL_INFO, "STM: %s -> %s",
                 mdy_stm_state_name(mdy_stm_dstate),
                 mdy_stm_state_name(state));
+        mdy_stm_stats_trans(mdy_stm_dstate, state);
         mdy_stm_dstate = state;
     }
 }
@@ -6618,19 +7218,31 @@ static void mdy_stm_step(void)
 
     case STM_STAY_POWER_OFF:
         if( mdy_stm_pull_target_change() ) {
+            mdy_stm_preresume_cancel();
             mdy_stm_trans(STM_LEAVE_POWER_OFF);
             break;
         }
 
         if( !mdy_stm_is_early_suspend_allowed() ) {
+            mdy_stm_preresume_cancel();
             mdy_stm_trans(STM_LEAVE_POWER_OFF);
             break;
         }
 
+        if( mdy_stm_is_preresume_wanted() ) {
+            mdy_stm_trans(STM_INIT_PRERESUME);
+            break;
+        }
+
         /* FIXME: Need separate states for stopping/starting
          *        sensors during suspend/resume */
 
         if( mdy_stm_is_late_suspend_allowed() ) {
+            /* Settings changes are saved with a delay, get them
+             * to persistent storage before suspending - but only
+             * when entering late suspend, as the flush blocks */
+            if( mdy_stm_acquire_wakelockd )
+                mce_gconf_flush();
             mce_sensorfw_suspend();
             mdy_stm_release_wakelock();
         }
@@ -6663,7 +7275,7 @@ static void mdy_stm_step(void)
             /* We must have non-zero brightness in place when ui draws
              * for the 1st time or the brightness changes will not happen
              * until ui draws again ... */
-            if( mdy_brightness_level_cached <= 0 )
+            if( mdy_brightness_get_cached_level() <= 0 )
                 mdy_brightness_force_level(1);
 
             mdy_brightness_set_fade_target_unblank(mdy_brightness_level_display_resume);
@@ -6712,6 +7324,56 @@ static void mdy_stm_step(void)
 
         mdy_stm_trans(STM_INIT_SUSPEND);
         break;
+
+    case STM_INIT_PRERESUME:
+        /* Display unblank is expected; start frame buffer resume
+         * without waiting for the display state request */
+        mdy_stm_acquire_wakelock();
+        mdy_stm_start_fb_resume();
+        mdy_stm_trans(STM_WAIT_PRERESUME);
+        break;
+
+    case STM_WAIT_PRERESUME:
+        /* Let the resume finish before acting on anything else so
+         * that frame buffer state tracking stays in sync */
+        if( !mdy_stm_is_fb_resume_finished() )
+            break;
+        mdy_stm_trans(STM_STAY_PRERESUMED);
+        break;
+
+    case STM_STAY_PRERESUMED:
+        if( mdy_stm_pull_target_change() ) {
+            mdy_stm_preresume_cancel();
+            if( mdy_stm_display_state_needs_power(mdy_stm_next) )
+                mdy_stm_trans(STM_LEAVE_POWER_OFF);
+            else
+                mdy_stm_trans(STM_INIT_SUSPEND);
+            break;
+        }
+
+        if( !mdy_stm_is_early_suspend_allowed() ) {
+            mdy_stm_preresume_cancel();
+            mdy_stm_trans(STM_LEAVE_POWER_OFF);
+            break;
+        }
+
+        /* Unblanking did not happen; return to display off */
+        if( !mdy_stm_is_preresume_wanted() )
+            mdy_stm_trans(STM_INIT_UNDO_PRERESUME);
+        break;
+
+    case STM_INIT_UNDO_PRERESUME:
+        /* Display state did not change, so there is no target change
+         * to finish - just suspend the frame buffer again */
+        mdy_stm_start_fb_suspend();
+        mdy_stm_trans(STM_WAIT_UNDO_PRERESUME);
+        break;
+
+    case STM_WAIT_UNDO_PRERESUME:
+        if( !mdy_stm_is_fb_suspend_finished() )
+            break;
+        mdy_stm_trans(STM_STAY_POWER_OFF);
+        break;
     }
 }
 
@@ -6820,6 +7482,228 @@ EXIT:
   return;
 }
 
+/* ========================================================================= *
+ * DISPLAY_STATE_MACHINE_STATS
+ * ========================================================================= */
+
+/** Number of recent transitions to keep track of */
+#define MDY_STM_STATS_RECENT 32
+
+/** Histogram bucket upper limits [us]
+ *
+ * The last bucket holds everything that took longer.
+ */
+static const guint64 mdy_stm_stats_limits[] =
+{
+    5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000, 2000000,
+};
+
+/** Timing details of one display state transition */
+typedef struct
+{
+    /** Display state transition started from */
+    display_state_t tr_from;
+
+    /** Display state transition ended at */
+    display_state_t tr_to;
+
+    /** Transition start time [ms, CLOCK_BOOTTIME] */
+    int64_t         tr_started;
+
+    /** Time spent in each phase [us] */
+    guint64         tr_phase[STM_PHASE_COUNT];
+} mdy_stm_transition_t;
+
+/** Duration statistics for each transition phase [us] */
+static mce_hist_t mdy_stm_stats_phase[STM_PHASE_COUNT] =
+{
+    [STM_PHASE_TOTAL]         = MCE_HIST_INIT("total",         mdy_stm_stats_limits),
+    [STM_PHASE_UI_START]      = MCE_HIST_INIT("ui_start",      mdy_stm_stats_limits),
+    [STM_PHASE_UI_STOP]       = MCE_HIST_INIT("ui_stop",       mdy_stm_stats_limits),
+    [STM_PHASE_FB_SUSPEND]    = MCE_HIST_INIT("fb_suspend",    mdy_stm_stats_limits),
+    [STM_PHASE_FB_RESUME]     = MCE_HIST_INIT("fb_resume",     mdy_stm_stats_limits),
+    [STM_PHASE_BACKLIGHT_ON]  = MCE_HIST_INIT("backlight_on",  mdy_stm_stats_limits),
+    [STM_PHASE_BACKLIGHT_OFF] = MCE_HIST_INIT("backlight_off", mdy_stm_stats_limits),
+};
+
+/** Ring buffer of recently finished transitions */
+static mdy_stm_transition_t mdy_stm_stats_recent[MDY_STM_STATS_RECENT];
+
+/** Number of transitions added to mdy_stm_stats_recent */
+static unsigned mdy_stm_stats_recent_cnt = 0;
+
+/** Transition currently being timed */
+static mdy_stm_transition_t mdy_stm_stats_curr;
+
+/** Flag for: mdy_stm_stats_curr holds a transition in progress */
+static bool mdy_stm_stats_active = false;
+
+/** Time when current state machine state was entered [us] */
+static int64_t mdy_stm_stats_entered = 0;
+
+/** Get current CLOCK_BOOTTIME in microseconds
+ */
+static int64_t mdy_stm_stats_tick(void)
+{
+    int64_t res = 0;
+
+    struct timespec ts;
+
+    if( clock_gettime(CLOCK_BOOTTIME, &ts) == 0 )
+        res = ts.tv_sec * INT64_C(1000000) + ts.tv_nsec / 1000;
+
+    return res;
+}
+
+/** Map state machine wait state to transition phase
+ *
+ * @param state state machine state
+ *
+ * @return phase the state belongs to, or STM_PHASE_TOTAL if the
+ *         state is not timed separately
+ */
+static stm_phase_t mdy_stm_stats_phase_for_state(stm_state_t state)
+{
+    stm_phase_t phase = STM_PHASE_TOTAL;
+
+    switch( state ) {
+    case STM_RENDERER_INIT_START:
+    case STM_RENDERER_WAIT_START:
+        phase = STM_PHASE_UI_START;
+        break;
+
+    case STM_RENDERER_INIT_STOP:
+    case STM_RENDERER_WAIT_STOP:
+        phase = STM_PHASE_UI_STOP;
+        break;
+
+    case STM_INIT_SUSPEND:
+    case STM_WAIT_SUSPEND:
+    case STM_INIT_UNDO_PRERESUME:
+    case STM_WAIT_UNDO_PRERESUME:
+        phase = STM_PHASE_FB_SUSPEND;
+        break;
+
+    case STM_INIT_RESUME:
+    case STM_WAIT_RESUME:
+    case STM_INIT_PRERESUME:
+    case STM_WAIT_PRERESUME:
+        phase = STM_PHASE_FB_RESUME;
+        break;
+
+    case STM_WAIT_FADE_TO_TARGET:
+        phase = STM_PHASE_BACKLIGHT_ON;
+        break;
+
+    case STM_WAIT_FADE_TO_BLACK:
+        phase = STM_PHASE_BACKLIGHT_OFF;
+        break;
+
+    default:
+        break;
+    }
+
+    return phase;
+}
+
+/** Add phase duration sample to histogram
+ *
+ * @param phase transition phase
+ * @param us    duration in microseconds
+ */
+static void mdy_stm_stats_record(stm_phase_t phase, int64_t us)
+{
+    if( (unsigned)phase >= STM_PHASE_COUNT || us < 0 )
+        goto EXIT;
+
+    mce_hist_add(mdy_stm_stats_phase + phase, (guint64)us);
+
+EXIT:
+    return;
+}
+
+/** Finish timing of current display state transition
+ */
+static void mdy_stm_stats_finish(void)
+{
+    mdy_stm_transition_t *tr = &mdy_stm_stats_curr;
+
+    tr->tr_to = mdy_stm_curr;
+
+    for( int i = 0; i < STM_PHASE_COUNT; ++i ) {
+        /* Phases that were not visited are not counted */
+        if( i == STM_PHASE_TOTAL || tr->tr_phase[i] > 0 )
+            mdy_stm_stats_record(i, tr->tr_phase[i]);
+    }
+
+    mdy_stm_stats_recent[mdy_stm_stats_recent_cnt++ % MDY_STM_STATS_RECENT] = *tr;
+    mdy_stm_stats_active = false;
+
+    mce_log(LL_DEBUG, "%s -> %s: total %.1f ms; ui %.1f ms; fb %.1f ms;"
+            " backlight %.1f ms",
+            display_state_repr(tr->tr_from),
+            display_state_repr(tr->tr_to),
+            tr->tr_phase[STM_PHASE_TOTAL] * 1e-3,
+            (tr->tr_phase[STM_PHASE_UI_START] +
+             tr->tr_phase[STM_PHASE_UI_STOP]) * 1e-3,
+            (tr->tr_phase[STM_PHASE_FB_RESUME] +
+             tr->tr_phase[STM_PHASE_FB_SUSPEND]) * 1e-3,
+            (tr->tr_phase[STM_PHASE_BACKLIGHT_ON] +
+             tr->tr_phase[STM_PHASE_BACKLIGHT_OFF]) * 1e-3);
+}
+
+/** Update transition timing on state machine state change
+ *
+ * Called from mdy_stm_trans() before the state is changed.
+ *
+ * @param prev state machine state that is being left
+ * @param next state machine state that is being entered
+ */
+static void mdy_stm_stats_trans(stm_state_t prev, stm_state_t next)
+{
+    (void)next;
+
+    int64_t now = mdy_stm_stats_tick();
+    int64_t spent = now - mdy_stm_stats_entered;
+
+    mdy_stm_stats_entered = now;
+
+    if( mdy_stm_stats_active ) {
+        mdy_stm_transition_t *tr = &mdy_stm_stats_curr;
+        stm_phase_t phase = mdy_stm_stats_phase_for_state(prev);
+
+        if( spent < 0 )
+            spent = 0;
+
+        tr->tr_phase[STM_PHASE_TOTAL] += (guint64)spent;
+        if( phase != STM_PHASE_TOTAL )
+            tr->tr_phase[phase] += (guint64)spent;
+
+        /* Transition ends when target display state has been entered */
+        if( mdy_stm_curr == mdy_stm_next )
+            mdy_stm_stats_finish();
+    }
+    else if( mdy_stm_curr != mdy_stm_next ) {
+        /* Transition starts when a new target has been pulled */
+        memset(&mdy_stm_stats_curr, 0, sizeof mdy_stm_stats_curr);
+        mdy_stm_stats_curr.tr_from    = mdy_stm_curr;
+        mdy_stm_stats_curr.tr_to      = mdy_stm_next;
+        mdy_stm_stats_curr.tr_started = now / 1000;
+        mdy_stm_stats_active = true;
+    }
+}
+
+/** Clear display state transition statistics
+ */
+static void mdy_stm_stats_reset(void)
+{
+    for( size_t i = 0; i < STM_PHASE_COUNT; ++i )
+        mce_hist_reset(mdy_stm_stats_phase + i);
+
+    memset(mdy_stm_stats_recent, 0, sizeof mdy_stm_stats_recent);
+    mdy_stm_stats_recent_cnt = 0;
+}
+
 /* ========================================================================= *
  * CPU_SCALING_GOVERNOR
  * ========================================================================= */
@@ -7948,6 +8832,117 @@ static gboolean mdy_dbus_handle_desktop_started_sig(DBusMessage *const msg)
     return status;
 }
 
+/** D-Bus callback for the get display state machine statistics method call
+ *
+ * Reply contains duration histograms for each transition phase and
+ * per phase timing of recently finished display state transitions.
+ * Phase durations of transitions are in the same order as the
+ * histograms.
+ *
+ * @param msg The D-Bus message to reply to
+ *
+ * @return TRUE
+ */
+static gboolean mdy_dbus_handle_stm_stats_get_req(DBusMessage *const msg)
+{
+    DBusMessage     *reply = 0;
+    DBusMessageIter  body, arr, sub, vec;
+
+    mce_log(LL_DEBUG, "Received display stm statistics request from %s",
+            mce_dbus_get_message_sender_ident(msg));
+
+    if( dbus_message_get_no_reply(msg) )
+        goto EXIT;
+
+    if( !(reply = dbus_new_method_reply(msg)) )
+        goto EXIT;
+
+    dbus_message_iter_init_append(reply, &body);
+
+    /* Phase histograms */
+    if( !dbus_message_iter_open_container(&body, DBUS_TYPE_ARRAY,
+                                          MCE_DBUS_HIST_SIGNATURE, &arr) )
+        goto EXIT;
+
+    for( size_t i = 0; i < STM_PHASE_COUNT; ++i ) {
+        if( !mce_dbus_iter_append_hist(&arr, mdy_stm_stats_phase + i) )
+            break;
+    }
+
+    dbus_message_iter_close_container(&body, &arr);
+
+    /* Recent transitions, oldest first */
+    if( !dbus_message_iter_open_container(&body, DBUS_TYPE_ARRAY,
+                                          "(ssxat)", &arr) )
+        goto EXIT;
+
+    unsigned beg = 0;
+    if( mdy_stm_stats_recent_cnt > MDY_STM_STATS_RECENT )
+        beg = mdy_stm_stats_recent_cnt - MDY_STM_STATS_RECENT;
+
+    for( unsigned i = beg; i < mdy_stm_stats_recent_cnt; ++i ) {
+        const mdy_stm_transition_t *tr =
+            mdy_stm_stats_recent + i % MDY_STM_STATS_RECENT;
+        const char          *from  = display_state_repr(tr->tr_from);
+        const char          *to    = display_state_repr(tr->tr_to);
+        const dbus_int64_t   when  = tr->tr_started;
+        const dbus_uint64_t *phase = tr->tr_phase;
+
+        if( !dbus_message_iter_open_container(&arr, DBUS_TYPE_STRUCT,
+                                              0, &sub) )
+            break;
+
+        dbus_message_iter_append_basic(&sub, DBUS_TYPE_STRING, &from);
+        dbus_message_iter_append_basic(&sub, DBUS_TYPE_STRING, &to);
+        dbus_message_iter_append_basic(&sub, DBUS_TYPE_INT64, &when);
+
+        if( dbus_message_iter_open_container(&sub, DBUS_TYPE_ARRAY,
+                                             DBUS_TYPE_UINT64_AS_STRING,
+                                             &vec) ) {
+            dbus_message_iter_append_fixed_array(&vec, DBUS_TYPE_UINT64,
+                                                 &phase, STM_PHASE_COUNT);
+            dbus_message_iter_close_container(&sub, &vec);
+        }
+
+        dbus_message_iter_close_container(&arr, &sub);
+    }
+
+    dbus_message_iter_close_container(&body, &arr);
+
+    dbus_send_message(reply), reply = 0;
+
+EXIT:
+    if( reply )
+        dbus_message_unref(reply);
+
+    return TRUE;
+}
+
+/** D-Bus callback for the reset display state machine statistics method call
+ *
+ * @param msg The D-Bus message to reply to
+ *
+ * @return TRUE
+ */
+static gboolean mdy_dbus_handle_stm_stats_reset_req(DBusMessage *const msg)
+{
+    DBusMessage *reply = 0;
+
+    mce_log(LL_DEVEL, "Received display stm statistics reset request from %s",
+            mce_dbus_get_message_sender_ident(msg));
+
+    mdy_stm_stats_reset();
+
+    if( dbus_message_get_no_reply(msg) )
+        goto EXIT;
+
+    if( (reply = dbus_new_method_reply(msg)) )
+        dbus_send_message(reply), reply = 0;
+
+EXIT:
+    return TRUE;
+}
+
 /** Array of dbus message handlers */
 static mce_dbus_handler_t mdy_dbus_handlers[] =
 {
@@ -8078,6 +9073,23 @@ static mce_dbus_handler_t mdy_dbus_handlers[] =
             "    <arg direction=\"in\" name=\"requested_cabc_mode\" type=\"s\"/>\n"
             "    <arg direction=\"out\" name=\"activated_cabc_mode\" type=\"s\"/>\n"
     },
+    {
+        .interface = MCE_REQUEST_IF,
+        .name      = MCE_DISPLAY_STM_STATS_GET,
+        .type      = DBUS_MESSAGE_TYPE_METHOD_CALL,
+        .callback  = mdy_dbus_handle_stm_stats_get_req,
+        .args      =
+            "    <arg direction=\"out\" name=\"phases\" type=\"a" MCE_DBUS_HIST_SIGNATURE "\"/>\n"
+            "    <arg direction=\"out\" name=\"transitions\" type=\"a(ssxat)\"/>\n"
+    },
+    {
+        .interface = MCE_REQUEST_IF,
+        .name      = MCE_DISPLAY_STM_STATS_RESET,
+        .type      = DBUS_MESSAGE_TYPE_METHOD_CALL,
+        .callback  = mdy_dbus_handle_stm_stats_reset_req,
+        .args      =
+            ""
+    },
     /* sentinel */
     {
         .interface = 0
@@ -9076,16 +10088,20 @@ static void mdy_brightness_init(void)
 
     mce_log(LL_DEBUG, "max_brightness = %d", mdy_brightness_level_maximum);
 
+    /* Start the fader thread; uses lookup tables that
+     * depend on maximum brightness */
+    mdy_fader_thread_start();
+
     /* If we can read the current hw brightness level, update the
      * cached brightness so we can do soft transitions from the
      * initial state */
     if( mdy_brightness_level_output.path &&
         mce_read_number_string_from_file(mdy_brightness_level_output.path,
                                               &tmp, NULL, FALSE, TRUE) ) {
-        mdy_brightness_level_cached = (gint)tmp;
+        mdy_brightness_set_cached_level((gint)tmp);
     }
     mce_log(LL_DEBUG, "mdy_brightness_level_cached=%d",
-            mdy_brightness_level_cached);
+            mdy_brightness_get_cached_level());
 
     /* On some devices there are multiple ways to control backlight
      * brightness. We use only one, but after bootup it might contain
@@ -9110,8 +10126,8 @@ static void mdy_brightness_init(void)
      *    the brightness setting evaluation would lead to the same
      *    value that was originally reported
      */
-    if( mdy_brightness_level_cached > 0 )
-        mdy_brightness_force_level(mdy_brightness_level_cached - 1);
+    if( mdy_brightness_get_cached_level() > 0 )
+        mdy_brightness_force_level(mdy_brightness_get_cached_level() - 1);
 }
 
 /**
@@ -9160,6 +10176,12 @@ const gchar *g_module_check_init(GModule *module)
     mdy_stm_schedule_rethink();
 #endif
 
+    /* Get speculative frame buffer resume config from INI-files */
+    mdy_stm_preresume_enabled =
+        mce_conf_get_bool(MCE_CONF_DISPLAY_GROUP,
+                          MCE_CONF_DISPLAY_PRERESUME,
+                          DEFAULT_DISPLAY_PRERESUME);
+
     /* Start waiting for init_done state */
     mdy_flagfiles_start_tracking();
 
@@ -9180,7 +10202,7 @@ const gchar *g_module_check_init(GModule *module)
     /* if we have brightness control file and initial brightness
      * is zero -> start from display off */
     if( mdy_brightness_level_output.path &&
-        mdy_brightness_level_cached <= 0 )
+        mdy_brightness_get_cached_level() <= 0 )
         display_is_on = FALSE;
 
     /* Note: Transition to MCE_DISPLAY_OFF can be made already
@@ -9232,6 +10254,10 @@ void g_module_unload(GModule *module)
     mdy_waitfb_thread_stop(&mdy_waitfb_data);
 #endif
 
+    /* Stop brightness fading and the fader thread */
+    mdy_brightness_stop_fade_timer();
+    mdy_fader_thread_stop();
+
     /* Remove dbus message handlers */
     mdy_dbus_quit();
 
@@ -9294,6 +10320,7 @@ void g_module_unload(GModule *module)
 
     /* Cancel pending state machine updates */
     mdy_stm_cancel_rethink();
+    mdy_stm_preresume_cancel();
 
     mdy_poweron_led_rethink_cancel();
 
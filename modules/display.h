@@ -33,6 +33,12 @@
 /** List of max backlight control files to try */
 #define MCE_CONF_MAX_BACKLIGHT_PATH             "MaxBrightnessPath"
 
+/** Whether frame buffer resume can be started before unblank request */
+#define MCE_CONF_DISPLAY_PRERESUME              "PreResume"
+
+/** Default value for MCE_CONF_DISPLAY_PRERESUME */
+#define DEFAULT_DISPLAY_PRERESUME               TRUE
+
 /** Default timeout for the high brightness mode; in seconds */
 #define DEFAULT_HBM_TIMEOUT				1800	/* 30 min */
 
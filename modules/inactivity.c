@@ -1137,10 +1137,10 @@ static gboolean mia_timer_cb(gpointer data)
  */
 static void mia_timer_start(void)
 {
-    mia_timer_stop();
-
-    if( device_inactive )
+    if( device_inactive ) {
+        mia_timer_stop();
         goto EXIT;
+    }
 
     mce_log(LL_DEBUG, "inactivity timeout in %d seconds", inactivity_timeout);
     mce_hbtimer_set_period(inactivity_timer_hnd, inactivity_timeout * 1000);
@@ -1168,6 +1168,13 @@ mia_timer_init(void)
     inactivity_timer_hnd = mce_hbtimer_create("inactivity-timer",
                                                inactivity_timeout * 1000,
                                                mia_timer_cb, 0);
+
+    /* Timeout is in seconds, sub-second accuracy is not needed */
+    mce_hbtimer_set_slack(inactivity_timer_hnd, 500);
+
+    /* Timer is restarted on every activity pulse; just extend
+     * the deadline instead of rescheduling wakeups each time */
+    mce_hbtimer_set_lazy(inactivity_timer_hnd, true);
 }
 
 /** Cleanup inactivity heartbeat timer
@@ -253,6 +253,7 @@ static output_state_t led_brightness_rm_output =
 	.context = "led_brightness_rm",
 	.truncate_file = TRUE,
 	.close_on_exit = FALSE,
+	.uncached = TRUE,
 };
 
 /** Path to red channel LED brightness path */
@@ -261,6 +262,7 @@ static output_state_t led_brightness_g_output =
 	.context = "led_brightness_g",
 	.truncate_file = TRUE,
 	.close_on_exit = FALSE,
+	.uncached = TRUE,
 };
 
 /** Path to blue channel LED brightness path */
@@ -269,6 +271,7 @@ static output_state_t led_brightness_b_output =
 	.context = "led_brightness_b",
 	.truncate_file = TRUE,
 	.close_on_exit = FALSE,
+	.uncached = TRUE,
 };
 
 /** Path to engine 1 mode */
@@ -2789,6 +2792,10 @@ static gboolean init_patterns(void)
 						   psp->timeout * 1000,
 						   led_pattern_timeout_cb,
 						   psp);
+
+			/* Pattern timeouts are in seconds; allow
+			 * them to align with other wakeups */
+			mce_hbtimer_set_slack(psp->timeout_id, 1000);
 		}
 	}
 
@@ -29,6 +29,7 @@
 #include "mce-gconf.h"
 #include "mce-dbus.h"
 #include "mce-dsme.h"
+#include "event-input.h"
 
 #ifdef ENABLE_WAKELOCKS
 # include "libwakelock.h"
@@ -386,6 +387,8 @@ static bool pwrkey_stm_pending_timers       (void);
 static void pwrkey_stm_rethink_wakelock     (void);
 
 static void pwrkey_stm_store_initial_state  (void);
+static void pwrkey_stm_preresume            (uint32_t mask);
+static void pwrkey_stm_unblank_resolved     (uint32_t mask);
 static void pwrkey_stm_terminate            (void);
 
 /* ------------------------------------------------------------------------- *
@@ -1411,20 +1414,29 @@ pwrkey_stm_terminate(void)
     pwrkey_double_press_timer_cancel();
     pwrkey_long_press_timer_cancel();
 
+    /* Press handling was abandoned */
+    evin_latency_unblank_cancel();
+
     /* Release wakelock */
     pwrkey_stm_rethink_wakelock();
 }
 
 static void pwrkey_stm_long_press_timeout(void)
 {
+    // frame buffer stays resumed only if long press unblanks
+    pwrkey_stm_preresume(pwrkey_actions_now->mask_long);
+
     // execute long press
     pwrkey_actions_do_long_press();
+    pwrkey_stm_unblank_resolved(pwrkey_actions_now->mask_long);
 }
 
 static void pwrkey_stm_double_press_timeout(void)
 {
     // execute single press
     pwrkey_actions_do_single_press();
+    pwrkey_stm_unblank_resolved(pwrkey_actions_now->mask_common |
+                                pwrkey_actions_now->mask_single);
 }
 
 static void pwrkey_stm_powerkey_pressed(void)
@@ -1432,6 +1444,8 @@ static void pwrkey_stm_powerkey_pressed(void)
     if( pwrkey_double_press_timer_cancel() ) {
         /* Pressed while we were waiting for double press */
         pwrkey_actions_do_double_press();
+        pwrkey_stm_unblank_resolved(pwrkey_actions_now->mask_common |
+                                    pwrkey_actions_now->mask_double);
     }
     else if( !pwrkey_long_press_timer_pending() ) {
         /* Pressed while there are no timers active */
@@ -1441,8 +1455,18 @@ static void pwrkey_stm_powerkey_pressed(void)
 
         /* Start short vs long press detection timer */
         if( !pwrkey_stm_ignore_action() ) {
+            /* Release is likely to unblank; let display
+             * plugin start frame buffer resume already */
+            pwrkey_stm_preresume(pwrkey_actions_now->mask_common |
+                                 pwrkey_actions_now->mask_single |
+                                 pwrkey_actions_now->mask_double);
+
             pwrkey_long_press_timer_start();
         }
+        else {
+            /* Press is not going to unblank the display */
+            evin_latency_unblank_cancel();
+        }
     }
 }
 
@@ -1464,6 +1488,8 @@ static void pwrkey_stm_powerkey_released(void)
             /* There is no config for double press -> just do
              * actions for single press without further delays */
             pwrkey_actions_do_single_press();
+            pwrkey_stm_unblank_resolved(pwrkey_actions_now->mask_common |
+                                        pwrkey_actions_now->mask_single);
         }
     }
 }
@@ -1496,6 +1522,36 @@ static void pwrkey_stm_store_initial_state(void)
     pwrkey_actions_select(display_is_on);
 }
 
+/** Notify display plugin about expected display unblanking
+ *
+ * @param mask actions that are expected to be executed
+ */
+static void pwrkey_stm_preresume(uint32_t mask)
+{
+    /* Only relevant when starting from display off */
+    if( pwrkey_actions_now != &pwrkey_actions_from_display_off )
+        goto EXIT;
+
+    bool unblank = (mask & pwrkey_mask_from_name("unblank")) != 0;
+
+    execute_datapipe(&display_preresume_pipe,
+                     GINT_TO_POINTER(unblank),
+                     USE_INDATA, DONT_CACHE_INDATA);
+
+EXIT:
+    return;
+}
+
+/** Stop power key to display on latency measurement if not unblanking
+ *
+ * @param mask actions that were executed
+ */
+static void pwrkey_stm_unblank_resolved(uint32_t mask)
+{
+    if( !(mask & pwrkey_mask_from_name("unblank")) )
+        evin_latency_unblank_cancel();
+}
+
 /** Should power key action be ignored predicate
  */
 static bool
@@ -2247,6 +2303,9 @@ pwrkey_datapipes_keypress_cb(gconstpointer const data)
         goto EXIT;
 
     if( ev->value == 1 ) {
+        /* Measure latency from key press to display on */
+        evin_latency_unblank_begin(&ev->time);
+
         /* Detect repeated power key pressing while
          * proximity sensor is covered; assume it means
          * the sensor is stuck and user wants to be able
@@ -2265,6 +2324,8 @@ pwrkey_datapipes_keypress_cb(gconstpointer const data)
 
     pwrkey_stm_rethink_wakelock();
 
+    evin_latency_record(EVIN_LATENCY_POWERKEY, &ev->time);
+
 EXIT:
     return;
 }
@@ -150,6 +150,29 @@ void, mce_log_file, (loglevel_t loglevel, const char *const file,
 	g_free(msg);
 }
 
+/* Log everything, so that filtered out calls do not need to be recorded */
+
+EXTERN_STUB (
+int, mce_log_p_, (const loglevel_t loglevel, const char *const file,
+		  const char *const function))
+{
+	(void)loglevel;
+	(void)file;
+	(void)function;
+
+	return 1;
+}
+
+EXTERN_STUB (
+void, mce_log_record_site, (loglevel_t loglevel, const char *const file,
+			    const char *const function, const char *const fmt))
+{
+	(void)loglevel;
+	(void)file;
+	(void)function;
+	(void)fmt;
+}
+
 /* ------------------------------------------------------------------------- *
  * OTHER
  * ------------------------------------------------------------------------- */
@@ -555,7 +555,7 @@ gboolean, mce_write_number_string_to_file, (output_state_t *output,
 {
 	ck_assert(output->truncate_file == TRUE);
 	ck_assert(output->path != NULL);
-	ck_assert(output->file == NULL);
+	ck_assert(output->fd == 0);
 
 	stub__mce_io_item_t *const items =
 		stub__mce_io_items;
@@ -583,7 +583,7 @@ gboolean, mce_write_number_string_to_file, (output_state_t *output,
 EXTERN_STUB (
 void, mce_close_output, (output_state_t *output))
 {
-	output->file = 0;
+	output->fd = 0;
 }
 
 static gint stub__mce_io_write_count(const gchar *file)
@@ -1266,70 +1266,103 @@ static void stub_setup_checked(void)
 
 	/* Setup all datapipes - copy & paste from mce's main() */
 	setup_datapipe(&system_state_pipe, READ_WRITE, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(MCE_STATE_UNDEF));
 	setup_datapipe(&master_radio_pipe, READ_WRITE, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(0));
 	setup_datapipe(&call_state_pipe, READ_WRITE, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(CALL_STATE_NONE));
 	setup_datapipe(&call_type_pipe, READ_WRITE, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(NORMAL_CALL));
 	setup_datapipe(&alarm_ui_state_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(MCE_ALARM_UI_INVALID_INT32));
 	setup_datapipe(&submode_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(MCE_NORMAL_SUBMODE));
 	setup_datapipe(&display_state_pipe, READ_WRITE, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ON_CHANGE,
 		       0, GINT_TO_POINTER(MCE_DISPLAY_UNDEF));
 	setup_datapipe(&display_state_req_pipe, READ_WRITE, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(MCE_DISPLAY_UNDEF));
 	setup_datapipe(&display_brightness_pipe, READ_WRITE, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(0));
 	setup_datapipe(&led_brightness_pipe, READ_WRITE, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(0));
 	setup_datapipe(&led_pattern_activate_pipe, READ_ONLY, FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, NULL);
 	setup_datapipe(&led_pattern_deactivate_pipe, READ_ONLY, FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, NULL);
 	setup_datapipe(&key_backlight_pipe, READ_WRITE, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(0));
 	setup_datapipe(&keypress_pipe, READ_ONLY, FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       sizeof (struct input_event), NULL);
 	setup_datapipe(&touchscreen_pipe, READ_ONLY, FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       sizeof (struct input_event), NULL);
 	setup_datapipe(&device_inactive_pipe, READ_WRITE, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(FALSE));
 	setup_datapipe(&lockkey_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(0));
 	setup_datapipe(&keyboard_slide_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(0));
 	setup_datapipe(&lid_cover_input_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(0));
 	setup_datapipe(&lens_cover_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(0));
 	setup_datapipe(&proximity_sensor_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(0));
 	setup_datapipe(&tk_lock_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(LOCK_UNDEF));
 	setup_datapipe(&charger_state_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ON_CHANGE,
 		       0, GINT_TO_POINTER(0));
 	setup_datapipe(&battery_status_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ON_CHANGE,
 		       0, GINT_TO_POINTER(BATTERY_STATUS_UNDEF));
 	setup_datapipe(&battery_level_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(100));
 	setup_datapipe(&camera_button_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(CAMERA_BUTTON_UNDEF));
 	setup_datapipe(&inactivity_timeout_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(DEFAULT_INACTIVITY_TIMEOUT));
 	setup_datapipe(&audio_route_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(AUDIO_ROUTE_UNDEF));
 	setup_datapipe(&usb_cable_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ON_CHANGE,
 		       0, GINT_TO_POINTER(0));
 	setup_datapipe(&jack_sense_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(0));
 	setup_datapipe(&power_saving_mode_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ON_CHANGE,
 		       0, GINT_TO_POINTER(0));
 	setup_datapipe(&thermal_state_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ON_CHANGE,
 		       0, GINT_TO_POINTER(THERMAL_STATE_UNDEF));
 	setup_datapipe(&heartbeat_pipe, READ_ONLY, DONT_FREE_CACHE,
+		       EXECUTE_IMMEDIATELY, NOTIFY_ALWAYS,
 		       0, GINT_TO_POINTER(0));
 
 	append_filter_to_datapipe(&display_brightness_pipe,
@@ -0,0 +1,144 @@
+#include <check.h>
+#include <glib.h>
+#include <linux/input.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "common.h"
+
+/* Tested module */
+#include "../../event-input.c"
+
+/* ------------------------------------------------------------------------- *
+ * HELPERS
+ * ------------------------------------------------------------------------- */
+
+/** Maximum event code for given event type */
+static int ut_evmask_code_max(int etype)
+{
+	switch( etype ) {
+	case EV_SYN: return SYN_MAX;
+	case EV_KEY: return KEY_MAX;
+	case EV_REL: return REL_MAX;
+	case EV_ABS: return ABS_MAX;
+	case EV_MSC: return MSC_MAX;
+	case EV_SW:  return SW_MAX;
+	case EV_LED: return LED_MAX;
+	case EV_SND: return SND_MAX;
+	case EV_REP: return REP_MAX;
+	case EV_FF:  return FF_MAX;
+	default:     return 0;
+	}
+}
+
+/** Events that must pass the reduced touch screen mask */
+static bool ut_evmask_reduced_expected(int etype, int ecode)
+{
+	switch( etype ) {
+	case EV_SYN:
+		return true;
+	case EV_KEY:
+		return ecode == BTN_TOUCH || ecode == KEY_POWER;
+	case EV_MSC:
+		return ecode == MSC_GESTURE;
+	default:
+		return false;
+	}
+}
+
+/* ------------------------------------------------------------------------- *
+ * TESTS
+ * ------------------------------------------------------------------------- */
+
+START_TEST (ut_check_evmask_full_mode)
+{
+	/* Without reduction every device gets every event */
+	static const evin_evdevtype_t types[] = {
+		EVDEV_TOUCH, EVDEV_INPUT, EVDEV_KEYBOARD,
+		EVDEV_DBLTAP, EVDEV_ACTIVITY,
+	};
+
+	for( size_t i = 0; i < G_N_ELEMENTS(types); ++i ) {
+		for( int etype = 0; etype < EV_CNT; ++etype ) {
+			int max = ut_evmask_code_max(etype);
+			for( int ecode = 0; ecode <= max; ++ecode ) {
+				ck_assert_msg(evin_evmask_wanted(types[i], false,
+								 etype, ecode),
+					      "type=%d etype=%d ecode=%d",
+					      types[i], etype, ecode);
+			}
+		}
+	}
+}
+END_TEST
+
+START_TEST (ut_check_evmask_reduced_touch)
+{
+	for( int etype = 0; etype < EV_CNT; ++etype ) {
+		int max = ut_evmask_code_max(etype);
+		for( int ecode = 0; ecode <= max; ++ecode ) {
+			ck_assert_msg(evin_evmask_wanted(EVDEV_TOUCH, true,
+							 etype, ecode) ==
+				      ut_evmask_reduced_expected(etype, ecode),
+				      "etype=%d ecode=%d", etype, ecode);
+		}
+	}
+
+	/* Spell out the motion events that must not wake up mce */
+	ck_assert(!evin_evmask_wanted(EVDEV_TOUCH, true, EV_ABS, ABS_X));
+	ck_assert(!evin_evmask_wanted(EVDEV_TOUCH, true, EV_ABS, ABS_Y));
+	ck_assert(!evin_evmask_wanted(EVDEV_TOUCH, true, EV_ABS,
+				      ABS_MT_TRACKING_ID));
+	ck_assert(!evin_evmask_wanted(EVDEV_TOUCH, true, EV_ABS,
+				      ABS_MT_POSITION_X));
+	ck_assert(!evin_evmask_wanted(EVDEV_TOUCH, true, EV_ABS,
+				      ABS_MT_POSITION_Y));
+	ck_assert(!evin_evmask_wanted(EVDEV_TOUCH, true, EV_ABS,
+				      ABS_MT_PRESSURE));
+	ck_assert(!evin_evmask_wanted(EVDEV_TOUCH, true, EV_REL, REL_X));
+}
+END_TEST
+
+START_TEST (ut_check_evmask_reduced_other)
+{
+	/* Reduction applies to touch screens only */
+	static const evin_evdevtype_t types[] = {
+		EVDEV_INPUT, EVDEV_KEYBOARD, EVDEV_DBLTAP, EVDEV_ACTIVITY,
+	};
+
+	for( size_t i = 0; i < G_N_ELEMENTS(types); ++i ) {
+		ck_assert(evin_evmask_wanted(types[i], true, EV_ABS, ABS_X));
+		ck_assert(evin_evmask_wanted(types[i], true, EV_KEY, KEY_A));
+		ck_assert(evin_evmask_wanted(types[i], true, EV_MSC, MSC_SCAN));
+		ck_assert(evin_evmask_wanted(types[i], true, EV_SW,
+					     SW_KEYPAD_SLIDE));
+	}
+}
+END_TEST
+
+static Suite *ut_event_input_evmask_suite (void)
+{
+	Suite *s = suite_create ("ut_event_input_evmask");
+
+	TCase *tc_core = tcase_create ("core");
+	tcase_add_test (tc_core, ut_check_evmask_full_mode);
+	tcase_add_test (tc_core, ut_check_evmask_reduced_touch);
+	tcase_add_test (tc_core, ut_check_evmask_reduced_other);
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
+
+int main(int argc, char **argv)
+{
+	(void)argc;
+	(void)argv;
+
+	int number_failed;
+	Suite *s = ut_event_input_evmask_suite ();
+	SRunner *sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
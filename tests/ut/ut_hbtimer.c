@@ -0,0 +1,278 @@
+#include <check.h>
+#include <glib.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+
+/* Tested module */
+#include "../../mce-hbtimer.c"
+
+/* ------------------------------------------------------------------------- *
+ * EXTERN STUBS
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Note that libiphb is linked instead of providing stubs; it is used
+ * only when dsme is available, which never happens during the tests.
+ */
+
+/*
+ * mce-conf.c stubs {{{1
+ */
+
+EXTERN_STUB (
+gchar *, mce_conf_get_string, (const gchar *group, const gchar *key,
+			       const gchar *defaultval))
+{
+	(void)defaultval;
+
+	ck_assert_str_eq(group, MCE_CONF_HBTIMER_GROUP);
+	ck_assert_str_eq(key, MCE_CONF_HBTIMER_TIMERFD_CLOCK);
+
+	/* Alarm timers need privileges, use plain boottime clock */
+	return g_strdup("boottime");
+}
+
+/*
+ * libwakelock.c stubs {{{1
+ */
+
+static int  stub__wakelock_dispatch_count = 0;
+static int  stub__wakelock_wakeup_count   = 0;
+static bool stub__wakelock_wakeup_seen    = false;
+
+static int *stub__wakelock_counter(const char *name)
+{
+	if( !strcmp(name, "mce_hbtimer_dispatch") )
+		return &stub__wakelock_dispatch_count;
+
+	if( !strcmp(name, "mce_hbtimer_wakeup") )
+		return &stub__wakelock_wakeup_count;
+
+	ck_abort_msg("Unexpected wakelock: '%s'", name);
+	return 0;
+}
+
+EXTERN_STUB (
+void, wakelock_lock, (const char *name, long long ns))
+{
+	(void)ns;
+
+	int *counter = stub__wakelock_counter(name);
+	++*counter;
+
+	if( counter == &stub__wakelock_wakeup_count )
+		stub__wakelock_wakeup_seen = true;
+}
+
+EXTERN_STUB (
+void, wakelock_unlock, (const char *name))
+{
+	int *counter = stub__wakelock_counter(name);
+	ck_assert_int_gt(*counter, 0);
+	--*counter;
+}
+
+/* ------------------------------------------------------------------------- *
+ * HELPERS
+ * ------------------------------------------------------------------------- */
+
+static gboolean ut_notify_cb(gpointer aptr)
+{
+	(void)aptr;
+	return FALSE;
+}
+
+/** Milliseconds until programmed timerfd expiry, or -1 if disarmed */
+static int64_t ut_timerfd_remaining(void)
+{
+	struct itimerspec its;
+
+	ck_assert(mht_timerfd_is_open());
+	ck_assert_int_eq(timerfd_gettime(mht_timerfd_fd, &its), 0);
+
+	if( its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0 )
+		return -1;
+
+	return its.it_value.tv_sec * 1000 + its.it_value.tv_nsec / 1000000;
+}
+
+static void ut_setup(void)
+{
+	stub__wakelock_dispatch_count = 0;
+	stub__wakelock_wakeup_count   = 0;
+	stub__wakelock_wakeup_seen    = false;
+
+	/* Skip datapipe bindings, only timerfd wakeups are tested */
+	mht_timerfd_open();
+	mce_hbtimer_initialized = true;
+
+	ck_assert(mht_timerfd_is_open());
+}
+
+static void ut_teardown(void)
+{
+	mce_hbtimer_initialized = false;
+	mht_timerfd_close();
+}
+
+/* ------------------------------------------------------------------------- *
+ * TESTS
+ * ------------------------------------------------------------------------- */
+
+START_TEST (ut_check_hbtimer_arm)
+{
+	mce_hbtimer_t *timer = mce_hbtimer_create("arm", 1000, ut_notify_cb, 0);
+
+	ck_assert_int_eq(mht_timerfd_wakeup_tick, NO_TICK);
+	ck_assert_int_eq(ut_timerfd_remaining(), -1);
+
+	mce_hbtimer_start(timer);
+
+	ck_assert(mce_hbtimer_is_active(timer));
+	ck_assert_int_eq(mht_timerfd_wakeup_tick, timer->hbt_trigger);
+
+	int64_t remaining = ut_timerfd_remaining();
+	ck_assert_int_ge(remaining, 0);
+	ck_assert_int_le(remaining, 1000);
+
+	mce_hbtimer_delete(timer);
+}
+END_TEST
+
+START_TEST (ut_check_hbtimer_rearm)
+{
+	mce_hbtimer_t *slow = mce_hbtimer_create("slow", 5000, ut_notify_cb, 0);
+	mce_hbtimer_t *fast = mce_hbtimer_create("fast", 1000, ut_notify_cb, 0);
+
+	mce_hbtimer_start(slow);
+	ck_assert_int_eq(mht_timerfd_wakeup_tick, slow->hbt_trigger);
+	ck_assert_int_gt(ut_timerfd_remaining(), 1000);
+
+	/* Earlier timer re-arms the timerfd */
+	mce_hbtimer_start(fast);
+	ck_assert_int_eq(mht_timerfd_wakeup_tick, fast->hbt_trigger);
+	ck_assert_int_le(ut_timerfd_remaining(), 1000);
+
+	/* Stopping it re-arms back to the later one */
+	mce_hbtimer_stop(fast);
+	ck_assert_int_eq(mht_timerfd_wakeup_tick, slow->hbt_trigger);
+	ck_assert_int_gt(ut_timerfd_remaining(), 1000);
+
+	/* Restarting with shorter period re-arms too */
+	mce_hbtimer_set_period(slow, 500);
+	mce_hbtimer_start(slow);
+	ck_assert_int_eq(mht_timerfd_wakeup_tick, slow->hbt_trigger);
+	ck_assert_int_le(ut_timerfd_remaining(), 500);
+
+	mce_hbtimer_delete(fast);
+	mce_hbtimer_delete(slow);
+}
+END_TEST
+
+START_TEST (ut_check_hbtimer_cancel)
+{
+	mce_hbtimer_t *timer = mce_hbtimer_create("cancel", 1000,
+						  ut_notify_cb, 0);
+
+	mce_hbtimer_start(timer);
+	ck_assert_int_ge(ut_timerfd_remaining(), 0);
+
+	mce_hbtimer_stop(timer);
+	ck_assert(!mce_hbtimer_is_active(timer));
+	ck_assert_int_eq(mht_timerfd_wakeup_tick, NO_TICK);
+	ck_assert_int_eq(ut_timerfd_remaining(), -1);
+
+	/* Deleting an active timer disarms as well */
+	mce_hbtimer_start(timer);
+	ck_assert_int_ge(ut_timerfd_remaining(), 0);
+
+	mce_hbtimer_delete(timer);
+	ck_assert_int_eq(mht_timerfd_wakeup_tick, NO_TICK);
+	ck_assert_int_eq(ut_timerfd_remaining(), -1);
+}
+END_TEST
+
+static GMainLoop *ut_dispatch_loop = 0;
+static int        ut_dispatch_count = 0;
+
+static gboolean ut_dispatch_notify_cb(gpointer aptr)
+{
+	(void)aptr;
+
+	++ut_dispatch_count;
+
+	/* Suspend must be blocked while notifying */
+	ck_assert_int_gt(stub__wakelock_wakeup_count, 0);
+	ck_assert_int_gt(stub__wakelock_dispatch_count, 0);
+
+	g_main_loop_quit(ut_dispatch_loop);
+	return FALSE;
+}
+
+static gboolean ut_dispatch_timeout_cb(gpointer aptr)
+{
+	(void)aptr;
+	g_main_loop_quit(ut_dispatch_loop);
+	return FALSE;
+}
+
+START_TEST (ut_check_hbtimer_dispatch)
+{
+	mce_hbtimer_t *timer = mce_hbtimer_create("dispatch", 50,
+						  ut_dispatch_notify_cb, 0);
+
+	ut_dispatch_loop  = g_main_loop_new(0, FALSE);
+	ut_dispatch_count = 0;
+
+	guint timeout_id = g_timeout_add(2000, ut_dispatch_timeout_cb, 0);
+
+	mce_hbtimer_start(timer);
+	g_main_loop_run(ut_dispatch_loop);
+
+	ck_assert_int_eq(ut_dispatch_count, 1);
+	ck_assert(stub__wakelock_wakeup_seen);
+
+	/* Wakelocks released and timerfd left disarmed */
+	ck_assert_int_eq(stub__wakelock_wakeup_count, 0);
+	ck_assert_int_eq(stub__wakelock_dispatch_count, 0);
+	ck_assert(!mce_hbtimer_is_active(timer));
+	ck_assert_int_eq(ut_timerfd_remaining(), -1);
+
+	g_source_remove(timeout_id);
+	g_main_loop_unref(ut_dispatch_loop), ut_dispatch_loop = 0;
+
+	mce_hbtimer_delete(timer);
+}
+END_TEST
+
+static Suite *ut_hbtimer_suite (void)
+{
+	Suite *s = suite_create ("ut_hbtimer");
+
+	TCase *tc_core = tcase_create ("core");
+	tcase_add_checked_fixture (tc_core, ut_setup, ut_teardown);
+	tcase_add_test (tc_core, ut_check_hbtimer_arm);
+	tcase_add_test (tc_core, ut_check_hbtimer_rearm);
+	tcase_add_test (tc_core, ut_check_hbtimer_cancel);
+	tcase_add_test (tc_core, ut_check_hbtimer_dispatch);
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
+
+int main(int argc, char **argv)
+{
+	(void)argc;
+	(void)argv;
+
+	int number_failed;
+	Suite *s = ut_hbtimer_suite ();
+	SRunner *sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
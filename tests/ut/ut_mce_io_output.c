@@ -0,0 +1,195 @@
+#include <check.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+
+/* Tested module */
+#include "../../mce-io.c"
+
+/* ------------------------------------------------------------------------- *
+ * EXTERN STUBS
+ * ------------------------------------------------------------------------- */
+
+/*
+ * mce.c stubs {{{1
+ */
+
+EXTERN_DUMMY_STUB (
+void, mce_abort, (void));
+
+/* ------------------------------------------------------------------------- *
+ * HELPERS
+ * ------------------------------------------------------------------------- */
+
+static gchar *ut_output_path = 0;
+
+/** Overwrite output file behind the back of the tested module
+ *
+ * The file is rewritten in place, so that the file descriptor
+ * held by the tested module keeps referring to it.
+ */
+static void ut_output_tamper(const char *text)
+{
+	FILE *file = fopen(ut_output_path, "w");
+
+	ck_assert(file != 0);
+	ck_assert(fputs(text, file) >= 0);
+	ck_assert_int_eq(fclose(file), 0);
+}
+
+/** Check output file content */
+static void ut_output_check(const char *expected)
+{
+	gchar *data = 0;
+
+	ck_assert(g_file_get_contents(ut_output_path, &data, 0, 0));
+	ck_assert_str_eq(data, expected);
+	g_free(data);
+}
+
+static void ut_setup(void)
+{
+	ut_output_path = g_build_filename(g_get_tmp_dir(),
+					  "ut_mce_io_output.XXXXXX", NULL);
+
+	int fd = g_mkstemp(ut_output_path);
+	ck_assert_int_ne(fd, -1);
+	close(fd);
+}
+
+static void ut_teardown(void)
+{
+	g_unlink(ut_output_path);
+	g_free(ut_output_path), ut_output_path = 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * TESTS
+ * ------------------------------------------------------------------------- */
+
+START_TEST (ut_check_output_skip_unchanged)
+{
+	output_state_t output = {
+		.context       = "ut_output",
+		.truncate_file = TRUE,
+		.close_on_exit = FALSE,
+		.path          = ut_output_path,
+	};
+
+	ck_assert(mce_write_number_string_to_file(&output, 5));
+	ut_output_check("5");
+	ck_assert(output.cached_valid);
+
+	/* Writing the same value again is skipped */
+	ut_output_tamper("9");
+	ck_assert(mce_write_number_string_to_file(&output, 5));
+	ut_output_check("9");
+
+	/* Different value is written and truncated */
+	ck_assert(mce_write_number_string_to_file(&output, 123));
+	ut_output_check("123");
+	ck_assert(mce_write_number_string_to_file(&output, 7));
+	ut_output_check("7");
+
+	mce_close_output(&output);
+}
+END_TEST
+
+START_TEST (ut_check_output_invalidate)
+{
+	output_state_t output = {
+		.context       = "ut_output",
+		.truncate_file = TRUE,
+		.close_on_exit = FALSE,
+		.path          = ut_output_path,
+	};
+
+	ck_assert(mce_write_number_string_to_file(&output, 5));
+	ut_output_check("5");
+
+	/* Closing the output invalidates cached value */
+	mce_close_output(&output);
+	ck_assert(!output.cached_valid);
+
+	ut_output_tamper("9");
+	ck_assert(mce_write_number_string_to_file(&output, 5));
+	ut_output_check("5");
+
+	mce_close_output(&output);
+}
+END_TEST
+
+START_TEST (ut_check_output_uncached)
+{
+	output_state_t output = {
+		.context       = "ut_output",
+		.truncate_file = TRUE,
+		.close_on_exit = FALSE,
+		.uncached      = TRUE,
+		.path          = ut_output_path,
+	};
+
+	ck_assert(mce_write_number_string_to_file(&output, 0));
+	ut_output_check("0");
+	ck_assert(!output.cached_valid);
+
+	/* Value changed by e.g. led engine must get rewritten */
+	ut_output_tamper("255");
+	ck_assert(mce_write_number_string_to_file(&output, 0));
+	ut_output_check("0");
+
+	mce_close_output(&output);
+}
+END_TEST
+
+START_TEST (ut_check_output_close_on_exit)
+{
+	output_state_t output = {
+		.context       = "ut_output",
+		.truncate_file = TRUE,
+		.close_on_exit = TRUE,
+		.path          = ut_output_path,
+	};
+
+	ck_assert(mce_write_number_string_to_file(&output, 5));
+	ck_assert_int_eq(output.fd, 0);
+	ck_assert(!output.cached_valid);
+
+	ut_output_tamper("9");
+	ck_assert(mce_write_number_string_to_file(&output, 5));
+	ut_output_check("5");
+}
+END_TEST
+
+static Suite *ut_mce_io_output_suite (void)
+{
+	Suite *s = suite_create ("ut_mce_io_output");
+
+	TCase *tc_core = tcase_create ("core");
+	tcase_add_checked_fixture (tc_core, ut_setup, ut_teardown);
+	tcase_add_test (tc_core, ut_check_output_skip_unchanged);
+	tcase_add_test (tc_core, ut_check_output_invalidate);
+	tcase_add_test (tc_core, ut_check_output_uncached);
+	tcase_add_test (tc_core, ut_check_output_close_on_exit);
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
+
+int main(int argc, char **argv)
+{
+	(void)argc;
+	(void)argv;
+
+	int number_failed;
+	Suite *s = ut_mce_io_output_suite ();
+	SRunner *sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,118 @@
+#include <check.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Note: common.h is not used as it replaces mce_log_file() */
+
+/* Tested module */
+#include "../../mce-log.c"
+
+/* ------------------------------------------------------------------------- *
+ * HELPERS
+ * ------------------------------------------------------------------------- */
+
+static int ut_side_effects = 0;
+
+/** Stand-in for arguments that are expensive or have side effects */
+static const char *ut_side_effect(void)
+{
+	++ut_side_effects;
+	return "evaluated";
+}
+
+/** Dump flight recorder and return the contents */
+static gchar *ut_dump_recorder(void)
+{
+	gchar *path = g_build_filename(g_get_tmp_dir(),
+				       "ut_mce_log_recorder.XXXXXX", NULL);
+	gchar *data = 0;
+
+	int fd = g_mkstemp(path);
+	ck_assert_int_ne(fd, -1);
+	close(fd);
+
+	ck_assert_str_eq(mce_log_dump_recorder(path), path);
+	ck_assert(g_file_get_contents(path, &data, 0, 0));
+
+	g_unlink(path);
+	g_free(path);
+
+	return data;
+}
+
+/* ------------------------------------------------------------------------- *
+ * TESTS
+ * ------------------------------------------------------------------------- */
+
+START_TEST (ut_check_recorder_filtered)
+{
+	mce_log_set_verbosity(LL_WARN);
+	ut_side_effects = 0;
+
+	mce_log(LL_DEBUG, "ut debug %s", ut_side_effect());
+	mce_log(LL_INFO, "ut info %s", ut_side_effect());
+	mce_log(LL_NOTICE, "ut notice %s", ut_side_effect());
+
+	/* Filtered out messages must not evaluate arguments */
+	ck_assert_int_eq(ut_side_effects, 0);
+
+	gchar *data = ut_dump_recorder();
+
+	/* ... but are still recorded, up to debug level */
+	ck_assert(strstr(data, "D: ") != 0);
+	ck_assert(strstr(data, "ut debug %s [args not recorded]") != 0);
+	ck_assert(strstr(data, "ut info %s [args not recorded]") != 0);
+	ck_assert(strstr(data, "ut notice %s [args not recorded]") != 0);
+	ck_assert(strstr(data, "evaluated") == 0);
+
+	g_free(data);
+}
+END_TEST
+
+START_TEST (ut_check_recorder_logged)
+{
+	mce_log_set_verbosity(LL_DEBUG);
+	ut_side_effects = 0;
+
+	mce_log(LL_DEBUG, "ut logged %s %d", ut_side_effect(), 42);
+
+	ck_assert_int_eq(ut_side_effects, 1);
+
+	gchar *data = ut_dump_recorder();
+
+	/* Logged messages are recorded with arguments */
+	ck_assert(strstr(data, "ut logged evaluated 42") != 0);
+
+	g_free(data);
+}
+END_TEST
+
+static Suite *ut_mce_log_recorder_suite (void)
+{
+	Suite *s = suite_create ("ut_mce_log_recorder");
+
+	TCase *tc_core = tcase_create ("core");
+	tcase_add_test (tc_core, ut_check_recorder_filtered);
+	tcase_add_test (tc_core, ut_check_recorder_logged);
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
+
+int main(int argc, char **argv)
+{
+	(void)argc;
+	(void)argv;
+
+	int number_failed;
+	Suite *s = ut_mce_log_recorder_suite ();
+	SRunner *sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
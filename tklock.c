@@ -988,6 +988,20 @@ static void tklock_datapipe_proximity_sensor_cb(gconstpointer data)
     /* update lpm ui proximity history using raw data */
     tklock_lpmui_update_history(proximity_state_actual);
 
+    /* During calls uncovering is likely to unblank the display;
+     * let display plugin resume frame buffer while uncover is
+     * being delayed */
+    switch( call_state ) {
+    case CALL_STATE_RINGING:
+    case CALL_STATE_ACTIVE:
+        execute_datapipe(&display_preresume_pipe,
+                         GINT_TO_POINTER(proximity_state_actual == COVER_OPEN),
+                         USE_INDATA, DONT_CACHE_INDATA);
+        break;
+    default:
+        break;
+    }
+
     if( proximity_state_actual == COVER_OPEN ) {
         tklock_datapipe_proximity_uncover_schedule();
     }
@@ -1547,6 +1561,12 @@ static void tklock_datapipe_touchscreen_cb(gconstpointer const data)
     case DBLTAP_ACTION_UNBLANK:  // unblank
     case DBLTAP_ACTION_TKUNLOCK: // unblank + unlock
         mce_log(LL_DEBUG, "double tap -> display on");
+        /* Get frame buffer resume going before the user activity
+         * and display state request processing */
+        execute_datapipe(&display_preresume_pipe,
+                         GINT_TO_POINTER(TRUE),
+                         USE_INDATA, DONT_CACHE_INDATA);
+
         /* Double tap event that is about to be used for unblanking
          * the display counts as non-syntetized user activity */
         execute_datapipe_output_triggers(&user_activity_pipe,
@@ -2711,6 +2731,9 @@ tklock_autolock_init(void)
     tklock_autolock_timer = mce_hbtimer_create("autolock-timer",
                                                tklock_autolock_delay,
                                                tklock_autolock_cb, 0);
+
+    /* Autolocking does not need sub-second accuracy */
+    mce_hbtimer_set_slack(tklock_autolock_timer, 500);
 }
 
 static void
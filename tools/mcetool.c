@@ -55,6 +55,33 @@
 /** Define set config DBUS method */
 #define MCE_DBUS_SET_CONFIG_REQ                 "set_config"
 
+/** Define get datapipe statistics DBUS method */
+#define MCE_DATAPIPE_STATS_GET                  "get_datapipe_stats"
+
+/** Define reset datapipe statistics DBUS method */
+#define MCE_DATAPIPE_STATS_RESET                "reset_datapipe_stats"
+
+/** Define enable datapipe statistics DBUS method */
+#define MCE_DATAPIPE_STATS_ENABLE               "set_datapipe_stats_enabled"
+
+/** Define get input latency DBUS method */
+#define MCE_INPUT_LATENCY_GET                   "get_input_latency"
+
+/** Define reset input latency DBUS method */
+#define MCE_INPUT_LATENCY_RESET                 "reset_input_latency"
+
+/** Define dump flight recorder DBUS method */
+#define MCE_FLIGHT_RECORDER_DUMP                "dump_flight_recorder"
+
+/** Define get display state machine statistics DBUS method */
+#define MCE_DISPLAY_STM_STATS_GET               "get_display_stm_stats"
+
+/** Define reset display state machine statistics DBUS method */
+#define MCE_DISPLAY_STM_STATS_RESET             "reset_display_stm_stats"
+
+/** Define bulk state query DBUS method */
+#define MCE_STATE_QUERY_GET                     "get_states"
+
 /** Default padding for left column of status reports */
 #define PAD1 "36"
 
@@ -531,6 +558,46 @@ static gboolean dbushelper_read_int(DBusMessageIter *iter, gint *value)
         return *value = data, TRUE;
 }
 
+/** Helper for parsing uint64 value from D-Bus message iterator
+ *
+ * @param iter D-Bus message iterator
+ * @param value Where to store the value (not modified on failure)
+ *
+ * @return TRUE if value could be read, FALSE on failure
+ */
+static gboolean dbushelper_read_uint64(DBusMessageIter *iter, guint64 *value)
+{
+        dbus_uint64_t data = 0;
+
+        if( !dbushelper_require_type(iter, DBUS_TYPE_UINT64) )
+                return FALSE;
+
+        dbus_message_iter_get_basic(iter, &data);
+        dbus_message_iter_next(iter);
+
+        return *value = data, TRUE;
+}
+
+/** Helper for parsing int64 value from D-Bus message iterator
+ *
+ * @param iter D-Bus message iterator
+ * @param value Where to store the value (not modified on failure)
+ *
+ * @return TRUE if value could be read, FALSE on failure
+ */
+static gboolean dbushelper_read_int64(DBusMessageIter *iter, gint64 *value)
+{
+        dbus_int64_t data = 0;
+
+        if( !dbushelper_require_type(iter, DBUS_TYPE_INT64) )
+                return FALSE;
+
+        dbus_message_iter_get_basic(iter, &data);
+        dbus_message_iter_next(iter);
+
+        return *value = data, TRUE;
+}
+
 /** Helper for parsing string value from D-Bus message iterator
  *
  * @param iter D-Bus message iterator
@@ -4442,6 +4509,508 @@ static void xmce_get_touch_unblock_delay(void)
         printf("%-"PAD1"s %s (milliseconds)\n", "Touch unblock delay:", txt);
 }
 
+/* ------------------------------------------------------------------------- *
+ * histogram statistics
+ * ------------------------------------------------------------------------- */
+
+/** Read and print histogram bucket counts
+ *
+ * @param iter D-Bus message iterator pointing at an array of uint64 values
+ *
+ * @return true on success, false on failure
+ */
+static bool xmce_print_hist_buckets(DBusMessageIter *iter)
+{
+        DBusMessageIter vec;
+        guint64         bin = 0;
+        int             n   = 0;
+
+        if( !dbushelper_read_array(iter, &vec) )
+                return false;
+
+        while( dbushelper_read_uint64(&vec, &bin) )
+                printf("%s%" G_GUINT64_FORMAT, n++ ? "/" : " ", bin);
+        printf("\n");
+
+        return true;
+}
+
+/** Read and print an array of histogram statistics
+ *
+ * The array items are (stttat) structs holding name, sample count,
+ * sum of samples, largest sample and bucket counts. Samples are
+ * expected to be in microseconds.
+ *
+ * @param iter   D-Bus message iterator pointing at the array
+ * @param title  header for the name column
+ * @param width  width of the name column
+ * @param legend header for the bucket counts
+ * @param names  array for collecting histogram names, or NULL
+ *
+ * @return true on success, false on failure
+ */
+static bool xmce_print_hist_array(DBusMessageIter *iter, const char *title,
+                                  int width, const char *legend,
+                                  GPtrArray *names)
+{
+        bool            ack = false;
+        DBusMessageIter arr, sub;
+
+        if( !dbushelper_require_array_type(iter, DBUS_TYPE_STRUCT) )
+                goto EXIT;
+
+        if( !dbushelper_read_array(iter, &arr) )
+                goto EXIT;
+
+        printf("%-*s %10s %10s %10s  %s\n",
+               width, title, "COUNT", "AVG_MS", "MAX_MS", legend);
+
+        while( dbus_message_iter_get_arg_type(&arr) == DBUS_TYPE_STRUCT ) {
+                gchar   *name  = 0;
+                guint64  count = 0;
+                guint64  total = 0;
+                guint64  worst = 0;
+
+                dbus_message_iter_recurse(&arr, &sub);
+                dbus_message_iter_next(&arr);
+
+                if( !dbushelper_read_string(&sub, &name) ||
+                    !dbushelper_read_uint64(&sub, &count) ||
+                    !dbushelper_read_uint64(&sub, &total) ||
+                    !dbushelper_read_uint64(&sub, &worst) ) {
+                        g_free(name);
+                        goto EXIT;
+                }
+
+                printf("%-*s %10" G_GUINT64_FORMAT " %10.3f %10.3f ",
+                       width, name, count,
+                       count ? total * 1e-3 / count : 0.0,
+                       worst * 1e-3);
+
+                if( !xmce_print_hist_buckets(&sub) ) {
+                        printf("\n");
+                        g_free(name);
+                        goto EXIT;
+                }
+
+                if( names )
+                        g_ptr_array_add(names, name), name = 0;
+                g_free(name);
+        }
+
+        ack = true;
+
+EXIT:
+        return ack;
+}
+
+/* ------------------------------------------------------------------------- *
+ * datapipe statistics
+ * ------------------------------------------------------------------------- */
+
+/** Helper for formatting nanosecond values as milliseconds
+ *
+ * @param buff buffer for constructing the text
+ * @param size size of the buffer
+ * @param ns   time in nanoseconds
+ *
+ * @return buff
+ */
+static const char *xmce_ns_repr(char *buff, size_t size, guint64 ns)
+{
+        snprintf(buff, size, "%.3f", ns * 1e-6);
+        return buff;
+}
+
+/** Get and print datapipe execution statistics
+ */
+static bool xmce_get_datapipe_stats(const char *args)
+{
+        (void)args;
+
+        DBusMessage     *rsp = NULL;
+        DBusMessageIter  body, arr, sub;
+        char             t1[32], t2[32], t3[32], t4[32];
+
+        if( !xmce_ipc_message_reply(MCE_DATAPIPE_STATS_GET, &rsp, DBUS_TYPE_INVALID) )
+                goto EXIT;
+
+        if( !dbushelper_init_read_iterator(rsp, &body) )
+                goto EXIT;
+
+        if( !dbushelper_require_array_type(&body, DBUS_TYPE_STRUCT) )
+                goto EXIT;
+
+        if( !dbushelper_read_array(&body, &arr) )
+                goto EXIT;
+
+        printf("%-28s %10s %10s %10s %10s %10s  %s\n",
+               "DATAPIPE", "COUNT", "FILTER_MS", "INPUT_MS",
+               "OUTPUT_MS", "WORST_MS", "WORST_CALLBACK");
+
+        while( dbus_message_iter_get_arg_type(&arr) == DBUS_TYPE_STRUCT ) {
+                gchar   *name  = 0;
+                gchar   *worst = 0;
+                guint64  count = 0;
+                guint64  filter_time = 0, filter_max = 0;
+                guint64  input_time  = 0, input_max  = 0;
+                guint64  output_time = 0, output_max = 0;
+                guint64  worst_time  = 0;
+
+                dbus_message_iter_recurse(&arr, &sub);
+                dbus_message_iter_next(&arr);
+
+                if( !dbushelper_read_string(&sub, &name) ||
+                    !dbushelper_read_uint64(&sub, &count) ||
+                    !dbushelper_read_uint64(&sub, &filter_time) ||
+                    !dbushelper_read_uint64(&sub, &filter_max) ||
+                    !dbushelper_read_uint64(&sub, &input_time) ||
+                    !dbushelper_read_uint64(&sub, &input_max) ||
+                    !dbushelper_read_uint64(&sub, &output_time) ||
+                    !dbushelper_read_uint64(&sub, &output_max) ||
+                    !dbushelper_read_string(&sub, &worst) ||
+                    !dbushelper_read_uint64(&sub, &worst_time) ) {
+                        g_free(name);
+                        g_free(worst);
+                        goto EXIT;
+                }
+
+                printf("%-28s %10" G_GUINT64_FORMAT " %10s %10s %10s %10s  %s\n",
+                       name, count,
+                       xmce_ns_repr(t1, sizeof t1, filter_time),
+                       xmce_ns_repr(t2, sizeof t2, input_time),
+                       xmce_ns_repr(t3, sizeof t3, output_time),
+                       xmce_ns_repr(t4, sizeof t4, worst_time),
+                       worst);
+                printf("%-28s max: filter=%s input=%s output=%s;"
+                       " <10us/<100us/<1ms/<10ms/more:",
+                       "",
+                       xmce_ns_repr(t1, sizeof t1, filter_max),
+                       xmce_ns_repr(t2, sizeof t2, input_max),
+                       xmce_ns_repr(t3, sizeof t3, output_max));
+                if( !xmce_print_hist_buckets(&sub) )
+                        printf("\n");
+
+                g_free(name);
+                g_free(worst);
+        }
+
+EXIT:
+        if( rsp ) dbus_message_unref(rsp);
+
+        return true;
+}
+
+/** Reset datapipe execution statistics
+ */
+static bool xmce_reset_datapipe_stats(const char *args)
+{
+        (void)args;
+
+        xmce_ipc_no_reply(MCE_DATAPIPE_STATS_RESET, DBUS_TYPE_INVALID);
+        return true;
+}
+
+/** Enable / disable collecting datapipe execution statistics
+ */
+static bool xmce_set_datapipe_stats(const char *args)
+{
+        debugf("%s(%s)\n", __FUNCTION__, args);
+        dbus_bool_t val = xmce_parse_enabled(args);
+
+        xmce_ipc_no_reply(MCE_DATAPIPE_STATS_ENABLE,
+                          DBUS_TYPE_BOOLEAN, &val,
+                          DBUS_TYPE_INVALID);
+        return true;
+}
+
+/* ------------------------------------------------------------------------- *
+ * input latency
+ * ------------------------------------------------------------------------- */
+
+/** Get and print input latency histograms
+ */
+static bool xmce_get_input_latency(const char *args)
+{
+        (void)args;
+
+        DBusMessage     *rsp = NULL;
+        DBusMessageIter  body;
+
+        if( !xmce_ipc_message_reply(MCE_INPUT_LATENCY_GET, &rsp, DBUS_TYPE_INVALID) )
+                goto EXIT;
+
+        if( !dbushelper_init_read_iterator(rsp, &body) )
+                goto EXIT;
+
+        xmce_print_hist_array(&body, "PATH", 12,
+                              "<1/<2/<5/<10/<20/<50/<100/<200/<500/more ms",
+                              NULL);
+
+EXIT:
+        if( rsp ) dbus_message_unref(rsp);
+
+        return true;
+}
+
+/** Reset input latency histograms
+ */
+static bool xmce_reset_input_latency(const char *args)
+{
+        (void)args;
+
+        xmce_ipc_no_reply(MCE_INPUT_LATENCY_RESET, DBUS_TYPE_INVALID);
+        return true;
+}
+
+/* ------------------------------------------------------------------------- *
+ * flight recorder
+ * ------------------------------------------------------------------------- */
+
+/** Make mce dump recent log events to a file
+ */
+static bool xmce_dump_flight_recorder(const char *args)
+{
+        (void)args;
+
+        char *str = 0;
+
+        xmce_ipc_string_reply(MCE_FLIGHT_RECORDER_DUMP, &str, DBUS_TYPE_INVALID);
+
+        if( !str || !*str )
+                printf("%s\n", "flight recorder dump failed");
+        else
+                printf("flight recorder dumped to: %s\n", str);
+
+        free(str);
+        return true;
+}
+
+/* ------------------------------------------------------------------------- *
+ * display state machine statistics
+ * ------------------------------------------------------------------------- */
+
+/** Maximum number of phases mcetool can show per display state transition */
+#define DISPLAY_STM_PHASES_MAX 16
+
+/** How many of the slowest recent display state transitions to show */
+#define DISPLAY_STM_SLOWEST_MAX 10
+
+/** Timing details of one display state transition */
+typedef struct
+{
+        gchar   *from;
+        gchar   *to;
+        gint64   started;
+        guint64  phase[DISPLAY_STM_PHASES_MAX];
+} display_stm_transition_t;
+
+/** Sort display state transitions to slowest first order
+ */
+static gint xmce_display_stm_transition_cmp(gconstpointer a, gconstpointer b)
+{
+        const display_stm_transition_t *ta = *(display_stm_transition_t **)a;
+        const display_stm_transition_t *tb = *(display_stm_transition_t **)b;
+
+        /* Total duration is the 1st phase */
+        return (ta->phase[0] < tb->phase[0]) - (ta->phase[0] > tb->phase[0]);
+}
+
+/** Release display state transition details
+ */
+static void xmce_display_stm_transition_free(gpointer aptr)
+{
+        display_stm_transition_t *tr = aptr;
+
+        if( tr ) {
+                g_free(tr->from);
+                g_free(tr->to);
+                g_free(tr);
+        }
+}
+
+/** Get and print display state machine transition timing statistics
+ */
+static bool xmce_get_display_stm_stats(const char *args)
+{
+        (void)args;
+
+        DBusMessage     *rsp = NULL;
+        DBusMessageIter  body, arr, sub, vec;
+        GPtrArray       *names  = g_ptr_array_new_with_free_func(g_free);
+        int              phases = 0;
+        GPtrArray       *recent = g_ptr_array_new_with_free_func(xmce_display_stm_transition_free);
+
+        if( !xmce_ipc_message_reply(MCE_DISPLAY_STM_STATS_GET, &rsp, DBUS_TYPE_INVALID) )
+                goto EXIT;
+
+        if( !dbushelper_init_read_iterator(rsp, &body) )
+                goto EXIT;
+
+        /* Phase histograms */
+        if( !xmce_print_hist_array(&body, "PHASE", 14,
+                                   "<5/<10/<20/<50/<100/<200/<500/<1000/<2000/more ms",
+                                   names) )
+                goto EXIT;
+
+        phases = MIN((int)names->len, DISPLAY_STM_PHASES_MAX);
+
+        /* Recent transitions */
+        if( !dbushelper_require_array_type(&body, DBUS_TYPE_STRUCT) )
+                goto EXIT;
+
+        if( !dbushelper_read_array(&body, &arr) )
+                goto EXIT;
+
+        while( dbus_message_iter_get_arg_type(&arr) == DBUS_TYPE_STRUCT ) {
+                display_stm_transition_t *tr = g_malloc0(sizeof *tr);
+                guint64 val = 0;
+                int     n   = 0;
+
+                g_ptr_array_add(recent, tr);
+
+                dbus_message_iter_recurse(&arr, &sub);
+                dbus_message_iter_next(&arr);
+
+                if( !dbushelper_read_string(&sub, &tr->from) ||
+                    !dbushelper_read_string(&sub, &tr->to) ||
+                    !dbushelper_read_int64(&sub, &tr->started) ||
+                    !dbushelper_read_array(&sub, &vec) )
+                        goto EXIT;
+
+                while( dbushelper_read_uint64(&vec, &val) ) {
+                        if( n < DISPLAY_STM_PHASES_MAX )
+                                tr->phase[n++] = val;
+                }
+        }
+
+        g_ptr_array_sort(recent, xmce_display_stm_transition_cmp);
+
+        printf("\n%-24s %10s", "SLOWEST RECENT", "AT_S");
+        for( int i = 0; i < phases; ++i ) {
+                const char *name = g_ptr_array_index(names, i);
+                printf(" %*s", (int)MAX(strlen(name), 8), name);
+        }
+        printf("\n");
+
+        for( guint i = 0; i < recent->len && i < DISPLAY_STM_SLOWEST_MAX; ++i ) {
+                const display_stm_transition_t *tr = g_ptr_array_index(recent, i);
+                gchar *trans = g_strdup_printf("%s->%s", tr->from, tr->to);
+
+                printf("%-24s %10.3f", trans, tr->started * 1e-3);
+                for( int k = 0; k < phases; ++k ) {
+                        const char *name = g_ptr_array_index(names, k);
+                        printf(" %*.1f", (int)MAX(strlen(name), 8),
+                               tr->phase[k] * 1e-3);
+                }
+                printf("\n");
+
+                g_free(trans);
+        }
+
+EXIT:
+        g_ptr_array_free(names, TRUE);
+        g_ptr_array_free(recent, TRUE);
+
+        if( rsp ) dbus_message_unref(rsp);
+
+        return true;
+}
+
+/** Reset display state machine transition timing statistics
+ */
+static bool xmce_reset_display_stm_stats(const char *args)
+{
+        (void)args;
+
+        xmce_ipc_no_reply(MCE_DISPLAY_STM_STATS_RESET, DBUS_TYPE_INVALID);
+        return true;
+}
+
+/* ------------------------------------------------------------------------- *
+ * bulk state query
+ * ------------------------------------------------------------------------- */
+
+/** Get and print cached mce states in one round trip
+ *
+ * @param args comma separated list of state keys, or NULL for all
+ */
+static bool xmce_get_states(const char *args)
+{
+        DBusMessage     *rsp  = NULL;
+        gchar          **keys = g_strsplit(args ?: "", ",", 0);
+        int              cnt  = 0;
+        DBusMessageIter  body, dict, ent, var;
+
+        /* Skip empty items, i.e. "--get-states" and "--get-states=a,,b" */
+        for( int i = 0; keys[i]; ++i ) {
+                if( *keys[i] )
+                        keys[cnt++] = keys[i];
+                else
+                        g_free(keys[i]);
+        }
+        keys[cnt] = 0;
+
+        if( !xmce_ipc_message_reply(MCE_STATE_QUERY_GET, &rsp,
+                                    DBUS_TYPE_ARRAY, DBUS_TYPE_STRING,
+                                    &keys, cnt,
+                                    DBUS_TYPE_INVALID) )
+                goto EXIT;
+
+        if( !dbushelper_init_read_iterator(rsp, &body) )
+                goto EXIT;
+
+        if( !dbushelper_require_array_type(&body, DBUS_TYPE_DICT_ENTRY) )
+                goto EXIT;
+
+        if( !dbushelper_read_array(&body, &dict) )
+                goto EXIT;
+
+        while( dbus_message_iter_get_arg_type(&dict) == DBUS_TYPE_DICT_ENTRY ) {
+                gchar    *key = 0;
+                gchar    *str = 0;
+                gint      num = 0;
+                gboolean  flg = FALSE;
+
+                dbus_message_iter_recurse(&dict, &ent);
+                dbus_message_iter_next(&dict);
+
+                if( !dbushelper_read_string(&ent, &key) ||
+                    !dbushelper_read_variant(&ent, &var) ) {
+                        g_free(key);
+                        goto EXIT;
+                }
+
+                switch( dbus_message_iter_get_arg_type(&var) ) {
+                case DBUS_TYPE_STRING:
+                        if( dbushelper_read_string(&var, &str) )
+                                printf("%-"PAD1"s %s\n", key, str);
+                        break;
+                case DBUS_TYPE_BOOLEAN:
+                        if( dbushelper_read_boolean(&var, &flg) )
+                                printf("%-"PAD1"s %s\n", key,
+                                       flg ? "true" : "false");
+                        break;
+                case DBUS_TYPE_INT32:
+                        if( dbushelper_read_int(&var, &num) )
+                                printf("%-"PAD1"s %d\n", key, num);
+                        break;
+                default:
+                        printf("%-"PAD1"s %s\n", key, "<unsupported type>");
+                        break;
+                }
+
+                g_free(str);
+                g_free(key);
+        }
+
+EXIT:
+        if( rsp ) dbus_message_unref(rsp);
+        g_strfreev(keys);
+
+        return true;
+}
+
 /* ------------------------------------------------------------------------- *
  * cpu scaling governor override
  * ------------------------------------------------------------------------- */
@@ -5862,6 +6431,92 @@ static const mce_opt_t options[] =
                 .usage       =
                         "output MCE status\n"
         },
+        {
+                .name        = "get-datapipe-stats",
+                .without_arg = xmce_get_datapipe_stats,
+                .usage       =
+                        "output datapipe execution statistics\n"
+                        "\n"
+                        "Times are cumulative milliseconds spent in filters,\n"
+                        "input triggers and output triggers, and the single\n"
+                        "most expensive filter/trigger call of each datapipe.\n"
+                        "Statistics are collected only while enabled with\n"
+                        "--set-datapipe-stats.\n"
+        },
+        {
+                .name        = "reset-datapipe-stats",
+                .without_arg = xmce_reset_datapipe_stats,
+                .usage       =
+                        "reset datapipe execution statistics\n"
+        },
+        {
+                .name        = "set-datapipe-stats",
+                .with_arg    = xmce_set_datapipe_stats,
+                .values      = "enabled|disabled",
+                .usage       =
+                        "enable/disable collecting datapipe execution statistics\n"
+                        "\n"
+                        "Timing is disabled by default as it adds clock reads\n"
+                        "to every datapipe filter and trigger call.\n"
+        },
+        {
+                .name        = "get-input-latency",
+                .without_arg = xmce_get_input_latency,
+                .usage       =
+                        "output input latency histograms\n"
+                        "\n"
+                        "Latencies are measured from kernel timestamp of an input\n"
+                        "event to: reading it (read), handling a power key event\n"
+                        "(powerkey), propagating user activity (activity) and the\n"
+                        "display reaching the on state after power key press\n"
+                        "(unblank).\n"
+        },
+        {
+                .name        = "reset-input-latency",
+                .without_arg = xmce_reset_input_latency,
+                .usage       =
+                        "reset input latency histograms\n"
+        },
+        {
+                .name        = "dump-flight-recorder",
+                .without_arg = xmce_dump_flight_recorder,
+                .usage       =
+                        "make mce write recent log events to a file\n"
+                        "\n"
+                        "Events up to debug level are recorded regardless of\n"
+                        "verbosity level. Arguments are included only for logged\n"
+                        "messages; filtered out ones show just the format string.\n"
+                        "Events are also dumped on SIGUSR1 and when mce aborts.\n"
+        },
+        {
+                .name        = "get-display-stm-stats",
+                .without_arg = xmce_get_display_stm_stats,
+                .usage       =
+                        "output display state transition timing statistics\n"
+                        "\n"
+                        "Shows duration histograms for whole transitions (total)\n"
+                        "and for waiting compositor (ui_start, ui_stop), frame\n"
+                        "buffer (fb_suspend, fb_resume) and backlight fading\n"
+                        "(backlight_on, backlight_off), followed by per phase\n"
+                        "timing [ms] of the slowest recent transitions.\n"
+        },
+        {
+                .name        = "reset-display-stm-stats",
+                .without_arg = xmce_reset_display_stm_stats,
+                .usage       =
+                        "reset display state transition timing statistics\n"
+        },
+        {
+                .name        = "get-states",
+                .with_arg    = xmce_get_states,
+                .without_arg = xmce_get_states,
+                .values      = "key[,key...]",
+                .usage       =
+                        "output cached mce states using one D-Bus query\n"
+                        "\n"
+                        "If state keys are given, only those are included,\n"
+                        "for example: display_status,tklock_mode,call_state\n"
+        },
         {
                 .name        = "block",
                 .flag        = 'B',